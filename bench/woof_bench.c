@@ -0,0 +1,1150 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Micro-benchmarks for engine hot paths. Links the engine without
+//      i_main.c and runs it headless: no window, sound or input.
+//
+//      Drawer, wipe, network and OPL benchmarks are synthetic and always
+//      run.
+//      Lump lookup and playsim benchmarks need a level and only run when
+//      an IWAD is given with -iwad (and optionally -file and -warp).
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h" // SDL_main on Windows
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "f_wipe.h"
+#include "g_game.h"
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "net_defs.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_structrw.h"
+#include "net_udp.h"
+#include "opl.h"
+#include "opl3.h"
+#include "p_inter.h"
+#include "p_maputl.h"
+#include "p_map.h"
+#include "p_mobj.h"
+#include "p_saveg.h"
+#include "p_setup.h"
+#include "p_tick.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "r_state.h"
+#include "v_video.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+extern byte *savebuffer; // g_game.c
+
+// Initial savegame buffer size from g_game.c, CheckSaveGame() grows it.
+#define SAVEGAMESIZE 0x20000
+
+// Upper bound for the calibrated iteration count.
+#define MAX_ITERATIONS (1 << 30)
+
+typedef struct
+{
+    const char *name;
+    boolean needs_level;   // only run with a loaded level
+    boolean explicit_only; // only run when selected with -filter
+    void (*Setup)(void);
+    void (*Run)(int iterations);
+} bench_t;
+
+typedef struct
+{
+    const char *name;
+    int iterations;
+    double ns_per_op;
+    double min_ns_per_op;
+} result_t;
+
+//
+// Drawers
+//
+
+#define BENCH_WIDTH  640
+#define BENCH_HEIGHT 400
+
+static byte column_source[128];
+static byte span_source[64 * 64];
+static lighttable_t identity_colormap[256];
+static lighttable_t fuzz_colormap[32 * 256];
+static byte no_brightmap[256];
+static byte tl_tranmap[256 * 256];
+
+// Sets up the screen buffer and the video and view state for a resolution.
+
+static void SetVideoMode(int width, int height, int unscaledw)
+{
+    static pixel_t *buffer;
+    static int buffer_size;
+
+    if (width * height > buffer_size)
+    {
+        Z_Free(buffer);
+        buffer_size = width * height;
+        buffer = Z_Calloc(buffer_size, sizeof(*buffer), PU_STATIC, NULL);
+    }
+
+    I_VideoBuffer = buffer;
+
+    video.width = width;
+    video.height = height;
+    video.pitch = width;
+    video.unscaledw = unscaledw;
+    V_Init();
+    V_RestoreBuffer();
+
+    viewwidth = scaledviewwidth = width;
+    viewheight = scaledviewheight = height;
+    viewwindowx = viewwindowy = 0;
+    centery = height / 2;
+
+    R_InitBufferRes();
+    R_InitBuffer();
+}
+
+static void SetupDrawers(void)
+{
+    static boolean initted = false;
+    int i;
+
+    SetVideoMode(BENCH_WIDTH, BENCH_HEIGHT, SCREENWIDTH);
+
+    if (initted)
+    {
+        return;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        identity_colormap[i] = i;
+    }
+    for (i = 0; i < arrlen(column_source); i++)
+    {
+        column_source[i] = i * 7;
+    }
+    for (i = 0; i < arrlen(span_source); i++)
+    {
+        span_source[i] = i * 13;
+    }
+    for (i = 0; i < arrlen(fuzz_colormap); i++)
+    {
+        fuzz_colormap[i] = i;
+    }
+    for (i = 0; i < arrlen(tl_tranmap); i++)
+    {
+        tl_tranmap[i] = i ^ (i >> 8);
+    }
+
+    if (fullcolormap == NULL)
+    {
+        fullcolormap = fuzz_colormap;
+    }
+
+    initted = true;
+}
+
+static void SetupColumn(void)
+{
+    SetupDrawers();
+
+    dc_source = column_source;
+    dc_texheight = 128;
+    dc_colormap[0] = dc_colormap[1] = identity_colormap;
+    dc_brightmap = no_brightmap;
+    dc_iscale = FRACUNIT * 200 / BENCH_HEIGHT;
+    dc_texturemid = 100 * FRACUNIT;
+}
+
+// One full-height column per op.
+
+static void RunDrawColumn(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        dc_x = i % BENCH_WIDTH;
+        dc_yl = 0;
+        dc_yh = BENCH_HEIGHT - 1;
+        R_DrawColumn();
+    }
+}
+
+static void SetupTLColumn(void)
+{
+    SetupColumn();
+
+    tranmap = tl_tranmap;
+}
+
+static void RunDrawTLColumn(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        dc_x = i % BENCH_WIDTH;
+        dc_yl = 0;
+        dc_yh = BENCH_HEIGHT - 1;
+        R_DrawTLColumn();
+    }
+}
+
+static void RunDrawFuzzColumn(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        // R_DrawFuzzColumn clips against the view edges in place.
+        dc_x = i % BENCH_WIDTH;
+        dc_yl = 0;
+        dc_yh = BENCH_HEIGHT - 1;
+        R_DrawFuzzColumn();
+    }
+}
+
+static void SetupSpan(void)
+{
+    SetupDrawers();
+
+    ds_source = span_source;
+    ds_colormap[0] = ds_colormap[1] = identity_colormap;
+    ds_brightmap = no_brightmap;
+    ds_xstep = FRACUNIT / 3;
+    ds_ystep = FRACUNIT / 5;
+}
+
+// One full-width span per op.
+
+static void RunDrawSpan(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        ds_y = i % BENCH_HEIGHT;
+        ds_x1 = 0;
+        ds_x2 = BENCH_WIDTH - 1;
+        ds_xfrac = i << 10;
+        ds_yfrac = i << 12;
+        R_DrawSpan();
+    }
+}
+
+//
+// Frame
+//
+
+// The level's starting view, rendered at a resolution. These measure
+// whichever frame buffer the bench is built with, paletted or true-colour
+// (WOOF_TRUECOLOR), so build it both ways to compare the two.
+
+static void SetupView(int width, int height)
+{
+    // Keep R_RenderView() from running the game loop's network updates.
+    singletics = true;
+
+    SetVideoMode(width, height, 426);
+    R_InitVisplanesRes();
+    R_InitAnyRes();
+    R_SetViewSize(11);
+    R_ExecuteSetViewSize();
+}
+
+static void SetupView1080(void) { SetupView(1920, 1080); }
+static void SetupView2160(void) { SetupView(3840, 2160); }
+
+// One frame per op, turning a little each time.
+
+static void RunRenderView(int iterations)
+{
+    player_t *player = &players[0];
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        player->mo->angle += ANG1;
+        R_RenderPlayerView(player);
+    }
+}
+
+// The step from the frame buffer to the texture in I_FinishUpdate(). A
+// paletted frame goes through the palette to ARGB, like SDL_LowerBlit()
+// does, a true-colour frame is already in the texture format.
+
+static uint32_t *blit_buffer;
+static uint32_t blit_palette[256];
+
+static void SetupBlit(int width, int height)
+{
+    int i;
+
+    SetVideoMode(width, height, 426);
+
+    Z_Free(blit_buffer);
+    blit_buffer = Z_Malloc(width * height * sizeof(*blit_buffer),
+                           PU_STATIC, NULL);
+
+    for (i = 0; i < 256; i++)
+    {
+        blit_palette[i] = 0xff000000 | (i * 0x010203);
+    }
+    for (i = 0; i < width * height; i++)
+    {
+        I_VideoBuffer[i] = i * 7;
+    }
+}
+
+static void SetupBlit1080(void) { SetupBlit(1920, 1080); }
+static void SetupBlit2160(void) { SetupBlit(3840, 2160); }
+
+// One frame per op.
+
+static void RunBlit(int iterations)
+{
+    const int size = video.width * video.height;
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+#ifdef TRUECOLOR
+        memcpy(blit_buffer, I_VideoBuffer, size * sizeof(*blit_buffer));
+#else
+        int j;
+
+        for (j = 0; j < size; j++)
+        {
+            blit_buffer[j] = blit_palette[I_VideoBuffer[j]];
+        }
+#endif
+    }
+}
+
+//
+// Screen wipe
+//
+
+// Melts between two screens, capturing them again before each melt the
+// way D_Display() does.
+
+static boolean wipe_running;
+
+static void FinishWipe(void)
+{
+    while (wipe_running)
+    {
+        wipe_running = !wipe_ScreenWipe(wipe_Melt, 0, 0, video.unscaledw,
+                                        SCREENHEIGHT, 1);
+    }
+}
+
+static void SetupWipe(int width, int height, int unscaledw)
+{
+    // Finish the melt of the previous resolution first.
+    FinishWipe();
+    SetVideoMode(width, height, unscaledw);
+}
+
+static void SetupWipe320(void)  { SetupWipe(320, 200, 320);   }
+static void SetupWipe1080(void) { SetupWipe(1920, 1080, 426); }
+static void SetupWipe2160(void) { SetupWipe(3840, 2160, 426); }
+
+static void StartWipe(void)
+{
+    const int size = video.width * video.height;
+    int i;
+
+    for (i = 0; i < size; i++)
+    {
+        I_VideoBuffer[i] = i * 7;
+    }
+    wipe_StartScreen(0, 0, video.unscaledw, SCREENHEIGHT);
+
+    for (i = 0; i < size; i++)
+    {
+        I_VideoBuffer[i] = i * 13;
+    }
+    wipe_EndScreen(0, 0, video.unscaledw, SCREENHEIGHT);
+}
+
+// One melt frame per op, one tic apart.
+
+static void RunWipe(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (!wipe_running)
+        {
+            StartWipe();
+        }
+        wipe_running = !wipe_ScreenWipe(wipe_Melt, 0, 0, video.unscaledw,
+                                        SCREENHEIGHT, 1);
+    }
+}
+
+//
+// Network
+//
+
+#define TICCMD_PLAYERS 4
+
+static net_full_ticcmd_t full_ticcmd;
+
+static void SetupTiccmd(void)
+{
+    ticcmd_t base = {0};
+    int i;
+
+    full_ticcmd.latency = 3;
+    full_ticcmd.seq = 1234;
+
+    for (i = 0; i < TICCMD_PLAYERS; i++)
+    {
+        ticcmd_t cmd = {0};
+
+        cmd.forwardmove = 25 + i;
+        cmd.sidemove = -24 + i;
+        cmd.angleturn = 640 * (i + 1);
+        cmd.buttons = BT_ATTACK;
+        cmd.consistancy = 0x1234 + i;
+
+        full_ticcmd.playeringame[i] = true;
+        NET_TiccmdDiff(&base, &cmd, &full_ticcmd.cmds[i]);
+    }
+}
+
+// One write and read back of a full ticcmd set per op.
+
+static void RunTiccmd(int iterations)
+{
+    net_packet_t *packet = NET_NewPacket(256);
+    net_full_ticcmd_t cmd;
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        packet->len = packet->pos = 0;
+        NET_WriteFullTiccmd(packet, &full_ticcmd, false);
+        packet->pos = 0;
+
+        if (!NET_ReadFullTiccmd(packet, &cmd, false))
+        {
+            I_Error("RunTiccmd: Failed to read back ticcmd");
+        }
+    }
+
+    NET_FreePacket(packet);
+}
+
+#define LOOPBACK_BATCH 32
+
+static net_context_t *loopback_context;
+static net_addr_t *loopback_addr;
+
+static void SetupLoopback(void)
+{
+    net_module_t *module = NET_UDPModule();
+
+    if (!module->InitServer())
+    {
+        I_Error("SetupLoopback: Failed to bind the server socket");
+    }
+
+    loopback_context = NET_NewContext();
+    NET_AddModule(loopback_context, module);
+
+    loopback_addr = NET_ResolveAddress(loopback_context, "127.0.0.1");
+    if (loopback_addr == NULL)
+    {
+        I_Error("SetupLoopback: Failed to resolve 127.0.0.1");
+    }
+}
+
+// One packet sent to ourselves and received per op. Packets go out in
+// batches so that batched receiving has something to batch.
+
+static void RunLoopback(int iterations)
+{
+    net_packet_t *packet = NET_NewPacket(64);
+    int sent = 0, received = 0, retries = 0;
+
+    NET_WriteInt32(packet, 0x12345678);
+    NET_WriteString(packet, "woof-bench");
+
+    while (received < iterations)
+    {
+        net_addr_t *addr;
+        net_packet_t *recvd;
+
+        while (sent < iterations && sent - received < LOOPBACK_BATCH)
+        {
+            NET_SendPacket(loopback_addr, packet);
+            sent++;
+        }
+
+        if (NET_RecvPacket(loopback_context, &addr, &recvd))
+        {
+            NET_ReleaseAddress(addr);
+            NET_FreePacket(recvd);
+            received++;
+            retries = 0;
+        }
+        else if (++retries > 1000000)
+        {
+            I_Error("RunLoopback: Lost %d of %d packets",
+                    sent - received, sent);
+        }
+    }
+
+    NET_FreePacket(packet);
+}
+
+//
+// OPL emulation
+//
+
+#define OPL_RATE    44100
+#define OPL_SAMPLES 512
+
+// The benchmark chips, up to the most the music player can drive.
+
+static opl3_chip opl_chips[OPL_MAX_CHIPS];
+static Bit16s opl_buffers[OPL_MAX_CHIPS][OPL_SAMPLES * 2];
+
+static void SetupOPLChip(opl3_chip *chip)
+{
+    int voice;
+
+    OPL3_Reset(chip, OPL_RATE);
+
+    OPL3_WriteReg(chip, 0x105, 0x01); // OPL3 mode
+    OPL3_WriteReg(chip, 0x01, 0x20);  // waveform select
+
+    // A simple sustained instrument on all nine voices of the first
+    // register bank, playing a chord.
+
+    for (voice = 0; voice < 9; voice++)
+    {
+        int op = (voice / 3) * 8 + (voice % 3);
+        int fnum = 0x158 + voice * 0x20;
+
+        OPL3_WriteReg(chip, 0x20 + op, 0x21);
+        OPL3_WriteReg(chip, 0x23 + op, 0x21);
+        OPL3_WriteReg(chip, 0x40 + op, 0x10);
+        OPL3_WriteReg(chip, 0x43 + op, 0x00);
+        OPL3_WriteReg(chip, 0x60 + op, 0xf4);
+        OPL3_WriteReg(chip, 0x63 + op, 0xf4);
+        OPL3_WriteReg(chip, 0x80 + op, 0x24);
+        OPL3_WriteReg(chip, 0x83 + op, 0x24);
+        OPL3_WriteReg(chip, 0xc0 + voice, 0x36);
+        OPL3_WriteReg(chip, 0xa0 + voice, fnum & 0xff);
+        OPL3_WriteReg(chip, 0xb0 + voice, 0x20 | (4 << 2) | (fnum >> 8));
+    }
+}
+
+static void SetupOPL(void)
+{
+    int i;
+
+    for (i = 0; i < OPL_MAX_CHIPS; i++)
+    {
+        SetupOPLChip(&opl_chips[i]);
+    }
+}
+
+// One buffer of OPL_SAMPLES stereo frames per op.
+
+static void RunOPL(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        OPL3_GenerateStream(&opl_chips[0], opl_buffers[0], OPL_SAMPLES);
+    }
+}
+
+// One buffer of OPL_SAMPLES stereo frames from every chip per op, the
+// total emulation work for num_opl_chips at its maximum. The music player
+// spreads the chips after the first across worker threads, which need an
+// audio device and aren't measured here.
+
+static void RunOPLChips(int iterations)
+{
+    int i, chip;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (chip = 0; chip < OPL_MAX_CHIPS; chip++)
+        {
+            OPL3_GenerateStream(&opl_chips[chip], opl_buffers[chip],
+                                OPL_SAMPLES);
+        }
+    }
+}
+
+//
+// WAD and playsim, using the level loaded at startup
+//
+
+static mobj_t **mobjs;
+static int num_mobjs;
+
+static const char *lookup_misses[] = {
+    "NOTALUMP", "WOOFBNCH", "E9M9", "MAP99", "DEHACKED", "SWITCHES"
+};
+
+// One lump name lookup per op, mostly hits with some misses.
+
+static void RunCheckNumForName(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (i % 8 == 0)
+        {
+            W_CheckNumForName(lookup_misses[(i / 8) % arrlen(lookup_misses)]);
+        }
+        else
+        {
+            W_CheckNumForName(lumpinfo[i % numlumps].name);
+        }
+    }
+}
+
+static void SetupMobjs(void)
+{
+    thinker_t *th;
+    int size = 0;
+
+    if (mobjs != NULL)
+    {
+        return;
+    }
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        if (th->function.p1 == (actionf_p1)P_MobjThinker)
+        {
+            num_mobjs++;
+        }
+    }
+
+    if (num_mobjs == 0)
+    {
+        I_Error("SetupMobjs: The level has no things");
+    }
+
+    mobjs = Z_Malloc(num_mobjs * sizeof(*mobjs), PU_STATIC, NULL);
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        if (th->function.p1 == (actionf_p1)P_MobjThinker)
+        {
+            mobjs[size++] = (mobj_t *)th;
+        }
+    }
+}
+
+// Pairs of things, walking through the pairs in a fixed order.
+
+static mobj_t *PairFirst(int i)
+{
+    return mobjs[i % num_mobjs];
+}
+
+static mobj_t *PairSecond(int i)
+{
+    return mobjs[(i * 7 + 1 + i / num_mobjs) % num_mobjs];
+}
+
+// One sight check between two things per op.
+
+static void RunCheckSight(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        P_CheckSight(PairFirst(i), PairSecond(i));
+    }
+}
+
+static boolean PTR_Count(intercept_t *in)
+{
+    return true;
+}
+
+// One line and thing traversal between two things per op.
+
+static void RunPathTraverse(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        mobj_t *t1 = PairFirst(i), *t2 = PairSecond(i);
+
+        P_PathTraverse(t1->x, t1->y, t2->x, t2->y,
+                       PT_ADDLINES | PT_ADDTHINGS, PTR_Count);
+    }
+}
+
+// One position check of a thing at its own spot per op.
+
+static void RunCheckPosition(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        mobj_t *mobj = PairFirst(i);
+
+        P_CheckPosition(mobj, mobj->x, mobj->y);
+    }
+}
+
+// Points spread over the blockmap area, which covers the whole map.
+
+#define NUM_POINTS 4096
+
+static fixed_t points[NUM_POINTS][2];
+
+static void SetupPoints(void)
+{
+    const int64_t width = (int64_t)bmapwidth * MAPBLOCKUNITS;
+    const int64_t height = (int64_t)bmapheight * MAPBLOCKUNITS;
+    uint32_t seed = 1;
+    int i;
+
+    for (i = 0; i < NUM_POINTS; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        points[i][0] = bmaporgx + (fixed_t)((seed >> 8) % width) * FRACUNIT;
+        seed = seed * 1664525 + 1013904223;
+        points[i][1] = bmaporgy + (fixed_t)((seed >> 8) % height) * FRACUNIT;
+    }
+}
+
+// One BSP point lookup per op.
+
+static void RunPointInSubsector(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        const fixed_t *point = points[i % NUM_POINTS];
+
+        R_PointInSubsector(point[0], point[1]);
+    }
+}
+
+static void SetupArchive(void)
+{
+    SetupMobjs();
+
+    if (savebuffer == NULL)
+    {
+        savebuffer = Z_Malloc(SAVEGAMESIZE, PU_STATIC, NULL);
+    }
+}
+
+// One archive of all thinkers of the level per op.
+
+static void RunArchiveThinkers(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        save_p = savebuffer;
+        P_ArchiveThinkers();
+    }
+}
+
+// One tic of the level per op. These run last, since they change the
+// level for any benchmark that would come after them.
+
+static void RunTicker(int iterations)
+{
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        P_Ticker();
+    }
+}
+
+// Fill the level with monsters on a grid. Awake ones make the kind of map
+// where the playsim is the bottleneck, dead ones the kind where the level
+// is littered with objects that have nothing left to do.
+
+#define CROWD_SIZE  10000
+#define CROWD_SPACE (48 * FRACUNIT)
+
+static int SpawnCrowd(boolean dead)
+{
+    const fixed_t width = bmapwidth << MAPBLOCKSHIFT;
+    const fixed_t height = bmapheight << MAPBLOCKSHIFT;
+    fixed_t x, y;
+    int count = 0;
+
+    P_MapStart();
+
+    for (y = CROWD_SPACE / 2; y < height && count < CROWD_SIZE;
+         y += CROWD_SPACE)
+    {
+        for (x = CROWD_SPACE / 2; x < width && count < CROWD_SIZE;
+             x += CROWD_SPACE)
+        {
+            mobj_t *mo = P_SpawnMobj(bmaporgx + x, bmaporgy + y, ONFLOORZ,
+                                     MT_POSSESSED);
+
+            if (!P_CheckPosition(mo, mo->x, mo->y)
+                || mo->ceilingz - mo->floorz < mo->height)
+            {
+                P_RemoveMobj(mo);
+                continue;
+            }
+
+            if (dead)
+            {
+                P_DamageMobj(mo, NULL, NULL, mo->health);
+            }
+            else
+            {
+                P_SetTarget(&mo->target, players[0].mo);
+                P_SetMobjState(mo, mo->info->seestate);
+            }
+            count++;
+        }
+    }
+
+    P_MapEnd();
+
+    return count;
+}
+
+static void SetupCorpses(void)
+{
+    static boolean done;
+
+    if (!done)
+    {
+        done = true;
+        I_Printf(VB_INFO, "SetupCorpses: spawned %d corpses.",
+                 SpawnCrowd(true));
+    }
+}
+
+static void SetupCrowd(void)
+{
+    static boolean done;
+
+    if (!done)
+    {
+        done = true;
+        I_Printf(VB_INFO, "SetupCrowd: spawned %d monsters.",
+                 SpawnCrowd(false));
+    }
+}
+
+static bench_t benchmarks[] = {
+    { "r_drawcolumn",       false, false, SetupColumn,   RunDrawColumn       },
+    { "r_drawtlcolumn",     false, false, SetupTLColumn, RunDrawTLColumn     },
+    { "r_drawfuzzcolumn",   false, false, SetupColumn,   RunDrawFuzzColumn   },
+    { "r_drawspan",         false, false, SetupSpan,     RunDrawSpan         },
+    { "i_blit_1920x1080",   false, false, SetupBlit1080, RunBlit             },
+    { "i_blit_3840x2160",   false, false, SetupBlit2160, RunBlit             },
+    { "f_wipe_320x200",     false, false, SetupWipe320,  RunWipe             },
+    { "f_wipe_1920x1080",   false, false, SetupWipe1080, RunWipe             },
+    { "f_wipe_3840x2160",   false, false, SetupWipe2160, RunWipe             },
+    { "net_ticcmd",         false, false, SetupTiccmd,   RunTiccmd           },
+    { "net_udp_loopback",   false, true,  SetupLoopback, RunLoopback         },
+    { "opl3_generate",      false, false, SetupOPL,      RunOPL              },
+    { "opl3_6chips",        false, false, SetupOPL,      RunOPLChips         },
+    { "w_checknumforname",  true,  false, NULL,          RunCheckNumForName  },
+    { "r_pointinsubsector", true,  false, SetupPoints,   RunPointInSubsector },
+    { "r_view_1920x1080",   true,  false, SetupView1080, RunRenderView       },
+    { "r_view_3840x2160",   true,  false, SetupView2160, RunRenderView       },
+    { "p_checksight",       true,  false, SetupMobjs,    RunCheckSight       },
+    { "p_pathtraverse",     true,  false, SetupMobjs,    RunPathTraverse     },
+    { "p_checkposition",    true,  false, SetupMobjs,    RunCheckPosition    },
+    { "p_archivethinkers",  true,  false, SetupArchive,  RunArchiveThinkers  },
+    { "p_ticker",           true,  false, NULL,          RunTicker           },
+    { "p_ticker_corpses",   true,  false, SetupCorpses,  RunTicker           },
+    { "p_ticker_crowd",     true,  false, SetupCrowd,    RunTicker           },
+};
+
+//
+// Harness
+//
+
+static int min_time_us = 250 * 1000;
+static int num_repeats = 5;
+
+static uint64_t TimeRun(const bench_t *bench, int iterations)
+{
+    uint64_t start = I_GetTimeUS();
+
+    bench->Run(iterations);
+
+    return I_GetTimeUS() - start;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void RunBenchmark(const bench_t *bench, result_t *result)
+{
+    double samples[16];
+    int iterations = 1;
+    int i;
+
+    if (bench->Setup)
+    {
+        bench->Setup();
+    }
+
+    // Warm up, then double the iteration count until one run takes
+    // long enough to time reliably.
+
+    bench->Run(1);
+
+    // The count is multiplied by 4 below, keep it within an int.
+
+    while (iterations < MAX_ITERATIONS / 4
+           && TimeRun(bench, iterations) < (uint64_t)min_time_us / 4)
+    {
+        iterations *= 2;
+    }
+    iterations *= 4;
+
+    for (i = 0; i < num_repeats; i++)
+    {
+        samples[i] = TimeRun(bench, iterations) * 1000.0 / iterations;
+    }
+
+    qsort(samples, num_repeats, sizeof(*samples), CompareDoubles);
+
+    result->name = bench->name;
+    result->iterations = iterations;
+    result->ns_per_op = samples[num_repeats / 2];
+    result->min_ns_per_op = samples[0];
+}
+
+static void PrintResult(const result_t *result, boolean json, boolean first)
+{
+    if (json)
+    {
+        printf("%s\n  {\"name\": \"%s\", \"iterations\": %d, "
+               "\"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f}",
+               first ? "" : ",", result->name, result->iterations,
+               result->ns_per_op, result->min_ns_per_op);
+    }
+    else
+    {
+        printf("%s\t%d\t%.2f\t%.2f\n", result->name, result->iterations,
+               result->ns_per_op, result->min_ns_per_op);
+    }
+    fflush(stdout);
+}
+
+static void PrintUsage(void)
+{
+    int i;
+
+    printf("Usage: woof-bench [options]\n"
+           "\n"
+           "  -iwad <file>      Load a level and run the level benchmarks too\n"
+           "  -file <files>     Load PWADs on top of the IWAD\n"
+           "  -warp <e> <m>     Level to load, like in the game\n"
+           "  -filter <text>    Only run benchmarks whose name contains text\n"
+           "  -time <ms>        Minimum time per repeat (default 250)\n"
+           "  -repeat <n>       Number of timed repeats (default 5, max 16)\n"
+           "  -udpnet           Use native sockets for net_udp_loopback\n"
+           "  -json             Print results as JSON instead of TSV\n"
+           "  -verbose          Print engine messages\n"
+           "  -list             List the benchmarks and exit\n"
+           "\n"
+           "Benchmarks:\n");
+
+    for (i = 0; i < arrlen(benchmarks); i++)
+    {
+        printf("  %-20s%s%s\n", benchmarks[i].name,
+               benchmarks[i].needs_level ? " (needs -iwad)" : "",
+               benchmarks[i].explicit_only ? " (only with -filter)" : "");
+    }
+}
+
+static void LoadLevel(void)
+{
+    int episode = 1, map = 1;
+    int p;
+
+    p = M_CheckParmWithArgs("-warp", 1);
+    if (p)
+    {
+        if (gamemode == commercial)
+        {
+            map = M_ParmArgToInt(p);
+        }
+        else if (p + 2 < myargc && myargv[p + 2][0] != '-')
+        {
+            episode = M_ParmArgToInt(p);
+            map = M_ParmArg2ToInt(p);
+        }
+        else
+        {
+            int em = M_ParmArgToInt(p);
+            episode = em / 10;
+            map = em % 10;
+        }
+
+        if (episode < 1 || map < 1
+            || W_CheckNumForName(MAPNAME(episode, map)) < 0)
+        {
+            I_Error("Invalid -warp %s, map not found.", myargv[p + 1]);
+        }
+    }
+
+    playeringame[0] = true;
+
+    G_InitNew(sk_hard, episode, map);
+
+    I_Printf(VB_INFO, "Loaded %s, %d lumps.", MAPNAME(episode, map),
+             numlumps);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    boolean json, level = false, first = true;
+    int i, p;
+
+    // Keep stdout machine-readable: engine messages are printed with
+    // minimum verbosity unless -verbose is given.
+
+    myargc = argc + 1;
+    myargv = malloc((myargc + 1) * sizeof(*myargv));
+    myargv[0] = argv[0];
+    myargv[1] = "-quiet";
+    memcpy(&myargv[2], &argv[1], argc * sizeof(*myargv));
+
+    if (M_ParmExists("-verbose"))
+    {
+        myargv[1] = "-verbose";
+    }
+
+    I_InitPrintf();
+
+    if (M_ParmExists("-help") || M_ParmExists("--help")
+        || M_ParmExists("-list"))
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    p = M_CheckParmWithArgs("-filter", 1);
+    if (p)
+    {
+        filter = myargv[p + 1];
+    }
+
+    p = M_CheckParmWithArgs("-time", 1);
+    if (p)
+    {
+        min_time_us = MAX(1, M_ParmArgToInt(p)) * 1000;
+    }
+
+    p = M_CheckParmWithArgs("-repeat", 1);
+    if (p)
+    {
+        num_repeats = BETWEEN(1, 16, M_ParmArgToInt(p));
+    }
+
+    json = M_ParmExists("-json");
+
+    if (M_ParmExists("-iwad"))
+    {
+        D_InitHeadless();
+        LoadLevel();
+        level = true;
+    }
+    else
+    {
+        I_InitTimer();
+    }
+
+    if (json)
+    {
+        printf("[");
+    }
+    else
+    {
+        printf("name\titerations\tns_per_op\tmin_ns_per_op\n");
+    }
+
+    for (i = 0; i < arrlen(benchmarks); i++)
+    {
+        const bench_t *bench = &benchmarks[i];
+        result_t result;
+
+        if (filter ? !strstr(bench->name, filter) : bench->explicit_only)
+        {
+            continue;
+        }
+
+        if (bench->needs_level && !level)
+        {
+            continue;
+        }
+
+        RunBenchmark(bench, &result);
+        PrintResult(&result, json, first);
+        first = false;
+    }
+
+    if (json)
+    {
+        printf("\n]\n");
+    }
+
+    return 0;
+}
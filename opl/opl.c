@@ -41,6 +41,7 @@ static opl_driver_t *driver = NULL;
 static int init_stage_reg_writes = 1;
 
 unsigned int opl_sample_rate = 22050;
+unsigned int opl_num_chips = 1;
 
 //
 // Init/shutdown code.
@@ -168,6 +169,14 @@ void OPL_SetSampleRate(unsigned int rate)
     opl_sample_rate = rate;
 }
 
+// Set the number of chips used for software OPL emulation.
+
+void OPL_SetNumChips(unsigned int num_chips)
+{
+    opl_num_chips = num_chips < 1 ? 1 :
+                    num_chips > OPL_MAX_CHIPS ? OPL_MAX_CHIPS : num_chips;
+}
+
 void OPL_WritePort(opl_port_t port, unsigned int value)
 {
     if (driver != NULL)
@@ -221,14 +230,17 @@ unsigned int OPL_ReadStatus(void)
 void OPL_WriteRegister(int reg, int value)
 {
     int i;
+    int chip_port = OPL_PORT_CHIP(reg >> 9);
+
+    reg &= 0x1ff;
 
     if (reg & 0x100)
     {
-        OPL_WritePort(OPL_REGISTER_PORT_OPL3, reg);
+        OPL_WritePort(OPL_REGISTER_PORT_OPL3 + chip_port, reg);
     }
     else
     {
-        OPL_WritePort(OPL_REGISTER_PORT, reg);
+        OPL_WritePort(OPL_REGISTER_PORT + chip_port, reg);
     }
 
     // For timing, read the register port six times after writing the
@@ -250,7 +262,7 @@ void OPL_WriteRegister(int reg, int value)
         }
     }
 
-    OPL_WritePort(OPL_DATA_PORT, value);
+    OPL_WritePort(OPL_DATA_PORT + chip_port, value);
 
     // Read the register port 24 times after writing the value to
     // cause the appropriate delay
@@ -321,17 +333,18 @@ opl_init_result_t OPL_Detect(void)
     }
 }
 
-// Initialize registers on startup
+// Initialize registers of one chip
 
-void OPL_InitRegisters(int opl3)
+static void InitChipRegisters(unsigned int chip, int opl3)
 {
+    int base = OPL_REG_CHIP(chip);
     int r;
 
     // Initialize level registers
 
     for (r=OPL_REGS_LEVEL; r <= OPL_REGS_LEVEL + OPL_NUM_OPERATORS; ++r)
     {
-        OPL_WriteRegister(r, 0x3f);
+        OPL_WriteRegister(r | base, 0x3f);
     }
 
     // Initialize other registers
@@ -341,34 +354,34 @@ void OPL_InitRegisters(int opl3)
 
     for (r=OPL_REGS_ATTACK; r <= OPL_REGS_WAVEFORM + OPL_NUM_OPERATORS; ++r)
     {
-        OPL_WriteRegister(r, 0x00);
+        OPL_WriteRegister(r | base, 0x00);
     }
 
     // More registers ...
 
     for (r=1; r < OPL_REGS_LEVEL; ++r)
     {
-        OPL_WriteRegister(r, 0x00);
+        OPL_WriteRegister(r | base, 0x00);
     }
 
     // Re-initialize the low registers:
 
     // Reset both timers and enable interrupts:
-    OPL_WriteRegister(OPL_REG_TIMER_CTRL,      0x60);
-    OPL_WriteRegister(OPL_REG_TIMER_CTRL,      0x80);
+    OPL_WriteRegister(OPL_REG_TIMER_CTRL | base,      0x60);
+    OPL_WriteRegister(OPL_REG_TIMER_CTRL | base,      0x80);
 
     // "Allow FM chips to control the waveform of each operator":
-    OPL_WriteRegister(OPL_REG_WAVEFORM_ENABLE, 0x20);
+    OPL_WriteRegister(OPL_REG_WAVEFORM_ENABLE | base, 0x20);
 
     if (opl3)
     {
-        OPL_WriteRegister(OPL_REG_NEW, 0x01);
+        OPL_WriteRegister(OPL_REG_NEW | base, 0x01);
 
         // Initialize level registers
 
         for (r=OPL_REGS_LEVEL; r <= OPL_REGS_LEVEL + OPL_NUM_OPERATORS; ++r)
         {
-            OPL_WriteRegister(r | 0x100, 0x3f);
+            OPL_WriteRegister(r | 0x100 | base, 0x3f);
         }
 
         // Initialize other registers
@@ -378,23 +391,35 @@ void OPL_InitRegisters(int opl3)
 
         for (r=OPL_REGS_ATTACK; r <= OPL_REGS_WAVEFORM + OPL_NUM_OPERATORS; ++r)
         {
-            OPL_WriteRegister(r | 0x100, 0x00);
+            OPL_WriteRegister(r | 0x100 | base, 0x00);
         }
 
         // More registers ...
 
         for (r=1; r < OPL_REGS_LEVEL; ++r)
         {
-            OPL_WriteRegister(r | 0x100, 0x00);
+            OPL_WriteRegister(r | 0x100 | base, 0x00);
         }
     }
 
     // Keyboard split point on (?)
-    OPL_WriteRegister(OPL_REG_FM_MODE,         0x40);
+    OPL_WriteRegister(OPL_REG_FM_MODE | base,         0x40);
 
     if (opl3)
     {
-        OPL_WriteRegister(OPL_REG_NEW, 0x01);
+        OPL_WriteRegister(OPL_REG_NEW | base, 0x01);
+    }
+}
+
+// Initialize registers on startup
+
+void OPL_InitRegisters(int opl3)
+{
+    unsigned int chip;
+
+    for (chip = 0; chip < opl_num_chips; ++chip)
+    {
+        InitChipRegisters(chip, opl3);
     }
 }
 
@@ -505,3 +530,22 @@ void OPL_AdjustCallbacks(float value)
     }
 }
 
+uint32_t OPL_Render(uint8_t *buffer, uint32_t nsamples)
+{
+    if (driver != NULL)
+    {
+        return driver->render_func(buffer, nsamples);
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+void OPL_SetStreamFunc(opl_stream_func_t func)
+{
+    if (driver != NULL)
+    {
+        driver->set_stream_func(func);
+    }
+}
@@ -23,6 +23,10 @@
 
 typedef void (*opl_callback_t)(void *data);
 
+// Supplies interleaved 16-bit stereo samples in place of the emulator.
+
+typedef uint32_t (*opl_stream_func_t)(uint8_t *buffer, uint32_t nsamples);
+
 // Result from OPL_Init(), indicating what type of OPL chip was detected,
 // if any.
 typedef enum
@@ -42,6 +46,14 @@ typedef enum
 #define OPL_NUM_OPERATORS   21
 #define OPL_NUM_VOICES      9
 
+// Maximum number of emulated chips.  Registers of the additional chips
+// are addressed by adding OPL_REG_CHIP(n) to the register number, their
+// I/O ports by adding OPL_PORT_CHIP(n) to the port.
+
+#define OPL_MAX_CHIPS       6
+#define OPL_REG_CHIP(n)     ((n) << 9)
+#define OPL_PORT_CHIP(n)    ((n) << 2)
+
 #define OPL_REG_WAVEFORM_ENABLE   0x01
 #define OPL_REG_TIMER1            0x02
 #define OPL_REG_TIMER2            0x03
@@ -85,6 +97,10 @@ void OPL_Shutdown(void);
 
 void OPL_SetSampleRate(unsigned int rate);
 
+// Set the number of chips used for software emulation.
+
+void OPL_SetNumChips(unsigned int num_chips);
+
 // Write to one of the OPL I/O ports:
 
 void OPL_WritePort(opl_port_t port, unsigned int value);
@@ -110,7 +126,7 @@ void OPL_WriteRegister(int reg, int value);
 
 opl_init_result_t OPL_Detect(void);
 
-// Initialize all registers, performed on startup.
+// Initialize all registers of all chips, performed on startup.
 
 void OPL_InitRegisters(int opl3);
 
@@ -149,5 +165,21 @@ void OPL_Delay(uint64_t us);
 
 void OPL_SetPaused(int paused);
 
+//
+// Offline rendering functions.
+//
+
+// Generate the specified number of samples of emulator output into
+// buffer, invoking any callbacks that fall due in that time. Returns
+// the number of samples generated.
+
+uint32_t OPL_Render(uint8_t *buffer, uint32_t nsamples);
+
+// Feed the audio output from the specified function instead of the
+// emulator, so that OPL_Render() can be driven from another thread.
+// Pass NULL to return to live emulation.
+
+void OPL_SetStreamFunc(opl_stream_func_t func);
+
 #endif
 
@@ -33,6 +33,8 @@ typedef void (*opl_lock_func)(void);
 typedef void (*opl_unlock_func)(void);
 typedef void (*opl_set_paused_func)(int paused);
 typedef void (*opl_adjust_callbacks_func)(float value);
+typedef uint32_t (*opl_render_func)(uint8_t *buffer, uint32_t nsamples);
+typedef void (*opl_set_stream_func)(opl_stream_func_t func);
 
 typedef struct
 {
@@ -48,11 +50,17 @@ typedef struct
     opl_unlock_func unlock_func;
     opl_set_paused_func set_paused_func;
     opl_adjust_callbacks_func adjust_callbacks_func;
+    opl_render_func render_func;
+    opl_set_stream_func set_stream_func;
 } opl_driver_t;
 
 // Sample rate to use when doing software emulation.
 
 extern unsigned int opl_sample_rate;
 
+// Number of chips to emulate.
+
+extern unsigned int opl_num_chips;
+
 #endif /* #ifndef OPL_INTERNAL_H */
 
@@ -69,14 +69,39 @@ static int opl_sdl_paused;
 
 static uint64_t pause_offset;
 
-// OPL software emulator structure.
+// OPL software emulator structures.
 
-static opl3_chip opl_chip;
+static opl3_chip opl_chips[OPL_MAX_CHIPS];
 static int opl_opl3mode;
+static unsigned int num_chips;
 
-// Register number that was written.
+// Register number that was written, per chip.
 
-static int register_num = 0;
+static int register_num[OPL_MAX_CHIPS];
+
+// The chips after the first one are generated on worker threads, each of
+// which renders into its own buffer that is then mixed into the output.
+// The buffers are allocated when the device is opened, longer requests are
+// rendered in parts.
+
+#define WORKER_BUFFER_SAMPLES 4096
+
+typedef struct
+{
+    SDL_Thread *thread;
+    SDL_sem *start;
+    SDL_sem *done;
+    opl3_chip *chip;
+    Bit16s *buffer;
+} opl_worker_t;
+
+static opl_worker_t workers[OPL_MAX_CHIPS - 1];
+static unsigned int worker_samples;
+static int workers_running;
+
+// Buffers shorter than this are cheaper to render on the calling thread.
+
+#define MIN_WORKER_SAMPLES 256
 
 // Timers; DBOPL does not do timer stuff itself.
 
@@ -85,6 +110,15 @@ static opl_timer_t timer2 = { 3125, 0, 0, 0 };
 
 static int mixing_freq, mixing_channels;
 
+// Held while the emulator generates samples, so that the audio thread and
+// an offline renderer never drive the chip at the same time.
+
+static SDL_mutex *render_mutex = NULL;
+
+// If set, audio output is taken from this function instead of the emulator.
+
+static opl_stream_func_t stream_func = NULL;
+
 // Advance time by the specified number of samples, invoking any
 // callback functions as appropriate.
 
@@ -138,16 +172,156 @@ static void AdvanceTime(unsigned int nsamples)
     SDL_UnlockMutex(callback_queue_mutex);
 }
 
+static int WorkerThread(void *data)
+{
+    opl_worker_t *worker = data;
+
+    for (;;)
+    {
+        SDL_SemWait(worker->start);
+
+        if (!workers_running)
+        {
+            break;
+        }
+
+        OPL3_GenerateStream(worker->chip, worker->buffer, worker_samples);
+
+        SDL_SemPost(worker->done);
+    }
+
+    return 0;
+}
+
+static int StartWorkers(void)
+{
+    unsigned int i;
+
+    for (i = 0; i + 1 < num_chips; ++i)
+    {
+        workers[i].buffer = malloc(WORKER_BUFFER_SAMPLES * 2 * sizeof(Bit16s));
+
+        if (workers[i].buffer == NULL)
+        {
+            while (i-- > 0)
+            {
+                free(workers[i].buffer);
+            }
+            return 0;
+        }
+    }
+
+    workers_running = 1;
+
+    for (i = 0; i + 1 < num_chips; ++i)
+    {
+        opl_worker_t *worker = &workers[i];
+
+        worker->chip = &opl_chips[i + 1];
+        worker->start = SDL_CreateSemaphore(0);
+        worker->done = SDL_CreateSemaphore(0);
+        worker->thread = SDL_CreateThread(WorkerThread, "OPL", worker);
+    }
+
+    return 1;
+}
+
+static void StopWorkers(void)
+{
+    unsigned int i;
+
+    workers_running = 0;
+
+    for (i = 0; i + 1 < num_chips; ++i)
+    {
+        opl_worker_t *worker = &workers[i];
+
+        SDL_SemPost(worker->start);
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->start);
+        SDL_DestroySemaphore(worker->done);
+        free(worker->buffer);
+    }
+}
+
+// Add one chip's output to the output buffer, with clipping.
+
+static void MixBuffer(Bit16s *output, const Bit16s *input,
+                      unsigned int nsamples)
+{
+    unsigned int i;
+
+    for (i = 0; i < nsamples * 2; ++i)
+    {
+        int sample = output[i] + input[i];
+
+        output[i] = sample > INT16_MAX ? INT16_MAX :
+                    sample < INT16_MIN ? INT16_MIN : sample;
+    }
+}
+
+// Generate and mix the output of all chips, at most WORKER_BUFFER_SAMPLES.
+
+static void FillBufferPart(uint8_t *buffer, unsigned int nsamples)
+{
+    unsigned int i;
+
+    worker_samples = nsamples;
+
+    if (nsamples >= MIN_WORKER_SAMPLES)
+    {
+        for (i = 0; i + 1 < num_chips; ++i)
+        {
+            SDL_SemPost(workers[i].start);
+        }
+
+        OPL3_GenerateStream(&opl_chips[0], (Bit16s *) buffer, nsamples);
+
+        for (i = 0; i + 1 < num_chips; ++i)
+        {
+            SDL_SemWait(workers[i].done);
+        }
+    }
+    else
+    {
+        OPL3_GenerateStream(&opl_chips[0], (Bit16s *) buffer, nsamples);
+
+        for (i = 0; i + 1 < num_chips; ++i)
+        {
+            OPL3_GenerateStream(workers[i].chip, workers[i].buffer, nsamples);
+        }
+    }
+
+    for (i = 0; i + 1 < num_chips; ++i)
+    {
+        MixBuffer((Bit16s *) buffer, workers[i].buffer, nsamples);
+    }
+}
+
 // Call the OPL emulator code to fill the specified buffer.
 
 static void FillBuffer(uint8_t *buffer, unsigned int nsamples)
 {
-    OPL3_GenerateStream(&opl_chip, (Bit16s *) buffer, nsamples);
+    if (num_chips == 1 || nsamples == 0)
+    {
+        OPL3_GenerateStream(&opl_chips[0], (Bit16s *) buffer, nsamples);
+        return;
+    }
+
+    while (nsamples > 0)
+    {
+        unsigned int part = nsamples < WORKER_BUFFER_SAMPLES ?
+                            nsamples : WORKER_BUFFER_SAMPLES;
+
+        FillBufferPart(buffer, part);
+        buffer += part * 4;
+        nsamples -= part;
+    }
 }
 
-// Callback function to fill a new sound buffer:
+// Generate emulator output, invoking callbacks as the time advances.
 
-static uint32_t OPL_Callback(uint8_t *buffer, uint32_t buffer_samples)
+static uint32_t RenderSamples(uint8_t *buffer, uint32_t buffer_samples)
 {
     unsigned int filled;
 
@@ -198,10 +372,38 @@ static uint32_t OPL_Callback(uint8_t *buffer, uint32_t buffer_samples)
     return buffer_samples;
 }
 
+// Callback function to fill a new sound buffer:
+
+static uint32_t OPL_Callback(uint8_t *buffer, uint32_t buffer_samples)
+{
+    opl_stream_func_t func;
+    uint32_t result = buffer_samples;
+
+    SDL_LockMutex(render_mutex);
+
+    func = stream_func;
+
+    if (func == NULL)
+    {
+        result = RenderSamples(buffer, buffer_samples);
+    }
+
+    SDL_UnlockMutex(render_mutex);
+
+    if (func != NULL)
+    {
+        result = func(buffer, buffer_samples);
+    }
+
+    return result;
+}
+
 static void OPL_SDL_Shutdown(void)
 {
     I_OAL_HookMusic(NULL);
 
+    StopWorkers();
+
     OPL_Queue_Destroy(callback_queue);
 
 /*
@@ -223,12 +425,22 @@ static void OPL_SDL_Shutdown(void)
         SDL_DestroyMutex(callback_queue_mutex);
         callback_queue_mutex = NULL;
     }
+
+    if (render_mutex != NULL)
+    {
+        SDL_DestroyMutex(render_mutex);
+        render_mutex = NULL;
+    }
+
+    stream_func = NULL;
 }
 
 int opl_gain = 200;
 
 static int OPL_SDL_Init(unsigned int port_base)
 {
+    unsigned int i;
+
     opl_sdl_paused = 0;
     pause_offset = 0;
 
@@ -243,19 +455,38 @@ static int OPL_SDL_Init(unsigned int port_base)
     mixing_channels = 2;
     mixing_freq = opl_sample_rate;
 
-    // Create the emulator structure:
+    // Create the emulator structures:
+
+    num_chips = opl_num_chips;
 
-    OPL3_Reset(&opl_chip, mixing_freq);
+    for (i = 0; i < num_chips; ++i)
+    {
+        OPL3_Reset(&opl_chips[i], mixing_freq);
+        register_num[i] = 0;
+    }
     opl_opl3mode = 0;
 
     callback_mutex = SDL_CreateMutex();
     callback_queue_mutex = SDL_CreateMutex();
+    render_mutex = SDL_CreateMutex();
+    stream_func = NULL;
+
+    if (!StartWorkers())
+    {
+        OPL_Queue_Destroy(callback_queue);
+        SDL_DestroyMutex(callback_mutex);
+        SDL_DestroyMutex(callback_queue_mutex);
+        SDL_DestroyMutex(render_mutex);
+        return 0;
+    }
 
     if (!I_OAL_HookMusic(OPL_Callback))
     {
+        StopWorkers();
         OPL_Queue_Destroy(callback_queue);
         SDL_DestroyMutex(callback_mutex);
         SDL_DestroyMutex(callback_queue_mutex);
+        SDL_DestroyMutex(render_mutex);
         return 0;
     }
 
@@ -268,6 +499,8 @@ static unsigned int OPL_SDL_PortRead(opl_port_t port)
 {
     unsigned int result = 0;
 
+    port &= 3;
+
     if (port == OPL_REGISTER_PORT_OPL3)
     {
         return 0xff;
@@ -303,8 +536,17 @@ static void OPLTimer_CalculateEndTime(opl_timer_t *timer)
     }
 }
 
-static void WriteRegister(unsigned int reg_num, unsigned int value)
+static void WriteRegister(unsigned int chip, unsigned int reg_num,
+                          unsigned int value)
 {
+    // Only the first chip drives the timers.
+
+    if (chip > 0)
+    {
+        OPL3_WriteRegBuffered(&opl_chips[chip], reg_num, value);
+        return;
+    }
+
     switch (reg_num)
     {
         case OPL_REG_TIMER1:
@@ -344,24 +586,33 @@ static void WriteRegister(unsigned int reg_num, unsigned int value)
             opl_opl3mode = value & 0x01;
 
         default:
-            OPL3_WriteRegBuffered(&opl_chip, reg_num, value);
+            OPL3_WriteRegBuffered(&opl_chips[0], reg_num, value);
             break;
     }
 }
 
 static void OPL_SDL_PortWrite(opl_port_t port, unsigned int value)
 {
+    unsigned int chip = port >> 2;
+
+    if (chip >= num_chips)
+    {
+        return;
+    }
+
+    port &= 3;
+
     if (port == OPL_REGISTER_PORT)
     {
-        register_num = value;
+        register_num[chip] = value;
     }
     else if (port == OPL_REGISTER_PORT_OPL3)
     {
-        register_num = value | 0x100;
+        register_num[chip] = value | 0x100;
     }
     else if (port == OPL_DATA_PORT)
     {
-        WriteRegister(register_num, value);
+        WriteRegister(chip, register_num[chip], value);
     }
 }
 
@@ -403,6 +654,24 @@ static void OPL_SDL_AdjustCallbacks(float factor)
     SDL_UnlockMutex(callback_queue_mutex);
 }
 
+static uint32_t OPL_SDL_Render(uint8_t *buffer, uint32_t nsamples)
+{
+    uint32_t result;
+
+    SDL_LockMutex(render_mutex);
+    result = RenderSamples(buffer, nsamples);
+    SDL_UnlockMutex(render_mutex);
+
+    return result;
+}
+
+static void OPL_SDL_SetStreamFunc(opl_stream_func_t func)
+{
+    SDL_LockMutex(render_mutex);
+    stream_func = func;
+    SDL_UnlockMutex(render_mutex);
+}
+
 opl_driver_t opl_sdl_driver =
 {
     "SDL",
@@ -416,5 +685,7 @@ opl_driver_t opl_sdl_driver =
     OPL_SDL_Unlock,
     OPL_SDL_SetPaused,
     OPL_SDL_AdjustCallbacks,
+    OPL_SDL_Render,
+    OPL_SDL_SetStreamFunc,
 };
 
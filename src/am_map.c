@@ -23,6 +23,7 @@
 #include "r_things.h"
 #include "p_setup.h"
 #include "p_maputl.h"
+#include "m_bbox.h"
 #include "w_wad.h"
 #include "i_video.h"
 #include "v_video.h"
@@ -1047,10 +1048,16 @@ void AM_Ticker (void)
 static void AM_clearFB(int color)
 {
   int h = f_h;
-  byte *src = I_VideoBuffer;
+  pixel_t *src = I_VideoBuffer;
   while (h--)
   {
+#ifdef TRUECOLOR
+    int x;
+    for (x = 0; x < f_w; x++)
+      src[x] = V_Pixel(color);
+#else
     memset(src, color, f_w);
+#endif
     src += video.pitch;
   }
 }
@@ -1230,7 +1237,7 @@ static void AM_drawFline_Vanilla(fline_t* fl, int color)
   }
 #endif
 
-#define PUTDOT(xx,yy,cc) I_VideoBuffer[(yy)*video.pitch+(xx)]=(cc)
+#define PUTDOT(xx,yy,cc) I_VideoBuffer[(yy)*video.pitch+(xx)]=V_Pixel(cc)
 
   dx = fl->b.x - fl->a.x;
   ax = 2 * (dx<0 ? -dx : dx);
@@ -1284,7 +1291,10 @@ static void AM_drawFline_Vanilla(fline_t* fl, int color)
 //
 static void AM_putWuDot(int x, int y, int color, int weight)
 {
-   byte *dest = &I_VideoBuffer[y * video.pitch + x];
+   pixel_t *dest = &I_VideoBuffer[y * video.pitch + x];
+#ifdef TRUECOLOR
+   *dest = V_BlendPixels(V_Pixel(color), *dest, weight * 4);
+#else
    unsigned int *fg2rgb = Col2RGB8[weight];
    unsigned int *bg2rgb = Col2RGB8[64 - weight];
    unsigned int fg, bg;
@@ -1293,6 +1303,7 @@ static void AM_putWuDot(int x, int y, int color, int weight)
    bg = bg2rgb[*dest];
    fg = (fg + bg) | 0x1f07c1f;
    *dest = RGB32k[0][0][fg & (fg >> 15)];
+#endif
 }
 
 
@@ -1555,6 +1566,191 @@ static int AM_DoorColor(int type)
   return -1;     //not a keyed door
 }
 
+//
+// Automap line grid
+//
+// The lines overlapping each cell of a coarse grid, so that only lines near
+// the visible window have to be looked at when zoomed in on a large map.
+// Built on first use and freed with the level.
+//
+
+#define AM_GRIDSHIFT (FRACBITS + 8) // 256 units per cell
+
+static int *amgrid;         // cell start offsets into amgrid_lines
+static int *amgrid_lines;   // line numbers, in line order within a cell
+static int *amgrid_visible; // visible line numbers, in line order
+static uint32_t *amgrid_mark; // one bit per line
+static int64_t amgrid_orgx, amgrid_orgy;
+static int amgrid_width, amgrid_height;
+
+static int AM_gridCell(int64_t v, int64_t org, int size)
+{
+  v = (v - org) >> AM_GRIDSHIFT;
+  return v < 0 ? 0 : v >= size ? size - 1 : (int) v;
+}
+
+static void AM_buildLineGrid(void)
+{
+  int64_t maxx = INT64_MIN, maxy = INT64_MIN;
+  int i, x, y, ncells, total, words;
+  int *count;
+
+  amgrid_orgx = amgrid_orgy = INT64_MAX;
+
+  for (i = 0; i < numvertexes; i++)
+  {
+    amgrid_orgx = MIN(amgrid_orgx, vertexes[i].x);
+    amgrid_orgy = MIN(amgrid_orgy, vertexes[i].y);
+    maxx = MAX(maxx, vertexes[i].x);
+    maxy = MAX(maxy, vertexes[i].y);
+  }
+
+  if (!numvertexes)
+    amgrid_orgx = amgrid_orgy = maxx = maxy = 0;
+
+  amgrid_width = (int) ((maxx - amgrid_orgx) >> AM_GRIDSHIFT) + 1;
+  amgrid_height = (int) ((maxy - amgrid_orgy) >> AM_GRIDSHIFT) + 1;
+  ncells = amgrid_width * amgrid_height;
+
+  // count the lines in each cell, then turn the counts into offsets
+
+  count = Z_Calloc(ncells + 1, sizeof(*count), PU_STATIC, NULL);
+
+  for (i = 0; i < numlines; i++)
+  {
+    const fixed_t *bbox = lines[i].bbox;
+    const int x1 = AM_gridCell(bbox[BOXLEFT], amgrid_orgx, amgrid_width);
+    const int x2 = AM_gridCell(bbox[BOXRIGHT], amgrid_orgx, amgrid_width);
+    const int y1 = AM_gridCell(bbox[BOXBOTTOM], amgrid_orgy, amgrid_height);
+    const int y2 = AM_gridCell(bbox[BOXTOP], amgrid_orgy, amgrid_height);
+
+    for (y = y1; y <= y2; y++)
+      for (x = x1; x <= x2; x++)
+        count[y * amgrid_width + x]++;
+  }
+
+  for (i = 0, total = 0; i <= ncells; i++)
+  {
+    const int n = count[i];
+    count[i] = total;
+    total += n;
+  }
+
+  words = (numlines + 31) / 32;
+
+  Z_Malloc((ncells + 1 + total + numlines) * sizeof(int)
+           + words * sizeof(uint32_t), PU_LEVEL, (void **) &amgrid);
+  amgrid_lines = amgrid + ncells + 1;
+  amgrid_visible = amgrid_lines + total;
+  amgrid_mark = (uint32_t *) (amgrid_visible + numlines);
+
+  memcpy(amgrid, count, (ncells + 1) * sizeof(*amgrid));
+  memset(amgrid_mark, 0, words * sizeof(uint32_t));
+
+  for (i = 0; i < numlines; i++)
+  {
+    const fixed_t *bbox = lines[i].bbox;
+    const int x1 = AM_gridCell(bbox[BOXLEFT], amgrid_orgx, amgrid_width);
+    const int x2 = AM_gridCell(bbox[BOXRIGHT], amgrid_orgx, amgrid_width);
+    const int y1 = AM_gridCell(bbox[BOXBOTTOM], amgrid_orgy, amgrid_height);
+    const int y2 = AM_gridCell(bbox[BOXTOP], amgrid_orgy, amgrid_height);
+
+    for (y = y1; y <= y2; y++)
+      for (x = x1; x <= x2; x++)
+        amgrid_lines[count[y * amgrid_width + x]++] = i;
+  }
+
+  Z_Free(count);
+}
+
+//
+// AM_visibleBox()
+//
+// Bounding box of the visible part of the map, in fixed point map
+// coordinates. With rotation, anything within half the window's
+// diagonal of the center may come into view.
+//
+
+static void AM_visibleBox(int64_t *box)
+{
+  int64_t x1 = m_x, y1 = m_y, x2 = m_x2, y2 = m_y2;
+
+  if (automaprotate)
+  {
+    const int64_t r = (m_w + m_h) / 2;
+
+    x1 = mapcenter.x - r;
+    x2 = mapcenter.x + r;
+    y1 = mapcenter.y - r;
+    y2 = mapcenter.y + r;
+  }
+
+  box[BOXLEFT] = x1 << FRACTOMAPBITS;
+  box[BOXRIGHT] = x2 << FRACTOMAPBITS;
+  box[BOXBOTTOM] = y1 << FRACTOMAPBITS;
+  box[BOXTOP] = y2 << FRACTOMAPBITS;
+}
+
+//
+// AM_visibleLines()
+//
+// Collects the lines that may be visible into amgrid_visible, in line
+// order so that overlapping lines are drawn as before. Returns -1 when
+// the window covers so much of the map that walking all lines is cheaper.
+//
+
+static int AM_visibleLines(void)
+{
+  int64_t box[4];
+  int x1, x2, y1, y2, x, y, i, n, cost = 0;
+  const int words = (numlines + 31) / 32;
+
+  if (!amgrid)
+    AM_buildLineGrid();
+
+  AM_visibleBox(box);
+
+  if (box[BOXRIGHT] < amgrid_orgx || box[BOXTOP] < amgrid_orgy ||
+      box[BOXLEFT] >= amgrid_orgx + ((int64_t) amgrid_width << AM_GRIDSHIFT) ||
+      box[BOXBOTTOM] >= amgrid_orgy + ((int64_t) amgrid_height << AM_GRIDSHIFT))
+    return 0;
+
+  x1 = AM_gridCell(box[BOXLEFT], amgrid_orgx, amgrid_width);
+  x2 = AM_gridCell(box[BOXRIGHT], amgrid_orgx, amgrid_width);
+  y1 = AM_gridCell(box[BOXBOTTOM], amgrid_orgy, amgrid_height);
+  y2 = AM_gridCell(box[BOXTOP], amgrid_orgy, amgrid_height);
+
+  // cells of a row are contiguous, so their entries are too
+
+  for (y = y1; y <= y2; y++)
+    cost += amgrid[y * amgrid_width + x2 + 1] - amgrid[y * amgrid_width + x1];
+
+  if (cost >= numlines)
+    return -1;
+
+  for (y = y1; y <= y2; y++)
+  {
+    const int *p = amgrid_lines + amgrid[y * amgrid_width + x1];
+    const int *end = amgrid_lines + amgrid[y * amgrid_width + x2 + 1];
+
+    for (; p < end; p++)
+      amgrid_mark[*p >> 5] |= 1u << (*p & 31);
+  }
+
+  for (i = 0, n = 0; i < words; i++)
+  {
+    uint32_t bits = amgrid_mark[i];
+
+    for (x = i << 5; bits; x++, bits >>= 1)
+      if (bits & 1)
+        amgrid_visible[n++] = x;
+
+    amgrid_mark[i] = 0;
+  }
+
+  return n;
+}
+
 //
 // Determines visible lines, draws them.
 // This is LineDef based, not LineSeg based.
@@ -1573,14 +1769,22 @@ static int AM_DoorColor(int type)
 //
 static void AM_drawWalls(void)
 {
-  int i;
+  int i, k;
   static mline_t l;
 
   const boolean keyed_door_flash = map_keyed_door_flash && (leveltime & 16);
 
+  int count = AM_visibleLines();
+  const boolean all = (count < 0);
+
+  if (all)
+    count = numlines;
+
   // draw the unclipped visible portions of all lines
-  for (i=0;i<numlines;i++)
+  for (k=0;k<count;k++)
   {
+    i = all ? k : amgrid_visible[k];
+
     l.a.x = lines[i].v1->x >> FRACTOMAPBITS;
     l.a.y = lines[i].v1->y >> FRACTOMAPBITS;
     l.b.x = lines[i].v2->x >> FRACTOMAPBITS;
@@ -2008,10 +2212,27 @@ static void AM_drawThings
   int   i;
   mobj_t* t;
   mpoint_t pt;
+  int64_t box[4];
+  int bx1, bx2, by1, by2;
+
+  // skip sectors whose blockmap box is out of view, allowing one more
+  // block for the size of the things drawn
+
+  AM_visibleBox(box);
+  bx1 = (int) ((box[BOXLEFT] - bmaporgx) >> MAPBLOCKSHIFT) - 1;
+  bx2 = (int) ((box[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT) + 1;
+  by1 = (int) ((box[BOXBOTTOM] - bmaporgy) >> MAPBLOCKSHIFT) - 1;
+  by2 = (int) ((box[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT) + 1;
 
   // for all sectors
   for (i=0;i<numsectors;i++)
   {
+    const int *bbox = sectors[i].blockbox;
+
+    if (bbox[BOXRIGHT] < bx1 || bbox[BOXLEFT] > bx2 ||
+        bbox[BOXTOP] < by1 || bbox[BOXBOTTOM] > by2)
+      continue;
+
     t = sectors[i].thinglist;
     while (t) // for all things in that sector
     {
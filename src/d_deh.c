@@ -1630,6 +1630,19 @@ deh_bexptr deh_bexptrs[] =
   {{NULL},             "A_NULL"},  // Ty 05/16/98
 };
 
+// [Woof!] name of a code pointer, or NULL if it is not in the list
+
+const char *deh_GetCodePointerName(actionf_t cptr)
+{
+  int i;
+
+  for (i = 0; deh_bexptrs[i].cptr.v != NULL; i++)
+    if (deh_bexptrs[i].cptr.v == cptr.v)
+      return deh_bexptrs[i].lookup;
+
+  return NULL;
+}
+
 extern byte *defined_codeptr_args;
 
 // to hold startup code pointers from INFO.C
@@ -27,6 +27,8 @@
 #ifndef __D_DEH__
 #define __D_DEH__
 
+#include "d_think.h"
+
 //
 //      Ty 03/22/98 - note that we are keeping the english versions and
 //      comments in this file
@@ -860,6 +862,9 @@ extern char *s_OB_MPPLASMARIFLE;
 extern char *s_OB_MPBFG_BOOM;
 extern char *s_OB_MPTELEFRAG;
 
+// [Woof!] name of a code pointer, for the playsim profiler
+const char *deh_GetCodePointerName(actionf_t cptr);
+
 #endif
 
 //--------------------------------------------------------------------
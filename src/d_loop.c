@@ -36,7 +36,7 @@
 #include "net_io.h"
 #include "net_query.h"
 #include "net_server.h"
-#include "net_sdl.h"
+#include "net_udp.h"
 #include "net_loop.h"
 
 #include "s_sound.h"
@@ -447,7 +447,7 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
     {
         NET_SV_Init();
         NET_SV_AddModule(&net_loop_server_module);
-        NET_SV_AddModule(&net_sdl_module);
+        NET_SV_AddModule(NET_UDPModule());
         NET_SV_RegisterWithMaster();
 
         net_loop_client_module.InitClient();
@@ -489,8 +489,8 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
 
         if (i > 0)
         {
-            net_sdl_module.InitClient();
-            addr = net_sdl_module.ResolveAddress(myargv[i+1]);
+            NET_UDPModule()->InitClient();
+            addr = NET_UDPModule()->ResolveAddress(myargv[i+1]);
             NET_ReferenceAddress(addr);
 
             if (addr == NULL)
@@ -558,7 +558,7 @@ void D_QuitNetGame (void)
 {
     NET_SV_Shutdown();
     NET_CL_Disconnect();
-    net_sdl_module.Shutdown();
+    NET_UDPModule()->Shutdown();
 }
 
 static int GetLowTic(void)
@@ -40,12 +40,14 @@
 #include "m_misc2.h" // [FG] M_StringDuplicate()
 #include "m_menu.h"
 #include "m_io.h"
+#include "m_trace.h"
 #include "m_swap.h"
 #include "i_printf.h"
 #include "i_system.h"
 #include "i_sound.h"
 #include "i_video.h"
 #include "g_game.h"
+#include "g_demopack.h"
 #include "hu_stuff.h"
 #include "wi_stuff.h"
 #include "st_stuff.h"
@@ -61,6 +63,7 @@
 #include "u_mapinfo.h" // U_ParseMapInfo()
 #include "i_glob.h" // [FG] I_StartMultiGlob()
 #include "p_map.h" // MELEERANGE
+#include "p_prof.h"
 #include "i_endoom.h"
 #include "d_quit.h"
 #include "r_bmaps.h"
@@ -678,11 +681,14 @@ char **tempdirs = NULL;
 
 static void AutoLoadWADs(const char *path);
 
-static boolean D_AddZipFile(const char *file)
+// [Woof!] Lumps are read from the archive itself by W_AddFile(), only nested
+// WADs and voxels, which are loaded by file name, are extracted.
+
+static boolean D_AddZipFile(char *file)
 {
   int i;
   mz_zip_archive zip_archive;
-  char *str, *tempdir, counter[8];
+  char *str, *tempdir = NULL, counter[8];
 
   if (!CheckExtensions(file, ".zip", ".pk3", NULL))
   {
@@ -695,12 +701,6 @@ static boolean D_AddZipFile(const char *file)
     I_Error("D_AddZipFile: Failed to open %s", file);
   }
 
-  M_snprintf(counter, sizeof(counter), "%04d", array_size(tempdirs));
-  str = M_StringJoin("_", counter, "_", PROJECT_SHORTNAME, "_", M_BaseName(file), NULL);
-  tempdir = M_TempFile(str);
-  free(str);
-  M_MakeDirectory(tempdir);
-
   for (i = 0; i < (int)mz_zip_reader_get_num_files(&zip_archive); ++i)
   {
     mz_zip_archive_file_stat file_stat;
@@ -717,10 +717,21 @@ static boolean D_AddZipFile(const char *file)
     if (name[0] == '.')
       continue;
 
-    if (CheckExtensions(name, ".wad", ".pk3", ".lmp", ".ogg", ".flac",
-                        ".mp3", ".kvx", NULL))
+    if (CheckExtensions(name, ".wad", ".pk3", ".zip", ".kvx", NULL))
     {
-      char *dest = M_StringJoin(tempdir, DIR_SEPARATOR_S, name, NULL);
+      char *dest;
+
+      if (!tempdir)
+      {
+        M_snprintf(counter, sizeof(counter), "%04d", array_size(tempdirs));
+        str = M_StringJoin("_", counter, "_", PROJECT_SHORTNAME, "_",
+                           M_BaseName(file), NULL);
+        tempdir = M_TempFile(str);
+        free(str);
+        M_MakeDirectory(tempdir);
+      }
+
+      dest = M_StringJoin(tempdir, DIR_SEPARATOR_S, name, NULL);
 
       if (!mz_zip_reader_extract_to_file(&zip_archive, i, dest, 0))
       {
@@ -734,9 +745,13 @@ static boolean D_AddZipFile(const char *file)
 
   mz_zip_reader_end(&zip_archive);
 
-  AutoLoadWADs(tempdir);
+  if (tempdir)
+  {
+    AutoLoadWADs(tempdir);
+    array_push(tempdirs, tempdir);
+  }
 
-  array_push(tempdirs, tempdir);
+  array_push(wadfiles, file);
 
   return true;
 }
@@ -1408,6 +1423,11 @@ static boolean FileIsDemoLump(const char *filename)
         return false;
     }
 
+    if (G_IsPackedDemo(buf, count))
+    {
+        return true;
+    }
+
     ver = *p++;
 
     if (ver == 255) // skip UMAPINFO demo header
@@ -2072,6 +2092,102 @@ static boolean CheckHaveSSG (void)
   return true;
 }
 
+//
+// D_AddFileParms
+// Adds the files given with -file to the wad list. Returns the index of
+// the first of them, or 0 if there are none.
+//
+
+static int D_AddFileParms(void)
+{
+  int p, mainwadfile = 0;
+
+  //!
+  // @arg <files>
+  // @vanilla
+  // @help
+  //
+  // Load the specified PWAD files.
+  //
+
+  if ((p = M_CheckParm ("-file")))
+    {
+      // the parms after p are wadfile/lump names,
+      // until end of parms or another - preceded parm
+      // killough 11/98: allow multiple -file parameters
+
+      boolean file = modifiedgame = true;            // homebrew levels
+      mainwadfile = array_size(wadfiles);
+      while (++p < myargc)
+        if (*myargv[p] == '-')
+          file = !strcasecmp(myargv[p],"-file");
+        else
+          if (file)
+            D_AddFile(myargv[p]);
+    }
+
+  return mainwadfile;
+}
+
+//
+// D_InitHeadless
+//
+// Brings up the WAD, DEHACKED and refresh/playsim state without video,
+// sound, input or networking. Used by the woof-bench target, which runs
+// engine code outside of the main loop.
+//
+
+void D_InitHeadless(void)
+{
+  I_AtExitPrio(I_ErrorMsg, true, "I_ErrorMsg", exit_priority_verylast);
+
+  sprintf(savegamename = malloc(16), "%.4ssav", D_DoomExeName());
+
+  IdentifyVersion();
+  InitGameVersion();
+  dsdh_InitTables();
+  D_InitTables();
+
+  modifiedgame = false;
+  D_AddFileParms();
+
+  nodrawers = noblit = true;
+  nosfxparm = nomusicparm = true;
+  idmusnum = -1;
+
+  M_LoadDefaults();
+
+  bodyquesize = default_bodyquesize;
+
+  W_InitMultipleFiles();
+
+  if (!M_ParmExists("-nodeh"))
+  {
+    D_ProcessInWads("DEHACKED", ProcessDehLump, true);
+    D_ProcessInWads("DEHACKED", ProcessDehLump, false);
+  }
+
+  PostProcessDeh();
+
+  D_ProcessInWads("BRGHTMPS", R_ParseBrightmaps, false);
+
+  G_ReloadDefaults(false);
+
+  D_ProcessInWads("UMAPDEF", U_ParseMapDefInfo, false);
+  D_ProcessInWads("UMAPINFO", U_ParseMapInfo, false);
+
+  V_InitColorTranslation();
+
+  R_Init();
+  P_Init();
+  I_InitTimer();
+
+  // P_SetupLevel() starts the sound, status bar and HUD for the level.
+  S_Init(snd_SfxVolume, snd_MusicVolume);
+  HU_Init();
+  ST_Init();
+}
+
 //
 // D_DoomMain
 //
@@ -2297,29 +2413,7 @@ void D_DoomMain(void)
 
   // killough 1/31/98, 5/2/98: reload hack removed, -wart same as -warp now.
 
-  //!
-  // @arg <files>
-  // @vanilla
-  // @help
-  //
-  // Load the specified PWAD files.
-  //
-
-  if ((p = M_CheckParm ("-file")))
-    {
-      // the parms after p are wadfile/lump names,
-      // until end of parms or another - preceded parm
-      // killough 11/98: allow multiple -file parameters
-
-      boolean file = modifiedgame = true;            // homebrew levels
-      mainwadfile = array_size(wadfiles);
-      while (++p < myargc)
-        if (*myargv[p] == '-')
-          file = !strcasecmp(myargv[p],"-file");
-        else
-          if (file)
-            D_AddFile(myargv[p]);
-    }
+  mainwadfile = D_AddFileParms();
 
   // add wad files from autoload PWAD directories
 
@@ -2542,6 +2636,10 @@ void D_DoomMain(void)
 
   noblit = M_CheckParm ("-noblit");
 
+  P_InitProfile();
+
+  M_InitTrace();
+
   // jff 4/21/98 allow writing predefined lumps out as a wad
 
   //!
@@ -2968,11 +3066,17 @@ void D_DoomMain(void)
       // frame syncronous IO operations
       I_StartFrame ();
 
+      TRACE_BEGIN("TryRunTics");
       TryRunTics (); // will run at least one tic
+      TRACE_END();
 
       // Update display, next frame, with current state.
       if (screenvisible)
+      {
+        TRACE_BEGIN("D_Display");
         D_Display();
+        TRACE_END();
+      }
 
       S_UpdateMusic();
     }
@@ -60,6 +60,9 @@ void D_PageDrawer(void);
 void D_AdvanceDemo(void);
 void D_StartTitle(void);
 
+// Startup without video, sound, input or networking, for woof-bench.
+void D_InitHeadless(void);
+
 #endif
 
 //----------------------------------------------------------------------------
@@ -22,6 +22,8 @@
 #ifndef __D_THINK__
 #define __D_THINK__
 
+#include "doomtype.h"
+
 typedef void (*actionf_v)();
 typedef void (*actionf_p1)(void *);
 typedef void (*actionf_p2)(void *, void *);
@@ -51,6 +53,14 @@ typedef struct thinker_s
   // killough 11/98: count of how many other objects reference
   // this one using pointers. Used for garbage collection.
   unsigned references;
+
+  // [Woof!] set by P_RemoveThinker() for mobjs, which are returned to
+  // their pool by P_FreeMobj() instead of being freed with Z_Free()
+  boolean pooled;
+
+  // [Woof!] set for mobjs at rest, which P_RunThinkers() skips until
+  // something moves them or changes their state
+  boolean dormant;
 } thinker_t;
 
 #endif
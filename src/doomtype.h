@@ -29,7 +29,13 @@
 typedef enum {false, true} boolean;
 
 typedef uint8_t byte;
+
+// [Woof!] The true-colour build (WOOF_TRUECOLOR) draws ARGB8888 pixels.
+#ifdef TRUECOLOR
+typedef uint32_t pixel_t;
+#else
 typedef uint8_t pixel_t;
+#endif
 
 // haleyjd: resolve platform-specific range symbol issues
 
@@ -37,20 +37,27 @@ static int num_columns;
 // SCREEN WIPE PACKAGE
 //
 
-static byte *wipe_scr_start;
-static byte *wipe_scr_end;
-static byte *wipe_scr;
+static pixel_t *wipe_scr_start;
+static pixel_t *wipe_scr_end;
+static pixel_t *wipe_scr;
 
-static void wipe_shittyColMajorXform(byte *array, int width, int height)
+// Start and end screens are kept from one wipe to the next and only
+// reallocated when the resolution changes.
+static int wipe_scr_start_size;
+static int wipe_scr_end_size;
+
+static pixel_t *wipe_allocScreen(pixel_t *scr, int *size)
 {
-  byte *dest = Z_Malloc(width*height, PU_STATIC, 0);
-  int x, y;
-
-  for(y=0;y<height;y++)
-    for(x=0;x<width;x++)
-      dest[x*height+y] = array[y*width+x];
-  memcpy(array, dest, width*height);
-  Z_Free(dest);
+  const int newsize = video.width * video.height;
+
+  if (*size != newsize)
+  {
+    Z_Free(scr);
+    scr = Z_Malloc(newsize * sizeof(*scr), PU_STATIC, NULL);
+    *size = newsize;
+  }
+
+  return scr;
 }
 
 static int wipe_initColorXForm(int width, int height, int ticks)
@@ -60,22 +67,25 @@ static int wipe_initColorXForm(int width, int height, int ticks)
 }
 
 // killough 3/5/98: reformatted and cleaned up
+// Branch-free, so that compilers can vectorize the loop.
+// [Woof!] Steps each byte, i.e. each colour channel of true-colour pixels.
 static int wipe_doColorXForm(int width, int height, int ticks)
 {
-  boolean unchanged = true;
-  byte *w   = wipe_scr;
-  byte *e   = wipe_scr_end;
-  byte *end = wipe_scr+width*height;
-  for (;w != end; w++, e++)
-    if (*w != *e)
-      {
-        int newval;
-        unchanged = false;
-        *w = *w > *e ?
-          (newval = *w - ticks) < *e ? *e : newval :
-          (newval = *w + ticks) > *e ? *e : newval ;
-      }
-  return unchanged;
+  byte *w = (byte *) wipe_scr;
+  const byte *e = (const byte *) wipe_scr_end;
+  const int size = width * height * sizeof(pixel_t);
+  int changed = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    {
+      const int a = w[i], b = e[i];
+      const int up = a + ticks < b ? a + ticks : b;
+      const int down = a - ticks > b ? a - ticks : b;
+      changed |= a ^ b;
+      w[i] = a < b ? up : down;
+    }
+  return !changed;
 }
 
 static int wipe_exitColorXForm(int width, int height, int ticks)
@@ -83,7 +93,11 @@ static int wipe_exitColorXForm(int width, int height, int ticks)
   return 0;
 }
 
+// Position of each falling column, and the row it has moved down the start
+// screen by, in screen pixels. Kept from one wipe to the next.
 static int *col_y;
+static int *col_offset;
+static int col_size;
 
 static int wipe_initMelt(int width, int height, int ticks)
 {
@@ -91,16 +105,17 @@ static int wipe_initMelt(int width, int height, int ticks)
 
   num_columns = video.unscaledw / 2;
 
-  col_y = Z_Malloc(num_columns * sizeof(*col_y), PU_STATIC, NULL);
+  if (num_columns > col_size)
+  {
+    Z_Free(col_y);
+    col_y = Z_Malloc(2 * num_columns * sizeof(*col_y), PU_STATIC, NULL);
+    col_offset = col_y + num_columns;
+    col_size = num_columns;
+  }
 
   // copy start screen to main screen
   V_PutBlock(0, 0, width, height, wipe_scr_start);
 
-  // makes this wipe faster (in theory)
-  // to have stuff in column-major format
-  wipe_shittyColMajorXform(wipe_scr_start, width, height);
-  wipe_shittyColMajorXform(wipe_scr_end, width, height);
-
   // setup initial column positions (y<0 => not ready to scroll yet)
   col_y[0] = -(M_Random()%16);
   for (i=1;i<num_columns;i++)
@@ -116,6 +131,12 @@ static int wipe_initMelt(int width, int height, int ticks)
   return 0;
 }
 
+// Row y of a falling column: the end screen shows above the column's
+// offset, the start screen moved down by the offset below it.
+
+#define MELT_ROW(x, y) ((y) < col_offset[x] ? \
+  wipe_scr_end + (y) * width : wipe_scr_start + ((y) - col_offset[x]) * width)
+
 static int wipe_doMelt(int width, int height, int ticks)
 {
   boolean done = true;
@@ -140,52 +161,79 @@ static int wipe_doMelt(int width, int height, int ticks)
   xfactor = (width + num_columns - 1) / num_columns;
   yfactor = (height + COLUMN_MAX_Y - 1) / COLUMN_MAX_Y;
 
-  for (x = 0; x < width; x++)
+  for (x = 0; x < num_columns; x++)
   {
-    byte *s, *d;
-    int scroff = col_y[x / xfactor] * yfactor;
-    if (scroff > height)
-      scroff = height;
-
-    d = wipe_scr + x;
-    s = wipe_scr_end + x * height;
-    for (y = 0; y < scroff; ++y)
+    const int scroff = col_y[x] * yfactor;
+    col_offset[x] = scroff < 0 ? 0 : scroff > height ? height : scroff;
+  }
+
+  // Columns only a few pixels wide are cheaper to copy a pixel column at
+  // a time.
+
+  if (xfactor < 4)
+  {
+    for (x = 0; x < width; x++)
     {
-      *d = *s;
-      d += video.pitch;
-      s++;
+      const int off = col_offset[x / xfactor];
+      pixel_t *d = wipe_scr + x;
+      const pixel_t *s = wipe_scr_end + x;
+
+      for (y = 0; y < off; y++, d += video.pitch, s += width)
+        *d = *s;
+
+      s = wipe_scr_start + x;
+      for (; y < height; y++, d += video.pitch, s += width)
+        *d = *s;
     }
-    s = wipe_scr_start + x * height;
-    for (; y < height; ++y)
+    return done;
+  }
+
+  // Otherwise copy row by row. Neighbouring columns that read the same
+  // source row are copied together.
+
+  for (y = 0; y < height; y++)
+  {
+    pixel_t *dest = wipe_scr + y * video.pitch;
+    int col = 0;
+
+    x = 0;
+    while (x < width)
     {
-      *d = *s;
-      d += video.pitch;
-      s++;
+      const pixel_t *src = MELT_ROW(col, y);
+      const int start = x;
+
+      do
+      {
+        x += xfactor;
+        col++;
+      } while (x < width && MELT_ROW(col, y) == src);
+
+      if (x > width)
+        x = width;
+
+      memcpy(dest + start, src + start, (x - start) * sizeof(*dest));
     }
   }
   return done;
 }
 
+#undef MELT_ROW
+
 static int wipe_exitMelt(int width, int height, int ticks)
 {
-  Z_Free(col_y);
-  Z_Free(wipe_scr_start);
-  Z_Free(wipe_scr_end);
   return 0;
 }
 
 int wipe_StartScreen(int x, int y, int width, int height)
 {
-  int size = video.width * video.height;
-  wipe_scr_start = Z_Malloc(size * sizeof(*wipe_scr_start), PU_STATIC, NULL);
+  wipe_scr_start = wipe_allocScreen(wipe_scr_start, &wipe_scr_start_size);
   I_ReadScreen(wipe_scr_start);
   return 0;
 }
 
 int wipe_EndScreen(int x, int y, int width, int height)
 {
-  int size = video.width * video.height;
-  wipe_scr_end = Z_Malloc(size * sizeof(*wipe_scr_end), PU_STATIC, NULL);
+  wipe_scr_end = wipe_allocScreen(wipe_scr_end, &wipe_scr_end_size);
   I_ReadScreen(wipe_scr_end);
   V_DrawBlock(x, y, width, height, wipe_scr_start); // restore start scr.
   return 0;
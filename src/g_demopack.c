@@ -0,0 +1,599 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Packed demo container.
+//
+//      A packed demo wraps a plain demo. The header before the first tic
+//      and everything from the DEMOMARKER on (the footer) are stored as
+//      they are. Tics are packed in blocks of up to TICSPERBLOCK tics,
+//      one column per player and ticcmd field. Each column holds the
+//      differences between consecutive values, run-length coded, so
+//      constant movement and idle players take almost no space. Tics
+//      that don't get smaller that way are stored as they are.
+//
+//      File:   magic[4] version playerscount ticsize 0
+//      Block:  type count[4] length[4] data[length] crc32[4]
+//
+//      The CRC covers the type, count, length and data of a block. The
+//      count of a tic block is its number of tics, for a stored block it
+//      equals the length. Blocks don't depend on each other, so a
+//      damaged or truncated demo still plays up to the damage.
+//
+//      Column data is a sequence of runs, each starting with a varint
+//      control word. (control >> 1) + 1 is the length of the run. An odd
+//      control word is followed by that many values, an even one by a
+//      single value that is repeated. Values are zigzag varints of the
+//      difference to the previous value in the column, starting from 0
+//      in every block.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "g_demopack.h"
+
+#include "doomdef.h"
+#include "i_printf.h"
+#include "m_array.h"
+#include "z_zone.h"
+
+#include "../miniz/miniz.h"
+
+#define DEMOMARKER 0x80
+
+#define PACK_VERSION      1
+#define PACK_HEADERSIZE   8
+#define BLOCK_HEADERSIZE  9
+#define BLOCK_CRCSIZE     4
+#define TICSPERBLOCK      2048
+
+#define BLOCK_STORED  'S'
+#define BLOCK_TICS    'T'
+
+static const byte packmagic[4] = {'W', 'P', 'K', 'D'};
+
+typedef struct
+{
+    int offset;
+    int width;
+} field_t;
+
+// forwardmove, sidemove, angleturn, buttons
+
+static const field_t shortfields[] = { {0, 1}, {1, 1}, {2, 1}, {3, 1} };
+static const field_t longfields[] = { {0, 1}, {1, 1}, {2, 2}, {4, 1} };
+
+#define NUMFIELDS arrlen(shortfields)
+
+typedef enum
+{
+    pack_header,
+    pack_tics,
+    pack_rest
+} packstate_t;
+
+struct demopack_s
+{
+    writer_t *writer;
+    packstate_t state;
+    int headersize;
+    int playerscount;
+    int ticsize;       // one player
+    int ticbytes;      // all players
+    const field_t *fields;
+    byte *raw;         // plain data of the current block
+    byte *packed;      // packed columns of the current tic block
+};
+
+static void PutLong(byte *p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static unsigned int GetLong(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static int GetField(const byte *p, const field_t *field)
+{
+    return field->width == 1 ? p[0] : p[0] | (p[1] << 8);
+}
+
+static void SetField(byte *p, const field_t *field, int value)
+{
+    p[0] = value & 0xff;
+
+    if (field->width == 2)
+    {
+        p[1] = (value >> 8) & 0xff;
+    }
+}
+
+//
+// Packing
+//
+
+static void PutVarint(demopack_t *pack, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        array_push(pack->packed, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    array_push(pack->packed, value);
+}
+
+static void WriteBlock(demopack_t *pack, int type, int count,
+                       const byte *data, int length)
+{
+    byte header[BLOCK_HEADERSIZE], crc[BLOCK_CRCSIZE];
+    mz_ulong sum;
+
+    header[0] = type;
+    PutLong(header + 1, count);
+    PutLong(header + 5, length);
+
+    sum = mz_crc32(MZ_CRC32_INIT, header, sizeof(header));
+    if (length)
+    {
+        sum = mz_crc32(sum, data, length);
+    }
+    PutLong(crc, sum);
+
+    M_WriteBuffered(pack->writer, header, sizeof(header));
+    M_WriteBuffered(pack->writer, data, length);
+    M_WriteBuffered(pack->writer, crc, sizeof(crc));
+}
+
+static void PutLiterals(demopack_t *pack, const unsigned int *values,
+                        int count)
+{
+    int i;
+
+    if (!count)
+    {
+        return;
+    }
+
+    PutVarint(pack, ((count - 1) << 1) | 1);
+
+    for (i = 0; i < count; ++i)
+    {
+        PutVarint(pack, values[i]);
+    }
+}
+
+static void PackColumn(demopack_t *pack, int count, int offset,
+                       const field_t *field)
+{
+    static unsigned int values[TICSPERBLOCK];
+    const int mask = (1 << (8 * field->width)) - 1;
+    const int half = (mask + 1) / 2;
+    const byte *p = pack->raw + offset + field->offset;
+    int i, literals, previous = 0;
+
+    for (i = 0; i < count; ++i, p += pack->ticbytes)
+    {
+        const int value = GetField(p, field);
+        int delta = (value - previous) & mask;
+
+        if (delta >= half)
+        {
+            delta -= mask + 1;
+        }
+
+        values[i] = delta >= 0 ? 2 * delta : -2 * delta - 1;
+        previous = value;
+    }
+
+    for (i = literals = 0; i < count; )
+    {
+        int run = 1;
+
+        while (i + run < count && values[i + run] == values[i])
+        {
+            ++run;
+        }
+
+        if (run < 2)
+        {
+            ++i;
+            continue;
+        }
+
+        PutLiterals(pack, values + literals, i - literals);
+        PutVarint(pack, (run - 1) << 1);
+        PutVarint(pack, values[i]);
+        i += run;
+        literals = i;
+    }
+
+    PutLiterals(pack, values + literals, count - literals);
+}
+
+// Pack the first count tics of the raw buffer into a tic block.
+
+static void PackTics(demopack_t *pack, int count)
+{
+    const int size = count * pack->ticbytes;
+    int i, j;
+
+    if (!count)
+    {
+        return;
+    }
+
+    array_clear(pack->packed);
+
+    for (i = 0; i < pack->playerscount; ++i)
+    {
+        for (j = 0; j < NUMFIELDS; ++j)
+        {
+            PackColumn(pack, count, i * pack->ticsize, &pack->fields[j]);
+        }
+    }
+
+    if (array_size(pack->packed) < size)
+    {
+        WriteBlock(pack, BLOCK_TICS, count, pack->packed,
+                   array_size(pack->packed));
+    }
+    else
+    {
+        WriteBlock(pack, BLOCK_STORED, size, pack->raw, size);
+    }
+}
+
+static void Append(demopack_t *pack, const byte *data, int size)
+{
+    const int capacity = array_capacity(pack->raw);
+
+    if (array_size(pack->raw) + size > capacity)
+    {
+        array_grow(pack->raw, MAX(capacity, size));
+    }
+
+    memcpy(pack->raw + array_size(pack->raw), data, size);
+    array_ptr(pack->raw)->size += size;
+}
+
+demopack_t *G_OpenDemoPack(writer_t *writer, int headersize,
+                           int playerscount, int ticsize)
+{
+    demopack_t *pack = calloc(1, sizeof(*pack));
+    byte header[PACK_HEADERSIZE];
+
+    pack->writer = writer;
+    pack->state = headersize ? pack_header : pack_tics;
+    pack->headersize = headersize;
+    pack->playerscount = playerscount;
+    pack->ticsize = ticsize;
+    pack->ticbytes = playerscount * ticsize;
+    pack->fields = ticsize == 5 ? longfields : shortfields;
+
+    memcpy(header, packmagic, sizeof(packmagic));
+    header[4] = PACK_VERSION;
+    header[5] = playerscount;
+    header[6] = ticsize;
+    header[7] = 0;
+
+    M_WriteBuffered(writer, header, sizeof(header));
+
+    return pack;
+}
+
+void G_PackDemo(demopack_t *pack, const byte *data, size_t size)
+{
+    while (size)
+    {
+        size_t count = size;
+
+        switch (pack->state)
+        {
+            case pack_header:
+                count = MIN(size, pack->headersize - array_size(pack->raw));
+                Append(pack, data, count);
+
+                if (array_size(pack->raw) == pack->headersize)
+                {
+                    WriteBlock(pack, BLOCK_STORED, pack->headersize,
+                               pack->raw, pack->headersize);
+                    array_clear(pack->raw);
+                    pack->state = pack_tics;
+                }
+                break;
+
+            case pack_tics:
+                {
+                    const int offset = array_size(pack->raw) % pack->ticbytes;
+
+                    // The marker takes the place of the next tic.
+                    if (!offset && *data == DEMOMARKER)
+                    {
+                        PackTics(pack, array_size(pack->raw) / pack->ticbytes);
+                        array_clear(pack->raw);
+                        pack->state = pack_rest;
+                        count = 0;
+                        break;
+                    }
+
+                    count = MIN(size, pack->ticbytes - offset);
+                    Append(pack, data, count);
+
+                    if (array_size(pack->raw) == TICSPERBLOCK * pack->ticbytes)
+                    {
+                        PackTics(pack, TICSPERBLOCK);
+                        array_clear(pack->raw);
+                    }
+                }
+                break;
+
+            case pack_rest:
+                Append(pack, data, count);
+                break;
+        }
+
+        data += count;
+        size -= count;
+    }
+}
+
+void G_CloseDemoPack(demopack_t *pack)
+{
+    const int size = array_size(pack->raw);
+
+    switch (pack->state)
+    {
+        case pack_header:
+            WriteBlock(pack, BLOCK_STORED, size, pack->raw, size);
+            break;
+
+        case pack_tics:
+            {
+                // A demo cut off in the middle of a tic keeps the partial
+                // tic as the rest.
+                const int count = size / pack->ticbytes;
+                const int rest = size - count * pack->ticbytes;
+
+                PackTics(pack, count);
+
+                if (rest)
+                {
+                    WriteBlock(pack, BLOCK_STORED, rest,
+                               pack->raw + count * pack->ticbytes, rest);
+                }
+            }
+            break;
+
+        case pack_rest:
+            WriteBlock(pack, BLOCK_STORED, size, pack->raw, size);
+            break;
+    }
+
+    array_free(pack->raw);
+    array_free(pack->packed);
+    free(pack);
+}
+
+//
+// Unpacking
+//
+
+boolean G_IsPackedDemo(const byte *data, size_t size)
+{
+    return size >= PACK_HEADERSIZE
+           && !memcmp(data, packmagic, sizeof(packmagic));
+}
+
+static boolean GetVarint(const byte **p, const byte *end,
+                         unsigned int *value)
+{
+    int shift;
+
+    *value = 0;
+
+    for (shift = 0; *p < end && shift < 32; shift += 7)
+    {
+        const byte b = *(*p)++;
+
+        *value |= (unsigned int)(b & 0x7f) << shift;
+
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static boolean UnpackColumn(const byte **p, const byte *end, byte *out,
+                            int count, int ticbytes, const field_t *field)
+{
+    const unsigned int mask = (1u << (8 * field->width)) - 1;
+    unsigned int value = 0;
+    int i = 0;
+
+    while (i < count)
+    {
+        unsigned int control, run, zigzag = 0;
+        boolean literal;
+
+        if (!GetVarint(p, end, &control))
+        {
+            return false;
+        }
+
+        run = (control >> 1) + 1;
+        literal = control & 1;
+
+        if (run > count - i || (!literal && !GetVarint(p, end, &zigzag)))
+        {
+            return false;
+        }
+
+        for (; run; --run, ++i)
+        {
+            if (literal && !GetVarint(p, end, &zigzag))
+            {
+                return false;
+            }
+
+            value = (value + ((zigzag >> 1) ^ (0u - (zigzag & 1)))) & mask;
+            SetField(out + i * ticbytes + field->offset, field, value);
+        }
+    }
+
+    return true;
+}
+
+// Returns the unpacked size of the block at p, or -1 if it is truncated
+// or damaged.
+
+static int CheckBlock(const byte *p, const byte *end, int ticbytes)
+{
+    unsigned int count, length;
+
+    if (end - p < BLOCK_HEADERSIZE + BLOCK_CRCSIZE)
+    {
+        return -1;
+    }
+
+    count = GetLong(p + 1);
+    length = GetLong(p + 5);
+
+    if (length > end - p - BLOCK_HEADERSIZE - BLOCK_CRCSIZE)
+    {
+        I_Printf(VB_WARNING, "G_UnpackDemo: Truncated block.");
+        return -1;
+    }
+
+    if (mz_crc32(MZ_CRC32_INIT, p, BLOCK_HEADERSIZE + length)
+        != GetLong(p + BLOCK_HEADERSIZE + length))
+    {
+        I_Printf(VB_WARNING, "G_UnpackDemo: Block checksum mismatch.");
+        return -1;
+    }
+
+    switch (p[0])
+    {
+        case BLOCK_STORED:
+            if (count == length)
+            {
+                return length;
+            }
+            break;
+
+        case BLOCK_TICS:
+            if (count <= TICSPERBLOCK)
+            {
+                return count * ticbytes;
+            }
+            break;
+    }
+
+    I_Printf(VB_WARNING, "G_UnpackDemo: Invalid block.");
+    return -1;
+}
+
+byte *G_UnpackDemo(const byte *data, size_t size, size_t *outsize)
+{
+    const byte *p, *last, *end = data + size;
+    const field_t *fields;
+    int playerscount, ticsize, ticbytes;
+    size_t total = 0;
+    byte *buffer, *out;
+
+    if (!G_IsPackedDemo(data, size) || data[4] != PACK_VERSION)
+    {
+        return NULL;
+    }
+
+    playerscount = data[5];
+    ticsize = data[6];
+
+    if (playerscount < 1 || playerscount > MAXPLAYERS
+        || (ticsize != 4 && ticsize != 5))
+    {
+        return NULL;
+    }
+
+    ticbytes = playerscount * ticsize;
+    fields = ticsize == 5 ? longfields : shortfields;
+
+    // Check every block first, to know how much to allocate
+
+    for (p = data + PACK_HEADERSIZE; p < end; )
+    {
+        const int blocksize = CheckBlock(p, end, ticbytes);
+
+        if (blocksize < 0)
+        {
+            break;
+        }
+
+        total += blocksize;
+        p += BLOCK_HEADERSIZE + GetLong(p + 5) + BLOCK_CRCSIZE;
+    }
+
+    last = p;
+    buffer = out = Z_Malloc(total + 1, PU_STATIC, 0);
+
+    for (p = data + PACK_HEADERSIZE; p < last; )
+    {
+        const int type = p[0];
+        const unsigned int count = GetLong(p + 1);
+        const unsigned int length = GetLong(p + 5);
+        const byte *block = p + BLOCK_HEADERSIZE;
+        const byte *column = block;
+        boolean valid = true;
+        int i, j;
+
+        p = block + length + BLOCK_CRCSIZE;
+
+        if (type != BLOCK_TICS)
+        {
+            memcpy(out, block, length);
+            out += length;
+            continue;
+        }
+
+        for (i = 0; i < playerscount && valid; ++i)
+        {
+            for (j = 0; j < NUMFIELDS && valid; ++j)
+            {
+                valid = UnpackColumn(&column, block + length, out + i * ticsize,
+                                     count, ticbytes, &fields[j]);
+            }
+        }
+
+        if (!valid)
+        {
+            I_Printf(VB_WARNING, "G_UnpackDemo: Invalid tic block.");
+            break;
+        }
+
+        out += count * ticbytes;
+    }
+
+    *out = DEMOMARKER;
+    *outsize = out - buffer;
+
+    return buffer;
+}
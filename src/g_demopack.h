@@ -0,0 +1,46 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Packed demo container.
+//
+
+#ifndef __G_DEMOPACK__
+#define __G_DEMOPACK__
+
+#include "doomtype.h"
+#include "m_writer.h"
+
+typedef struct demopack_s demopack_t;
+
+// Start a packed demo on an open writer. headersize is the size of the
+// demo header before the first tic, ticsize the size of one player's
+// ticcmd (4, or 5 with longtics).
+demopack_t *G_OpenDemoPack(writer_t *writer, int headersize,
+                           int playerscount, int ticsize);
+
+// Pack the next part of a plain demo. Data can be split anywhere, tics
+// are buffered until a block is full.
+void G_PackDemo(demopack_t *pack, const byte *data, size_t size);
+
+// Write out the buffered data and free the packer. The writer stays open.
+void G_CloseDemoPack(demopack_t *pack);
+
+boolean G_IsPackedDemo(const byte *data, size_t size);
+
+// Unpack into a new PU_STATIC buffer that holds the plain demo, followed
+// by a DEMOMARKER. Unpacking stops at the first damaged block. Returns
+// NULL if the data isn't a packed demo of a known version.
+byte *G_UnpackDemo(const byte *data, size_t size, size_t *outsize);
+
+#endif
@@ -42,6 +42,7 @@
 #include "r_main.h"
 #include "r_draw.h"
 #include "p_map.h"
+#include "p_prof.h"
 #include "s_sound.h"
 #include "s_musinfo.h"
 #include "dstrings.h"
@@ -62,6 +63,9 @@
 #include "i_gamepad.h"
 #include "i_video.h"
 #include "m_array.h"
+#include "m_cache.h"
+#include "m_writer.h"
+#include "g_demopack.h"
 
 #define SAVEGAMESIZE  0x20000
 #define SAVESTRINGSIZE  24
@@ -74,6 +78,13 @@ static boolean  netdemo;
 static byte     *demobuffer;   // made some static -- killough
 static size_t   maxdemosize;
 static byte     *demo_p;
+// [Woof!] demo playback streams the lump through a window of demobuffer
+static int      demo_lump = -1;     // -1 if demobuffer holds the whole demo
+static int      demo_lumplength;
+static int      demo_windowpos;     // lump offset of demobuffer[0]
+static byte     *demo_end;          // end of the data read into the window
+static int      demo_headersize;    // offset of the first tic
+static boolean  demo_unpacked;      // demobuffer holds an unpacked demo
 static byte     consistancy[MAXPLAYERS][BACKUPTICS];
 
 static int G_GameOptionSize(void);
@@ -1250,6 +1261,44 @@ static char *defdemoname;
 
 #define DEMOMARKER    0x80
 
+// [Woof!] Demo playback doesn't cache the whole lump, it reads it through a
+// fixed-size window that is refilled from the lump as the tics are used up.
+// A DEMOMARKER is stored past the last byte read from the lump, so demos
+// that lack one still end at the end of the lump.
+
+#define DEMOWINDOWSIZE (64 * 1024)
+
+static void G_FillDemoWindow(void)
+{
+  static byte *window;
+  const int offset = demo_windowpos + (demo_p - demobuffer);
+  const int size = MIN(DEMOWINDOWSIZE, demo_lumplength - offset);
+
+  if (!window)
+    window = Z_Malloc(DEMOWINDOWSIZE + 1, PU_STATIC, 0);
+
+  W_ReadLumpRange(demo_lump, window, offset, size);
+  window[size] = DEMOMARKER;
+
+  demobuffer = demo_p = window;
+  demo_end = window + size;
+  demo_windowpos = offset;
+}
+
+// Continued recording appends to the demo in memory, so a streamed demo
+// is read in whole before the player joins it.
+
+static void G_LoadStreamedDemo(void)
+{
+  const int offset = demo_windowpos + (demo_p - demobuffer);
+
+  demobuffer = Z_Malloc(demo_lumplength, PU_STATIC, 0);
+  W_ReadLump(demo_lump, demobuffer);
+  demo_p = demobuffer + offset;
+  maxdemosize = demo_lumplength;
+  demo_lump = -1;
+}
+
 // Stay in the game, hand over controls to the player and continue recording the
 // demo under a different name
 static void G_JoinDemo(void)
@@ -1257,6 +1306,9 @@ static void G_JoinDemo(void)
   if (netgame)
     CheckPlayersInNetGame();
 
+  if (demo_lump >= 0)
+    G_LoadStreamedDemo();
+
   if (!orig_demoname)
   {
     byte *actualbuffer = demobuffer;
@@ -1282,7 +1334,12 @@ static void G_JoinDemo(void)
 
 static void G_ReadDemoTiccmd(ticcmd_t *cmd)
 {
-  if (*demo_p == DEMOMARKER)
+  // [Woof!] refill the window before a ticcmd could cross its end
+  if (demo_lump >= 0 && demo_end - demo_p < 5 &&
+      demo_windowpos + (demo_end - demobuffer) < demo_lumplength)
+    G_FillDemoWindow();
+
+  if (*demo_p == DEMOMARKER || (demo_lump >= 0 && demo_p >= demo_end))
   {
     last_cmd = cmd; // [crispy] remember last cmd to track joins
     G_CheckDemoStatus();      // end of demo data stream
@@ -1314,9 +1371,61 @@ static void G_ReadDemoTiccmd(ticcmd_t *cmd)
     }
 }
 
+// [Woof!] While recording, demobuffer only holds what hasn't been handed
+// to a background writer yet. It is flushed whenever it fills up, instead
+// of growing it to hold the whole demo and writing that out at the end.
+
+static writer_t *demowriter;
+static boolean packdemo;
+static demopack_t *demopack; // set if the demo is recorded packed
+
+// Bytes already stored at demo_p are kept, see G_WriteDemoTiccmd().
+
+static void G_FlushDemo(size_t keep)
+{
+  if (!demowriter)
+  {
+    if (!(demowriter = M_OpenWriter(demoname)))
+      I_Error("Error recording demo %s: %s", demoname,
+              errno ? strerror(errno) : "(Unknown Error)");
+
+    if (packdemo)
+    {
+      int i, playerscount = 0;
+
+      for (i = 0; i < MAXPLAYERS; ++i)
+        if (playeringame[i])
+          ++playerscount;
+
+      demopack = G_OpenDemoPack(demowriter, demo_headersize, playerscount,
+                                longtics ? 5 : 4);
+    }
+  }
+
+  if (demopack)
+    G_PackDemo(demopack, demobuffer, demo_p - demobuffer);
+  else
+    M_WriteBuffered(demowriter, demobuffer, demo_p - demobuffer);
+  memmove(demobuffer, demo_p, keep);
+  demo_p = demobuffer;
+}
+
+// A packed demo is flushed in smaller parts, so that no single tic has to
+// wait for a lot of data to be packed.
+
+#define DEMOPACKSIZE (16 * 1024)
+
 static void CheckDemoBuffer(size_t size)
 {
   ptrdiff_t position = demo_p - demobuffer;
+
+  if ((position + size > maxdemosize || (packdemo && position >= DEMOPACKSIZE))
+      && demorecording && !demoplayback)
+  {
+    G_FlushDemo(MIN(size, maxdemosize - position));
+    position = 0;
+  }
+
   if (position + size > maxdemosize)
   {
     maxdemosize += size + 128 * 1024; // add another 128K
@@ -1488,6 +1597,8 @@ static void G_DoCompleted(void)
       G_WriteLevelStat();
   }
 
+  P_ProfileReport();
+
   gameaction = ga_nothing;
 
   for (i=0; i<MAXPLAYERS; i++)
@@ -1712,6 +1823,87 @@ static void G_DoWorldDone(void)
      return; \
    } while(0)
 
+// [Woof!] The tic count of a streamed demo is kept in the startup cache,
+// along with what it was counted for. Tics have a fixed size, so the
+// offset of any tic follows from the header size and the player count,
+// and only the end of the tic stream needs a pass over the whole lump.
+
+typedef struct
+{
+  int lumplength;
+  int headersize;   // offset of the first tic
+  int playerscount;
+  int ticsize;      // bytes per tic, for all players
+  int totaltics;
+} demoindex_t;
+
+static int G_CountDemoTics(int offset, int ticsize)
+{
+  const int chunksize = DEMOWINDOWSIZE / ticsize * ticsize;
+  byte *chunk = Z_Malloc(chunksize, PU_STATIC, 0);
+  int totaltics = 0;
+
+  while (offset < demo_lumplength)
+  {
+    const int size = MIN(chunksize, demo_lumplength - offset);
+    int i;
+
+    W_ReadLumpRange(demo_lump, chunk, offset, size);
+
+    for (i = 0; i < size; i += ticsize, ++totaltics)
+    {
+      if (chunk[i] == DEMOMARKER)
+      {
+        Z_Free(chunk);
+        return totaltics;
+      }
+    }
+
+    offset += size;
+  }
+
+  Z_Free(chunk);
+  return totaltics;
+}
+
+static int G_IndexDemo(int headersize, int playerscount)
+{
+  const uint64_t key = M_CacheHash(&demo_lump, sizeof(demo_lump),
+                                   M_CacheWadKey());
+  demoindex_t index = {0};
+
+  if (M_ReadCache("demoindex", key, &index, sizeof(index)) &&
+      index.lumplength == demo_lumplength &&
+      index.headersize == headersize &&
+      index.playerscount == playerscount &&
+      index.ticsize == playerscount * (longtics ? 5 : 4))
+  {
+    return index.totaltics;
+  }
+
+  index.lumplength = demo_lumplength;
+  index.headersize = headersize;
+  index.playerscount = playerscount;
+  index.ticsize = playerscount * (longtics ? 5 : 4);
+  index.totaltics = index.ticsize ? G_CountDemoTics(headersize, index.ticsize) : 0;
+
+  M_WriteCache("demoindex", key, &index, sizeof(index));
+
+  return index.totaltics;
+}
+
+static boolean G_IsPackedDemoLump(int lumpnum)
+{
+  byte header[8];
+
+  if (W_LumpLength(lumpnum) < sizeof(header))
+    return false;
+
+  W_ReadLumpRange(lumpnum, header, 0, sizeof(header));
+
+  return G_IsPackedDemo(header, sizeof(header));
+}
+
 static void G_DoPlayDemo(void)
 {
   skill_t skill;
@@ -1736,7 +1928,40 @@ static void G_DoPlayDemo(void)
   lumpnum = W_GetNumForName(basename);
   lumplength = W_LumpLength(lumpnum);
 
-  demobuffer = demo_p = W_CacheLumpNum(lumpnum, PU_STATIC);  // killough
+  // [Woof!] packed demos are unpacked in memory
+  demo_unpacked = G_IsPackedDemoLump(lumpnum);
+
+  if (demo_unpacked)
+  {
+    byte *data = Z_Malloc(lumplength, PU_STATIC, 0);
+    size_t size;
+
+    W_ReadLump(lumpnum, data);
+    demobuffer = demo_p = G_UnpackDemo(data, lumplength, &size);
+    Z_Free(data);
+    demo_lump = -1;
+
+    if (!demobuffer)
+    {
+      INVALID_DEMO("Unknown packed demo format in %s.", basename);
+    }
+
+    lumplength = size;
+  }
+  // [Woof!] stream the demo, unless recording continues from its end
+  else if (demorecording)
+  {
+    demobuffer = demo_p = W_CacheLumpNum(lumpnum, PU_STATIC);  // killough
+    demo_lump = -1;
+  }
+  else
+  {
+    demo_lump = lumpnum;
+    demo_lumplength = lumplength;
+    demo_windowpos = 0;
+    demobuffer = demo_p = NULL;
+    G_FillDemoWindow();
+  }
 
   // [FG] ignore too short demo lumps
   if (lumplength < 0xd)
@@ -1904,6 +2129,8 @@ static void G_DoPlayDemo(void)
       demo_p += MIN_MAXPLAYERS - MAXPLAYERS;
     }
 
+  demo_headersize = demo_p - demobuffer;
+
   if (playeringame[1])
     netgame = netdemo = true;
 
@@ -1955,10 +2182,17 @@ static void G_DoPlayDemo(void)
         ++playerscount;
     }
 
-    while (*demo_ptr != DEMOMARKER && (demo_ptr - demobuffer) < lumplength)
+    if (demo_lump >= 0 && lumplength > DEMOWINDOWSIZE)
     {
-      demo_ptr += playerscount * (longtics ? 5 : 4);
-      ++playback_totaltics;
+      playback_totaltics = G_IndexDemo(demo_p - demobuffer, playerscount);
+    }
+    else
+    {
+      while (*demo_ptr != DEMOMARKER && (demo_ptr - demobuffer) < lumplength)
+      {
+        demo_ptr += playerscount * (longtics ? 5 : 4);
+        ++playback_totaltics;
+      }
     }
   }
 
@@ -3601,8 +3835,8 @@ void G_RecordDemo(char *name)
   // @category demo
   // @vanilla
   //
-  // Sets the initial size of the demo recording buffer (KiB). This is no longer a
-  // hard limit, and the buffer will expand if the given limit is exceeded.
+  // Sets the size of the demo recording buffer (KiB). This is not a limit on
+  // the length of the demo, the buffer is written to disk whenever it fills up.
   //
 
   i = M_CheckParm ("-maxdemo");
@@ -3611,6 +3845,18 @@ void G_RecordDemo(char *name)
   if (maxdemosize < 0x20000)  // killough
     maxdemosize = 0x20000;
   demobuffer = Z_Malloc(maxdemosize, PU_STATIC, 0); // killough
+
+  //!
+  // @category demo
+  //
+  // Record the demo in a packed format, with the tics delta and run-length
+  // coded per player and field, in blocks with CRC-32 checksums. Packed
+  // demos are much smaller, but can only be played back by Woof!.
+  //
+
+  packdemo = !!M_CheckParm("-packdemo");
+
+  demo_lump = -1;
   demorecording = true;
 }
 
@@ -4010,6 +4256,8 @@ void G_BeginRecording(void)
       *demo_p++ = playeringame[i];
   }
 
+  demo_headersize = demo_p - demobuffer;
+
   displaymsg("Demo Recording: %s", M_BaseName(demoname));
 }
 
@@ -4215,8 +4463,20 @@ boolean G_CheckDemoStatus(void)
       if (singledemo)
         I_SafeExit(0);  // killough
 
+      // [Woof!] the streaming window is kept for the next demo
+      if (demo_lump >= 0)
+      {
+        demobuffer = demo_p = NULL;
+        demo_lump = -1;
+      }
+      else if (demo_unpacked)
+      {
+        Z_Free(demobuffer);
+        demobuffer = demo_p = NULL;
+        demo_unpacked = false;
+      }
       // [FG] ignore empty demo lumps
-      if (demobuffer)
+      else if (demobuffer)
       {
         Z_ChangeTag(demobuffer, PU_CACHE);
       }
@@ -4240,10 +4500,20 @@ boolean G_CheckDemoStatus(void)
 
       G_AddDemoFooter();
 
-      if (!M_WriteFile(demoname, demobuffer, demo_p - demobuffer))
+      G_FlushDemo(0);
+
+      if (demopack)
+      {
+        G_CloseDemoPack(demopack);
+        demopack = NULL;
+      }
+
+      if (!M_CloseWriter(demowriter))
 	I_Error("Error recording demo %s: %s", demoname,  // killough 11/98
 		errno ? strerror(errno) : "(Unknown Error)");
 
+      demowriter = NULL;
+
       Z_Free(demobuffer);
       demobuffer = NULL;  // killough
       I_Printf(VB_ALWAYS, "Demo %s recorded", demoname);
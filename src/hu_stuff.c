@@ -33,8 +33,10 @@
 #include "d_deh.h"   /* Ty 03/27/98 - externalization of mapnamesx arrays */
 #include "m_input.h"
 #include "p_map.h" // crosshair (linetarget)
+#include "p_prof.h"
 #include "m_misc2.h"
 #include "m_swap.h"
+#include "m_trace.h"
 #include "i_video.h" // fps
 #include "r_main.h"
 #include "r_voxel.h"
@@ -121,6 +123,7 @@ static hu_multiline_t w_sttime; // time above status bar
 static hu_multiline_t w_coord;
 static hu_multiline_t w_fps;
 static hu_multiline_t w_rate;
+static hu_multiline_t w_prof;   // [Woof!] -tickprofile
 
 #define MAX_HUDS 3
 #define MAX_WIDGETS_D 5
@@ -154,6 +157,7 @@ static hu_widget_t boom_widgets[MAX_HUDS][MAX_WIDGETS_B] = {
     {&w_sttime, align_left,  align_top},
     {&w_coord,  align_right, align_top},
     {&w_fps,    align_right, align_top},
+    {&w_prof,   align_right, align_top},
     {&w_rate,   align_left,  align_top},
     {NULL}
   }, {
@@ -167,6 +171,7 @@ static hu_widget_t boom_widgets[MAX_HUDS][MAX_WIDGETS_B] = {
     {&w_sttime, align_left,  align_bottom},
     {&w_coord,  align_right, align_top},
     {&w_fps,    align_right, align_top},
+    {&w_prof,   align_right, align_top},
     {&w_rate,   align_left,  align_top},
     {NULL}
   }, {
@@ -180,6 +185,7 @@ static hu_widget_t boom_widgets[MAX_HUDS][MAX_WIDGETS_B] = {
     {&w_sttime, align_left,  align_bottom},
     {&w_coord , align_right, align_top},
     {&w_fps,    align_right, align_top},
+    {&w_prof,   align_right, align_top},
     {&w_rate,   align_left,  align_top},
     {NULL}
   }
@@ -549,6 +555,7 @@ static void HU_widget_build_armor (void);
 static void HU_widget_build_coord (void);
 static void HU_widget_build_fps (void);
 static void HU_widget_build_rate (void);
+static void HU_widget_build_prof (void);
 static void HU_widget_build_health (void);
 static void HU_widget_build_keys (void);
 static void HU_widget_build_frag (void);
@@ -654,6 +661,10 @@ void HU_Start(void)
                        &boom_font, colrngs[hudcolor_xyco],
                        NULL, HU_widget_build_rate);
 
+  HUlib_init_multiline(&w_prof, 1 + PROFILE_TOP,
+                       &boom_font, colrngs[hudcolor_xyco],
+                       NULL, HU_widget_build_prof);
+
   HU_set_centered_message(false);
 
   HU_disable_all_widgets();
@@ -1281,6 +1292,31 @@ static void HU_widget_build_rate (void)
   }
 }
 
+// [Woof!] playsim profiler, time per tic averaged over the last second
+
+static void HU_widget_build_prof (void)
+{
+  char hud_profstr[HU_MAXLINELENGTH];
+  int i;
+
+  M_snprintf(hud_profstr, sizeof(hud_profstr), "%s \x1b%c%d\x1b%c US",
+             profile_total.name, '0'+CR_GRAY, profile_total.us, '0'+CR_ORIG);
+  HUlib_add_string_to_cur_line(&w_prof, hud_profstr);
+
+  for (i = 0; i < PROFILE_TOP; i++)
+  {
+    if (i < profile_numtop)
+      M_snprintf(hud_profstr, sizeof(hud_profstr),
+                 "%s \x1b%c%d\x1b%c US %dX", profile_top[i].name,
+                 '0'+CR_GRAY, profile_top[i].us, '0'+CR_ORIG,
+                 profile_top[i].calls);
+    else
+      hud_profstr[0] = '\0';
+
+    HUlib_add_string_to_cur_line(&w_prof, hud_profstr);
+  }
+}
+
 // Crosshair
 
 boolean hud_crosshair_health;
@@ -1466,6 +1502,8 @@ void HU_Drawer(void)
   if (hud_pending)
     return;
 
+  TRACE_BEGIN("HU_Drawer");
+
   HUlib_reset_align_offsets();
 
   w = doom_widget;
@@ -1492,6 +1530,8 @@ void HU_Drawer(void)
     }
     w++;
   }
+
+  TRACE_END();
 }
 
 // [FG] draw Time widget on intermission screen
@@ -1695,6 +1735,7 @@ void HU_Ticker(void)
 
   HU_cond_build_widget(&w_fps, plr->cheats & CF_SHOWFPS);
   HU_cond_build_widget(&w_rate, plr->cheats & CF_RENDERSTATS);
+  HU_cond_build_widget(&w_prof, tickprofile);
 
   if (hud_displayed &&
       scaledviewheight == SCREENHEIGHT &&
@@ -1953,6 +1994,7 @@ static const multiline_names_t
     {"coord",  "coords",  &w_coord},
     {"fps",     NULL,     &w_fps},
     {"rate",    NULL,     &w_rate},
+    {"profile", NULL,     &w_prof},
     {NULL},
 };
 
@@ -148,6 +148,7 @@ void I_OAL_ShutdownModule(void)
             alDeleteBuffers(1, &S_sfx[i].buffer);
             S_sfx[i].cached = false;
             S_sfx[i].lumpnum = -1;
+            S_sfx[i].length = 0;
         }
     }
 }
@@ -550,6 +551,26 @@ static void FadeInMono8(byte *data, ALsizei size, ALsizei freq)
     }
 }
 
+// [Woof!] Length of a sound buffer in milliseconds, so that sounds which
+// have lost their channel know when they would have ended.
+
+static int BufferLength(ALuint buffer)
+{
+    ALint size, bits, channels, freq;
+
+    alGetBufferi(buffer, AL_SIZE, &size);
+    alGetBufferi(buffer, AL_BITS, &bits);
+    alGetBufferi(buffer, AL_CHANNELS, &channels);
+    alGetBufferi(buffer, AL_FREQUENCY, &freq);
+
+    if (alGetError() != AL_NO_ERROR || bits <= 0 || channels <= 0 || freq <= 0)
+    {
+        return 0;
+    }
+
+    return (int)((int64_t)size * 8 / (bits * channels) * 1000 / freq);
+}
+
 boolean I_OAL_CacheSound(sfxinfo_t *sfx)
 {
     int lumpnum;
@@ -641,6 +662,7 @@ boolean I_OAL_CacheSound(sfxinfo_t *sfx)
 
         sfx->buffer = buffer;
         sfx->cached = true;
+        sfx->length = BufferLength(buffer);
     }
 
     // don't need original lump data any more
@@ -662,7 +684,7 @@ boolean I_OAL_CacheSound(sfxinfo_t *sfx)
     return true;
 }
 
-boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, int pitch)
+boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, int pitch, int offset)
 {
     if (!oal)
     {
@@ -674,6 +696,12 @@ boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, int pitch)
 
     alSourcei(oal->sources[channel], AL_BUFFER, sfx->buffer);
 
+    // [Woof!] Resume a sound that was playing without a channel.
+    if (offset > 0)
+    {
+        alSourcef(oal->sources[channel], AL_SEC_OFFSET, offset / 1000.0f);
+    }
+
     alGetError();
     alSourcePlay(oal->sources[channel]);
     if (alGetError() != AL_NO_ERROR)
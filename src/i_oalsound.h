@@ -52,7 +52,7 @@ boolean I_OAL_AllowReinitSound(void);
 
 boolean I_OAL_CacheSound(sfxinfo_t *sfx);
 
-boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, int pitch);
+boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, int pitch, int offset);
 
 void I_OAL_StopSound(int channel);
 
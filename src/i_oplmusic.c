@@ -21,19 +21,26 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "SDL.h"
+
 #include "mus2mid.h"
 #include "memio.h"
 #include "doomtype.h"
 
+#include "d_main.h"
+#include "i_oalmusic.h"
 #include "i_printf.h"
 #include "i_sound.h"
+#include "i_system.h"
 #include "m_array.h"
+#include "m_misc2.h"
 #include "m_swap.h"
 #include "m_io.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
 #include "../opl/opl.h"
+#include "../miniz/miniz.h"
 #include "midifile.h"
 
 // #define OPL_MIDI_DEBUG
@@ -107,15 +114,6 @@ typedef struct
 
 } opl_channel_data_t;
 
-// Data associated with a track that is currently playing.
-
-typedef struct
-{
-    // Track iterator used to read new events.
-
-    midi_track_iter_t *iter;
-} opl_track_data_t;
-
 typedef struct opl_voice_s opl_voice_t;
 
 struct opl_voice_s
@@ -334,9 +332,11 @@ static char (*percussion_names)[32];
 
 // Voices:
 
-static opl_voice_t voices[OPL_NUM_VOICES * 2];
-static opl_voice_t *voice_free_list[OPL_NUM_VOICES * 2];
-static opl_voice_t *voice_alloced_list[OPL_NUM_VOICES * 2];
+#define MAX_OPL_VOICES (OPL_NUM_VOICES * 2 * OPL_MAX_CHIPS)
+
+static opl_voice_t voices[MAX_OPL_VOICES];
+static opl_voice_t *voice_free_list[MAX_OPL_VOICES];
+static opl_voice_t *voice_alloced_list[MAX_OPL_VOICES];
 static int voice_free_num;
 static int voice_alloced_num;
 static int opl_opl3mode;
@@ -346,17 +346,49 @@ static int num_opl_voices;
 
 static opl_channel_data_t channels[MIDI_CHANNELS_PER_TRACK];
 
-// Track data for playing tracks:
+// Events of the playing song, merged from all tracks:
 
-static opl_track_data_t *tracks;
-static unsigned int num_tracks = 0;
-static unsigned int running_tracks = 0;
+static midi_timed_event_t *song_events;
+static unsigned int num_song_events = 0;
+static unsigned int song_position = 0;
 static boolean song_looping;
 
-// Tempo control variables
+// Pre-rendered song data, see the "Pre-rendering" section below.
+
+typedef struct
+{
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+
+    // Interleaved 16-bit stereo samples rendered so far.
+    int16_t *samples;
+    uint32_t length;
+    uint32_t capacity;
+
+    // Playback state, in samples.
+    uint32_t position;
+    uint32_t loop_start;
+
+    // Set on the main thread, polled by the render and audio threads.
+    SDL_atomic_t running;
+    SDL_atomic_t paused;
+
+    boolean complete;
+    boolean looping;
+    boolean active;
+} opl_prerender_t;
 
-static unsigned int ticks_per_beat;
-static unsigned int us_per_beat;
+static opl_prerender_t prerender;
+
+// If true, songs are rendered once in full and then played from a cache.
+
+boolean opl_prerender = false;
+
+// Music volume (0 - 15) last requested by the sound code.
+
+static int music_volume = 15;
+
+extern int opl_gain;
 
 // Mini-log of recently played percussion instruments:
 
@@ -369,6 +401,10 @@ static unsigned int last_perc_count;
 char *snd_dmxoption = "-opl3"; // [crispy] default to OPL3 emulation
 int opl_io_port = 0x388;
 
+// Number of emulated OPL chips, for more polyphony.
+
+int num_opl_chips = 1;
+
 // If true, OPL sound channels are reversed to their correct arrangement
 // (as intended by the MIDI standard) rather than the backwards one
 // used by DMX due to a bug.
@@ -379,9 +415,18 @@ static boolean opl_stereo_correct = false;
 
 static byte *lump;
 
+// Checksums identifying the GENMIDI lump and the registered song, used
+// to key the pre-render cache.
+
+static uint32_t genmidi_crc;
+static uint32_t song_crc;
+
 static boolean LoadInstrumentTable(void)
 {
-    lump = W_CacheLumpName("genmidi", PU_STATIC);
+    int lumpnum = W_GetNumForName("genmidi");
+
+    lump = W_CacheLumpNum(lumpnum, PU_STATIC);
+    genmidi_crc = mz_crc32(MZ_CRC32_INIT, lump, W_LumpLength(lumpnum));
 
     // DMX does not check header
 
@@ -624,20 +669,26 @@ static void SetVoicePan(opl_voice_t *voice, unsigned int pan)
 static void InitVoices(void)
 {
     int i;
+    int chip_voices = num_opl_voices / num_opl_chips;
 
     // Start with an empty free list.
     
     voice_free_num = num_opl_voices;
     voice_alloced_num = 0;
 
-    // Initialize each voice.
+    // Initialize each voice.  Each chip provides a contiguous range of
+    // voices; the chip is selected through the register array bits.
 
     for (i = 0; i < num_opl_voices; ++i)
     {
-        voices[i].index = i % OPL_NUM_VOICES;
-        voices[i].op1 = voice_operators[0][i % OPL_NUM_VOICES];
-        voices[i].op2 = voice_operators[1][i % OPL_NUM_VOICES];
-        voices[i].array = (i / OPL_NUM_VOICES) << 8;
+        int chip = i / chip_voices;
+        int chip_voice = i % chip_voices;
+
+        voices[i].index = chip_voice % OPL_NUM_VOICES;
+        voices[i].op1 = voice_operators[0][chip_voice % OPL_NUM_VOICES];
+        voices[i].op2 = voice_operators[1][chip_voice % OPL_NUM_VOICES];
+        voices[i].array = ((chip_voice / OPL_NUM_VOICES) << 8)
+                        | OPL_REG_CHIP(chip);
         voices[i].current_instr = NULL;
 
         // Add this voice to the freelist.
@@ -655,6 +706,17 @@ static void I_OPL_SetMusicVolume(int volume)
 {
     unsigned int i;
 
+    music_volume = volume;
+
+    // Pre-rendered songs are rendered at full volume, so scale the
+    // output instead.
+
+    if (prerender.active)
+    {
+        I_OAL_SetGain((float)opl_gain / 100.0f * volume / 15.0f);
+        return;
+    }
+
     volume = volume * 127 / 15; // [FG] adjust volume
 
     if (current_music_volume == volume)
@@ -687,8 +749,7 @@ static void VoiceKeyOff(opl_voice_t *voice)
                       voice->freq >> 8);
 }
 
-static opl_channel_data_t *TrackChannelForEvent(opl_track_data_t *track,
-                                                midi_event_t *event)
+static opl_channel_data_t *TrackChannelForEvent(midi_event_t *event)
 {
     unsigned int channel_num = event->data.channel.channel;
 
@@ -709,7 +770,7 @@ static opl_channel_data_t *TrackChannelForEvent(opl_track_data_t *track,
 
 // Get the frequency that we should be using for a voice.
 
-static void KeyOffEvent(opl_track_data_t *track, midi_event_t *event)
+static void KeyOffEvent(midi_event_t *event)
 {
     opl_channel_data_t *channel;
     int i;
@@ -722,7 +783,7 @@ static void KeyOffEvent(opl_track_data_t *track, midi_event_t *event)
            event->data.channel.param2);
 */
 
-    channel = TrackChannelForEvent(track, event);
+    channel = TrackChannelForEvent(event);
     key = event->data.channel.param1;
 
     // Turn off voices being used to play this key.
@@ -977,7 +1038,7 @@ static void VoiceKeyOn(opl_channel_data_t *channel,
     UpdateVoiceFrequency(voice);
 }
 
-static void KeyOnEvent(opl_track_data_t *track, midi_event_t *event)
+static void KeyOnEvent(midi_event_t *event)
 {
     genmidi_instr_t *instrument;
     opl_channel_data_t *channel;
@@ -1000,12 +1061,12 @@ static void KeyOnEvent(opl_track_data_t *track, midi_event_t *event)
     // key off.
     if (volume <= 0)
     {
-        KeyOffEvent(track, event);
+        KeyOffEvent(event);
         return;
     }
 
     // The channel.
-    channel = TrackChannelForEvent(track, event);
+    channel = TrackChannelForEvent(event);
 
     // Percussion channel is treated differently.
     if (event->data.channel.channel == 9)
@@ -1091,14 +1152,14 @@ static void KeyOnEvent(opl_track_data_t *track, midi_event_t *event)
     }
 }
 
-static void ProgramChangeEvent(opl_track_data_t *track, midi_event_t *event)
+static void ProgramChangeEvent(midi_event_t *event)
 {
     opl_channel_data_t *channel;
     int instrument;
 
     // Set the instrument used on this channel.
 
-    channel = TrackChannelForEvent(track, event);
+    channel = TrackChannelForEvent(event);
     instrument = event->data.channel.param1;
     channel->instrument = &main_instrs[instrument];
 
@@ -1197,7 +1258,7 @@ static void AllNotesOff(opl_channel_data_t *channel, unsigned int param)
     }
 }
 
-static void ControllerEvent(opl_track_data_t *track, midi_event_t *event)
+static void ControllerEvent(midi_event_t *event)
 {
     opl_channel_data_t *channel;
     unsigned int controller;
@@ -1210,7 +1271,7 @@ static void ControllerEvent(opl_track_data_t *track, midi_event_t *event)
            event->data.channel.param2);
 */
 
-    channel = TrackChannelForEvent(track, event);
+    channel = TrackChannelForEvent(event);
     controller = event->data.channel.param1;
     param = event->data.channel.param2;
 
@@ -1236,19 +1297,19 @@ static void ControllerEvent(opl_track_data_t *track, midi_event_t *event)
 
 // Process a pitch bend event.
 
-static void PitchBendEvent(opl_track_data_t *track, midi_event_t *event)
+static void PitchBendEvent(midi_event_t *event)
 {
     opl_channel_data_t *channel;
     int i;
-    opl_voice_t *voice_updated_list[OPL_NUM_VOICES * 2] = {0};
+    opl_voice_t *voice_updated_list[MAX_OPL_VOICES] = {0};
     unsigned int voice_updated_num = 0;
-    opl_voice_t *voice_not_updated_list[OPL_NUM_VOICES * 2] = {0};
+    opl_voice_t *voice_not_updated_list[MAX_OPL_VOICES] = {0};
     unsigned int voice_not_updated_num = 0;
 
     // Update the channel bend value.  Only the MSB of the pitch bend
     // value is considered: this is what Doom does.
 
-    channel = TrackChannelForEvent(track, event);
+    channel = TrackChannelForEvent(event);
     channel->bend = event->data.channel.param2 - 64;
 
     // Update all voices for this channel.
@@ -1278,19 +1339,10 @@ static void PitchBendEvent(opl_track_data_t *track, midi_event_t *event)
     }
 }
 
-static void MetaSetTempo(unsigned int tempo)
-{
-    OPL_AdjustCallbacks((float) us_per_beat / tempo);
-    us_per_beat = tempo;
-}
-
 // Process a meta event.
 
-static void MetaEvent(opl_track_data_t *track, midi_event_t *event)
+static void MetaEvent(midi_event_t *event)
 {
-    byte *data = event->data.meta.data;
-    unsigned int data_len = event->data.meta.length;
-
     switch (event->data.meta.type)
     {
         // Things we can just ignore.
@@ -1306,15 +1358,14 @@ static void MetaEvent(opl_track_data_t *track, midi_event_t *event)
         case MIDI_META_SEQUENCER_SPECIFIC:
             break;
 
+        // Tempo changes are already applied to the event times by
+        // MIDI_LoadFile().
+
         case MIDI_META_SET_TEMPO:
-            if (data_len == 3)
-            {
-                MetaSetTempo((data[0] << 16) | (data[1] << 8) | data[2]);
-            }
             break;
 
         // End of track - actually handled when we run out of events
-        // in the track, see below.
+        // in the song, see below.
 
         case MIDI_META_END_OF_TRACK:
             break;
@@ -1328,32 +1379,32 @@ static void MetaEvent(opl_track_data_t *track, midi_event_t *event)
 
 // Process a MIDI event from a track.
 
-static void ProcessEvent(opl_track_data_t *track, midi_event_t *event)
+static void ProcessEvent(midi_event_t *event)
 {
     switch (event->event_type)
     {
         case MIDI_EVENT_NOTE_OFF:
-            KeyOffEvent(track, event);
+            KeyOffEvent(event);
             break;
 
         case MIDI_EVENT_NOTE_ON:
-            KeyOnEvent(track, event);
+            KeyOnEvent(event);
             break;
 
         case MIDI_EVENT_CONTROLLER:
-            ControllerEvent(track, event);
+            ControllerEvent(event);
             break;
 
         case MIDI_EVENT_PROGRAM_CHANGE:
-            ProgramChangeEvent(track, event);
+            ProgramChangeEvent(event);
             break;
 
         case MIDI_EVENT_PITCH_BEND:
-            PitchBendEvent(track, event);
+            PitchBendEvent(event);
             break;
 
         case MIDI_EVENT_META:
-            MetaEvent(track, event);
+            MetaEvent(event);
             break;
 
         // SysEx events can be ignored.
@@ -1368,7 +1419,7 @@ static void ProcessEvent(opl_track_data_t *track, midi_event_t *event)
     }
 }
 
-static void ScheduleTrack(opl_track_data_t *track);
+static void ScheduleEvents(uint64_t now);
 static void InitChannel(opl_channel_data_t *channel);
 
 // Restart a song from the beginning.
@@ -1377,15 +1428,11 @@ static void RestartSong(void *unused)
 {
     unsigned int i;
 
-    running_tracks = num_tracks;
+    song_position = 0;
 
     start_music_volume = current_music_volume;
 
-    for (i = 0; i < num_tracks; ++i)
-    {
-        MIDI_RestartIterator(tracks[i].iter);
-        ScheduleTrack(&tracks[i]);
-    }
+    ScheduleEvents(0);
 
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
     {
@@ -1393,38 +1440,37 @@ static void RestartSong(void *unused)
     }
 }
 
-// Callback function invoked when another event needs to be read from
-// a track.
+// Callback function invoked when the next events of the song are due.
+// All events sharing the same timestamp are processed together.
 
-static void TrackTimerCallback(void *arg)
+static void SongTimerCallback(void *unused)
 {
-    opl_track_data_t *track = arg;
-    midi_event_t *event;
-
-    // Get the next event and process it.
+    uint64_t now;
 
-    if (!MIDI_GetNextEvent(track->iter, &event))
+    if (song_position >= num_song_events)
     {
         return;
     }
 
-    ProcessEvent(track, event);
-
-    // End of track?
+    now = song_events[song_position].us;
 
-    if (event->event_type == MIDI_EVENT_META
-     && event->data.meta.type == MIDI_META_END_OF_TRACK)
+    while (song_position < num_song_events
+           && song_events[song_position].us == now)
     {
-        --running_tracks;
+        ProcessEvent(&song_events[song_position].event);
+        ++song_position;
+    }
 
-        // When all tracks have finished, restart the song.
-        // Don't restart the song immediately, but wait for 5ms
-        // before triggering a restart.  Otherwise it is possible
-        // to construct an empty MIDI file that causes the game
-        // to lock up in an infinite loop. (5ms should be short
-        // enough not to be noticeable by the listener).
+    // End of song? The last event is the end of the longest track.
+    // Don't restart the song immediately, but wait for 5ms before
+    // triggering a restart.  Otherwise it is possible to construct an
+    // empty MIDI file that causes the game to lock up in an infinite
+    // loop. (5ms should be short enough not to be noticeable by the
+    // listener).
 
-        if (running_tracks <= 0 && song_looping)
+    if (song_position >= num_song_events)
+    {
+        if (song_looping)
         {
             OPL_SetCallback(5000, RestartSong, NULL);
         }
@@ -1432,25 +1478,17 @@ static void TrackTimerCallback(void *arg)
         return;
     }
 
-    // Reschedule the callback for the next event in the track.
+    // Reschedule the callback for the next events in the song.
 
-    ScheduleTrack(track);
+    ScheduleEvents(now);
 }
 
-static void ScheduleTrack(opl_track_data_t *track)
+static void ScheduleEvents(uint64_t now)
 {
-    unsigned int nticks;
-    uint64_t us;
-
-    // Get the number of microseconds until the next event.
-
-    nticks = MIDI_GetDeltaTime(track->iter);
-    us = ((uint64_t) nticks * us_per_beat) / ticks_per_beat;
+    // Set a timer to be invoked when the next event is ready to play.
 
-    // Set a timer to be invoked when the next event is
-    // ready to play.
-
-    OPL_SetCallback(us, TrackTimerCallback, track);
+    OPL_SetCallback(song_events[song_position].us - now,
+                    SongTimerCallback, NULL);
 }
 
 // Initialize a channel.
@@ -1470,18 +1508,350 @@ static void InitChannel(opl_channel_data_t *channel)
     channel->bend = 0;
 }
 
-// Start a MIDI track playing:
+//
+// Pre-rendering.
+//
+// Each song is rendered in full on a background thread, which plays the
+// part of the audio thread for the sequencer above. The audio thread
+// meanwhile streams the rendered samples through OPL_SetStreamFunc().
+// Finished renders are stored compressed in the "oplcache" directory, so
+// on later plays the thread only has to load them.
+//
+
+// Samples rendered per iteration of the render thread.
+#define PRERENDER_CHUNK 4096
+
+// Songs longer than this are played back from the rendered part only,
+// and not cached.
+#define PRERENDER_MAX_LENGTH (SND_SAMPLERATE * 60 * 30)
+
+#define PRERENDER_MAGIC "WOOFOPL1"
 
-static void StartTrack(midi_file_t *file, unsigned int track_num)
+typedef struct
 {
-    opl_track_data_t *track;
+    char magic[8];
+    uint32_t samplerate;
+    uint32_t length;
+    uint32_t loop_start;
+    uint32_t packed_size;
+} prerender_header_t;
 
-    track = &tracks[track_num];
-    track->iter = MIDI_IterateTrack(file, track_num);
+// Stream function called from the audio thread.
 
-    // Schedule the first event.
+static uint32_t PrerenderCallback(uint8_t *buffer, uint32_t buffer_samples)
+{
+    uint32_t filled = 0;
 
-    ScheduleTrack(track);
+    SDL_LockMutex(prerender.mutex);
+
+    while (filled < buffer_samples && !SDL_AtomicGet(&prerender.paused))
+    {
+        uint32_t count;
+
+        if (prerender.position >= prerender.length)
+        {
+            // Loop once the whole song is available, otherwise the render
+            // thread fell behind and we output silence until it catches up.
+
+            if (prerender.complete && prerender.looping
+                && prerender.length > prerender.loop_start)
+            {
+                prerender.position = prerender.loop_start;
+                continue;
+            }
+            break;
+        }
+
+        count = MIN(buffer_samples - filled,
+                    prerender.length - prerender.position);
+
+        memcpy(buffer + filled * 4,
+               prerender.samples + prerender.position * 2, count * 4);
+
+        filled += count;
+        prerender.position += count;
+    }
+
+    SDL_UnlockMutex(prerender.mutex);
+
+    memset(buffer + filled * 4, 0, (buffer_samples - filled) * 4);
+
+    return buffer_samples;
+}
+
+static void AppendSamples(const byte *data, uint32_t nsamples)
+{
+    SDL_LockMutex(prerender.mutex);
+
+    if (prerender.length + nsamples > prerender.capacity)
+    {
+        prerender.capacity = MAX(prerender.capacity * 2, SND_SAMPLERATE * 8);
+        prerender.samples = I_Realloc(prerender.samples,
+                                      prerender.capacity * 4);
+    }
+
+    memcpy(prerender.samples + prerender.length * 2, data, nsamples * 4);
+    prerender.length += nsamples;
+
+    SDL_UnlockMutex(prerender.mutex);
+}
+
+// The cache file name is built from checksums of the song and of all the
+// settings that change the emulator output. Volume is applied at playback.
+
+static char *PrerenderCacheFile(void)
+{
+    char *dir, *path;
+    char name[32];
+    uint32_t settings[5], settings_crc;
+
+    settings[0] = SND_SAMPLERATE;
+    settings[1] = opl_opl3mode;
+    settings[2] = opl_stereo_correct;
+    settings[3] = opl_drv_ver;
+    settings[4] = num_opl_chips;
+
+    settings_crc = mz_crc32(genmidi_crc, (const byte *) settings,
+                            sizeof(settings));
+
+    dir = M_StringJoin(D_DoomPrefDir(), DIR_SEPARATOR_S, "oplcache", NULL);
+    M_MakeDirectory(dir);
+
+    M_snprintf(name, sizeof(name), "%08x%08x.pcm", song_crc, settings_crc);
+    path = M_StringJoin(dir, DIR_SEPARATOR_S, name, NULL);
+
+    free(dir);
+
+    return path;
+}
+
+// Samples are stored as per-channel deltas, which deflate much better than
+// raw PCM.
+
+static void DeltaEncode(int16_t *samples, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = length - 1; i > 0; --i)
+    {
+        samples[i * 2] -= samples[i * 2 - 2];
+        samples[i * 2 + 1] -= samples[i * 2 - 1];
+    }
+}
+
+static void DeltaDecode(int16_t *samples, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 1; i < length; ++i)
+    {
+        samples[i * 2] += samples[i * 2 - 2];
+        samples[i * 2 + 1] += samples[i * 2 - 1];
+    }
+}
+
+static boolean LoadPrerenderCache(const char *path)
+{
+    prerender_header_t header;
+    byte *packed;
+    int16_t *samples;
+    uint32_t length, packed_size;
+    mz_ulong size;
+    boolean result = false;
+    FILE *file;
+
+    file = M_fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, PRERENDER_MAGIC, sizeof(header.magic))
+        || LONG(header.samplerate) != SND_SAMPLERATE)
+    {
+        fclose(file);
+        return false;
+    }
+
+    length = LONG(header.length);
+    packed_size = LONG(header.packed_size);
+
+    if (length == 0 || length > PRERENDER_MAX_LENGTH)
+    {
+        fclose(file);
+        return false;
+    }
+
+    packed = malloc(packed_size);
+    samples = malloc(length * 4);
+    size = length * 4;
+
+    if (packed && samples
+        && fread(packed, 1, packed_size, file) == packed_size
+        && mz_uncompress((byte *) samples, &size, packed, packed_size) == MZ_OK
+        && size == length * 4)
+    {
+        DeltaDecode(samples, length);
+
+        SDL_LockMutex(prerender.mutex);
+        free(prerender.samples);
+        prerender.samples = samples;
+        prerender.length = prerender.capacity = length;
+        prerender.loop_start = MIN(LONG(header.loop_start), length - 1);
+        prerender.complete = true;
+        SDL_UnlockMutex(prerender.mutex);
+
+        result = true;
+    }
+    else
+    {
+        free(samples);
+    }
+
+    free(packed);
+    fclose(file);
+
+    return result;
+}
+
+static void SavePrerenderCache(const char *path)
+{
+    prerender_header_t header;
+    int16_t *samples;
+    byte *packed;
+    mz_ulong packed_size;
+    uint32_t size = prerender.length * 4;
+    FILE *file;
+
+    // The render is complete, so the samples are no longer modified.
+
+    samples = malloc(size);
+    memcpy(samples, prerender.samples, size);
+    DeltaEncode(samples, prerender.length);
+
+    packed_size = mz_compressBound(size);
+    packed = malloc(packed_size);
+
+    if (mz_compress2(packed, &packed_size, (byte *) samples, size,
+                     MZ_BEST_SPEED) == MZ_OK)
+    {
+        memcpy(header.magic, PRERENDER_MAGIC, sizeof(header.magic));
+        header.samplerate = LONG(SND_SAMPLERATE);
+        header.length = LONG(prerender.length);
+        header.loop_start = LONG(prerender.loop_start);
+        header.packed_size = LONG(packed_size);
+
+        file = M_fopen(path, "wb");
+
+        if (file != NULL)
+        {
+            boolean ok = fwrite(&header, sizeof(header), 1, file) == 1
+                         && fwrite(packed, 1, packed_size, file) == packed_size;
+
+            fclose(file);
+
+            if (!ok)
+            {
+                M_remove(path);
+            }
+        }
+    }
+
+    free(packed);
+    free(samples);
+}
+
+// Drive the sequencer from the render thread until the song has ended.
+// Returns true if the whole song was rendered.
+
+static boolean RenderSong(void)
+{
+    byte buffer[PRERENDER_CHUNK * 4];
+
+    while (SDL_AtomicGet(&prerender.running)
+           && song_position < num_song_events)
+    {
+        if (prerender.length >= PRERENDER_MAX_LENGTH)
+        {
+            I_Printf(VB_WARNING, "RenderSong: Song is too long to pre-render.");
+            break;
+        }
+
+        OPL_Render(buffer, PRERENDER_CHUNK);
+        AppendSamples(buffer, PRERENDER_CHUNK);
+    }
+
+    SDL_LockMutex(prerender.mutex);
+    prerender.complete = true;
+    SDL_UnlockMutex(prerender.mutex);
+
+    return SDL_AtomicGet(&prerender.running)
+           && song_position >= num_song_events;
+}
+
+static int PrerenderThread(void *unused)
+{
+    char *path = PrerenderCacheFile();
+
+    if (!LoadPrerenderCache(path) && RenderSong() && prerender.length > 0)
+    {
+        SavePrerenderCache(path);
+    }
+
+    free(path);
+
+    return 0;
+}
+
+static void StartPrerender(boolean looping)
+{
+    prerender.samples = NULL;
+    prerender.length = prerender.capacity = 0;
+    prerender.position = prerender.loop_start = 0;
+    prerender.complete = false;
+    prerender.looping = looping;
+    SDL_AtomicSet(&prerender.paused, 0);
+    prerender.active = true;
+
+    // From now on the audio thread plays the rendered samples and leaves
+    // the emulator to the render thread.
+
+    OPL_SetStreamFunc(PrerenderCallback);
+    I_OAL_SetGain((float)opl_gain / 100.0f * music_volume / 15.0f);
+
+    current_music_volume = 127;
+}
+
+static void StopPrerender(void)
+{
+    if (!prerender.active)
+    {
+        return;
+    }
+
+    if (prerender.thread != NULL)
+    {
+        SDL_AtomicSet(&prerender.running, 0);
+        SDL_WaitThread(prerender.thread, NULL);
+        prerender.thread = NULL;
+    }
+
+    OPL_SetStreamFunc(NULL);
+    I_OAL_SetGain((float)opl_gain / 100.0f);
+
+    // The audio thread may still be inside PrerenderCallback().
+
+    SDL_LockMutex(prerender.mutex);
+    free(prerender.samples);
+    prerender.samples = NULL;
+    prerender.length = prerender.capacity = 0;
+    SDL_UnlockMutex(prerender.mutex);
+
+    prerender.active = false;
+
+    current_music_volume = music_volume * 127 / 15;
 }
 
 // Start playing a mid
@@ -1498,26 +1868,26 @@ static void I_OPL_PlaySong(void *handle, boolean looping)
 
     file = handle;
 
-    // Allocate track data.
-
-    tracks = malloc(MIDI_NumTracks(file) * sizeof(opl_track_data_t));
-
-    num_tracks = MIDI_NumTracks(file);
-    running_tracks = num_tracks;
-    song_looping = looping;
+    if (opl_prerender)
+    {
+        StartPrerender(looping);
 
-    ticks_per_beat = MIDI_GetFileTimeDivision(file);
+        // The render thread plays the song through exactly once.
 
-    // Default is 120 bpm.
-    // TODO: this is wrong
+        looping = false;
+    }
 
-    us_per_beat = 500 * 1000;
+    song_events = MIDI_GetMergedEvents(file, &num_song_events);
+    song_position = 0;
+    song_looping = looping;
 
     start_music_volume = current_music_volume;
 
-    for (i = 0; i < num_tracks; ++i)
+    // Schedule the first event.
+
+    if (num_song_events > 0)
     {
-        StartTrack(file, i);
+        ScheduleEvents(0);
     }
 
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
@@ -1530,6 +1900,17 @@ static void I_OPL_PlaySong(void *handle, boolean looping)
     // behavior of the DMX library, and some of the higher-level code in
     // s_sound.c relies on this.
     OPL_SetPaused(0);
+
+    if (prerender.active)
+    {
+        SDL_AtomicSet(&prerender.running, 1);
+        prerender.thread = SDL_CreateThread(PrerenderThread, NULL, NULL);
+        if (prerender.thread == NULL)
+        {
+            I_Printf(VB_ERROR, "Error creating thread: %s", SDL_GetError());
+            SDL_AtomicSet(&prerender.running, 0);
+        }
+    }
 }
 
 static void I_OPL_PauseSong(void *handle)
@@ -1541,6 +1922,12 @@ static void I_OPL_PauseSong(void *handle)
         return;
     }
 
+    if (prerender.active)
+    {
+        SDL_AtomicSet(&prerender.paused, 1);
+        return;
+    }
+
     // Pause OPL callbacks.
 
     OPL_SetPaused(1);
@@ -1565,6 +1952,12 @@ static void I_OPL_ResumeSong(void *handle)
         return;
     }
 
+    if (prerender.active)
+    {
+        SDL_AtomicSet(&prerender.paused, 0);
+        return;
+    }
+
     OPL_SetPaused(0);
 }
 
@@ -1577,6 +1970,10 @@ static void I_OPL_StopSong(void *handle)
         return;
     }
 
+    // The render thread must be stopped first, as it needs the OPL lock.
+
+    StopPrerender();
+
     OPL_Lock();
 
     // Stop all playback.
@@ -1590,17 +1987,11 @@ static void I_OPL_StopSong(void *handle)
         AllNotesOff(&channels[i], 0);
     }
 
-    // Free all track data.
+    // The event list is owned by the MIDI file.
 
-    for (i = 0; i < num_tracks; ++i)
-    {
-        MIDI_FreeIterator(tracks[i].iter);
-    }
-
-    free(tracks);
-
-    tracks = NULL;
-    num_tracks = 0;
+    song_events = NULL;
+    num_song_events = 0;
+    song_position = 0;
 
     OPL_Unlock();
 }
@@ -1667,6 +2058,8 @@ static void *I_OPL_RegisterSong(void *data, int len)
         I_Printf(VB_ERROR, "I_OPL_RegisterSong: Failed to load MID.");
     }
 
+    song_crc = mz_crc32(MZ_CRC32_INIT, data, len);
+
     return result;
 }
 
@@ -1680,7 +2073,7 @@ static boolean I_OPL_MusicIsPlaying(void)
         return false;
     }
 
-    return num_tracks > 0;
+    return song_events != NULL;
 }
 #endif
 
@@ -1696,6 +2089,9 @@ static void I_OPL_ShutdownMusic(void)
 
         OPL_Shutdown();
 
+        SDL_DestroyMutex(prerender.mutex);
+        prerender.mutex = NULL;
+
         // Release GENMIDI lump
 
         Z_ChangeTag(lump, PU_CACHE);
@@ -1717,6 +2113,7 @@ static boolean OPL_InitMusic(void)
     opl_init_result_t chip_type;
 
     OPL_SetSampleRate(SND_SAMPLERATE);
+    OPL_SetNumChips(num_opl_chips);
 
     chip_type = OPL_Init(opl_io_port);
     if (chip_type == OPL_INIT_NONE)
@@ -1736,12 +2133,12 @@ static boolean OPL_InitMusic(void)
     if (chip_type == OPL_INIT_OPL3 && strstr(dmxoption, "-opl3") != NULL)
     {
         opl_opl3mode = 1;
-        num_opl_voices = OPL_NUM_VOICES * 2;
+        num_opl_voices = OPL_NUM_VOICES * 2 * num_opl_chips;
     }
     else
     {
         opl_opl3mode = 0;
-        num_opl_voices = OPL_NUM_VOICES;
+        num_opl_voices = OPL_NUM_VOICES * num_opl_chips;
     }
 
     // Secret, undocumented DMXOPTION that reverses the stereo channels
@@ -1762,8 +2159,10 @@ static boolean OPL_InitMusic(void)
 
     InitVoices();
 
-    tracks = NULL;
-    num_tracks = 0;
+    prerender.mutex = SDL_CreateMutex();
+
+    song_events = NULL;
+    num_song_events = 0;
     music_initialized = true;
 
     return true;
@@ -439,7 +439,8 @@ static void I_PCS_UpdateSoundParams(int channel, int volume, int separation)
     alSourcef(callback_source, AL_GAIN, (float)snd_SfxVolume / 15);
 }
 
-static boolean I_PCS_StartSound(int channel, sfxinfo_t *sfx, int pitch)
+static boolean I_PCS_StartSound(int channel, sfxinfo_t *sfx, int pitch,
+                                int offset)
 {
     boolean result;
 
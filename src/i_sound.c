@@ -245,7 +245,7 @@ int I_GetSfxLumpNum(sfxinfo_t *sfx)
 // active sounds, which is maintained as a given number
 // of internal channels. Returns a free channel.
 //
-int I_StartSound(sfxinfo_t *sfx, int vol, int sep, int pitch)
+int I_StartSound(sfxinfo_t *sfx, int vol, int sep, int pitch, int offset)
 {
   static unsigned int id = 0;
   int channel;
@@ -276,7 +276,7 @@ int I_StartSound(sfxinfo_t *sfx, int vol, int sep, int pitch)
 
   I_UpdateSoundParams(channel, vol, sep);
 
-  if (sound_module->StartSound(channel, sfx, pitch) == false)
+  if (sound_module->StartSound(channel, sfx, pitch, offset) == false)
   {
     I_Printf(VB_WARNING, "I_StartSound: Error playing sfx.");
     StopChannel(channel);
@@ -87,7 +87,7 @@ typedef struct sound_module_s
                                  int chanvol, int *vol, int *sep, int *pri);
     void (*UpdateSoundParams)(int channel, int vol, int sep);
     void (*UpdateListenerParams)(const mobj_t *listener);
-    boolean (*StartSound)(int channel, sfxinfo_t *sfx, int pitch);
+    boolean (*StartSound)(int channel, sfxinfo_t *sfx, int pitch, int offset);
     void (*StopSound)(int channel);
     boolean (*SoundIsPlaying)(int channel);
     void (*ShutdownSound)(void);
@@ -120,7 +120,8 @@ void I_SetChannels(void);
 int I_GetSfxLumpNum(sfxinfo_t *sfxinfo);
 
 // Starts a sound in a particular sound channel.
-int I_StartSound(sfxinfo_t *sound, int vol, int sep, int pitch);
+// The offset in milliseconds is only honoured by the OpenAL modules.
+int I_StartSound(sfxinfo_t *sound, int vol, int sep, int pitch, int offset);
 
 // Stops a sound channel.
 void I_StopSound(int handle);
@@ -38,6 +38,7 @@
 #include "i_input.h"
 #include "i_video.h"
 #include "m_io.h"
+#include "m_trace.h"
 
 // [FG] set the application icon
 
@@ -80,10 +81,16 @@ char *sdl_renderdriver = "";
 static SDL_Window *screen;
 static SDL_Renderer *renderer;
 static SDL_Surface *screenbuffer;
+#ifndef TRUECOLOR
 static SDL_Surface *argbbuffer;
+#else
+static SDL_Color tint; // palette flashes, drawn over the frame
+#endif
 static SDL_Texture *texture;
 static SDL_Texture *texture_upscaled;
 static SDL_Rect blit_rect = {0};
+static SDL_Rect upscaled_rect = {0}; // part of texture_upscaled in use
+static boolean upscaling;
 
 static int window_x, window_y;
 static int actualheight;
@@ -550,41 +557,86 @@ void I_StartFrame(void)
 
 }
 
+#ifdef TRUECOLOR
+static void DrawTint(void)
+{
+    Uint8 r, g, b, a;
+
+    if (!tint.a)
+    {
+        return;
+    }
+
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, tint.r, tint.g, tint.b, tint.a);
+    SDL_RenderFillRect(renderer, NULL);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+#endif
+
 static void UpdateRender(void)
 {
+#ifdef TRUECOLOR
+    // [Woof!] The frame buffer already holds texture pixels.
+    SDL_UpdateTexture(texture, &blit_rect, screenbuffer->pixels, screenbuffer->pitch);
+#else
     SDL_LowerBlit(screenbuffer, &blit_rect, argbbuffer, &blit_rect);
     SDL_UpdateTexture(texture, &blit_rect, argbbuffer->pixels, argbbuffer->pitch);
+#endif
     SDL_RenderClear(renderer);
 
-    if (texture_upscaled)
+    if (upscaling)
     {
         // Render this intermediate texture into the upscaled texture
         // using "nearest" integer scaling.
 
         SDL_SetRenderTarget(renderer, texture_upscaled);
-        SDL_RenderCopy(renderer, texture, &blit_rect, NULL);
+        SDL_RenderCopy(renderer, texture, &blit_rect, &upscaled_rect);
 
         // Finally, render this upscaled texture to screen using linear scaling.
 
         SDL_SetRenderTarget(renderer, NULL);
-        SDL_RenderCopy(renderer, texture_upscaled, NULL, NULL);
+        SDL_RenderCopy(renderer, texture_upscaled, &upscaled_rect, NULL);
     }
     else
     {
         SDL_RenderCopy(renderer, texture, &blit_rect, NULL);
     }
+
+#ifdef TRUECOLOR
+    DrawTint();
+#endif
 }
 
 static uint64_t frametime_start, frametime_withoutpresent;
 
 static void ResetResolution(int height, boolean reset_pitch);
-static void ResetLogicalSize(void);
+static void ResetLogicalSize(boolean force);
+
+#define DRS_DELTA 0.1
+#define DRS_GREATER (1 + DRS_DELTA)
+#define DRS_LESS (1 - DRS_DELTA / 2.0)
+#define DRS_AIM (1 - DRS_DELTA)
+#define DRS_STEP (SCREENHEIGHT / 2)
+
+// The view gets at least this share of the frame, however long the rest
+// of the frame takes.
+#define DRS_MIN_BUDGET 0.25
 
 void I_DynamicResolution(void)
 {
+    // Each sample is used once. Frames that don't render the view (automap,
+    // menus over a paused game) leave no sample, so the controller isn't
+    // fed the render time of a frame it has already seen.
+
+    const uint64_t render_time = rendered_time;
+    rendered_time = 0;
+
     if (!dynamic_resolution || current_video_height <= DRS_MIN_HEIGHT ||
-        frametime_withoutpresent == 0 || targetrefresh <= 0 ||
-        menuactive)
+        frametime_withoutpresent == 0 || render_time == 0 ||
+        targetrefresh <= 0 || menuactive)
     {
         return;
     }
@@ -597,37 +649,46 @@ void I_DynamicResolution(void)
     }
 
     static int frame_counter;
-    static double averagepercent;
+    static double percentsum;
 
     // 1.25 milliseconds for SDL render present
     double target = (1.0 / targetrefresh) - 0.00125;
     double actual = frametime_withoutpresent / 1000000.0;
+    double render = MIN(actual, render_time / 1000000.0);
 
-    double actualpercent = actual / target;
+    // Only the time spent rendering the view depends on the resolution.
+    // Whatever the rest of the frame takes is subtracted from the target.
 
-    #define DRS_DELTA 0.1
-    #define DRS_GREATER (1 + DRS_DELTA)
-    #define DRS_LESS (1 - DRS_DELTA / 10.0)
-    #define DRS_STEP (SCREENHEIGHT / 2)
+    double budget = MAX(target - (actual - render), target * DRS_MIN_BUDGET);
+    double actualpercent = render / budget;
 
     int newheight = 0;
     int oldheight = video.height;
 
-    // Decrease the resolution quickly, increase only when the average frame
-    // time is stable for the `targetrefresh` number of frames.
+    // Decrease the resolution quickly, increase only when the average render
+    // time is stable for the `targetrefresh` number of frames. Render time
+    // grows with the number of pixels, i.e. with the square of the height.
 
     frame_counter++;
-    averagepercent = (averagepercent + actualpercent) / frame_counter;
+    percentsum += actualpercent;
 
     if (actualpercent > DRS_GREATER)
     {
-        double reduction = (actualpercent - DRS_GREATER ) * 0.4;
-        newheight = (int)MAX(DRS_MIN_HEIGHT, oldheight - oldheight * reduction);
+        newheight = (int)(oldheight * sqrt(DRS_AIM / actualpercent));
     }
-    else if (averagepercent < DRS_LESS && frame_counter > targetrefresh)
+    else if (frame_counter > targetrefresh)
     {
-        double addition = (DRS_LESS - averagepercent) * 0.25;
-        newheight = (int)MIN(current_video_height, oldheight + oldheight * addition);
+        double averagepercent = percentsum / frame_counter;
+
+        frame_counter = 0;
+        percentsum = 0.0;
+
+        if (averagepercent >= DRS_LESS)
+        {
+            return;
+        }
+
+        newheight = (int)(oldheight * MIN(1.25, sqrt(DRS_AIM / averagepercent)));
     }
     else
     {
@@ -635,15 +696,10 @@ void I_DynamicResolution(void)
     }
 
     frame_counter = 0;
+    percentsum = 0.0;
 
-    int mul = (newheight + (DRS_STEP - 1)) / DRS_STEP; // integer round
-
-    newheight = mul * DRS_STEP;
-
-    if (newheight > current_video_height)
-    {
-        newheight -= DRS_STEP;
-    }
+    newheight = (newheight + DRS_STEP / 2) / DRS_STEP * DRS_STEP; // round
+    newheight = BETWEEN(DRS_MIN_HEIGHT, current_video_height, newheight);
 
     if (newheight == oldheight)
     {
@@ -659,8 +715,11 @@ void I_DynamicResolution(void)
         VX_IncreaseMaxDist();
     }
 
+    // Everything is allocated for the full resolution, only the view
+    // parameters and the blit rectangle change here.
+
     ResetResolution(newheight, false);
-    ResetLogicalSize();
+    ResetLogicalSize(false);
 }
 
 static void I_DrawDiskIcon(), I_RestoreDiskBackground();
@@ -676,6 +735,8 @@ void I_FinishUpdate(void)
         return;
     }
 
+    TRACE_BEGIN("I_FinishUpdate");
+
     if (toggle_fullscreen)
     {
         I_ToggleFullScreen();
@@ -763,13 +824,15 @@ void I_FinishUpdate(void)
         setrefreshneeded = false;
         I_ResetTargetRefresh();
     }
+
+    TRACE_END();
 }
 
 //
 // I_ReadScreen
 //
 
-void I_ReadScreen(byte *dst)
+void I_ReadScreen(pixel_t *dst)
 {
     V_GetBlock(0, 0, video.width, video.height, dst);
 }
@@ -862,6 +925,97 @@ static void I_RestoreDiskBackground(void)
 
 int gamma2;
 
+#ifdef TRUECOLOR
+
+// [Woof!] The renderer only draws with the first palette. Whenever the
+// gamma level changes, its pixels and everything drawn from them ahead of
+// time are rebuilt.
+
+static void UpdatePixels(const byte *gamma)
+{
+    static int lastgamma = -1;
+    const byte *playpal;
+    int i;
+
+    if (lastgamma == gamma2)
+    {
+        return;
+    }
+
+    playpal = W_CacheLumpName("PLAYPAL", PU_CACHE);
+
+    for (i = 0; i < 256; ++i)
+    {
+        v_palette[i] = 0xff000000 | (gamma[playpal[3 * i + 0]] << 16)
+                       | (gamma[playpal[3 * i + 1]] << 8)
+                       | gamma[playpal[3 * i + 2]];
+    }
+
+    R_UpdateColormaps();
+
+    // The first call comes before there is anything to redraw.
+    if (lastgamma != -1)
+    {
+        I_InitDiskFlash();
+        ST_refreshBackground(true);
+        R_FillBackScreen();
+    }
+
+    lastgamma = gamma2;
+}
+
+// The other palettes are fitted as the first one blended with a solid
+// colour, base * (1 - a) + tint * a, by least squares. The blend itself is
+// left to the renderer.
+
+static void UpdateTint(const SDL_Color *colors)
+{
+    double mean_base[3] = {0}, mean_pal[3] = {0};
+    double cov = 0, var = 0, k;
+    int i, c;
+
+    for (i = 0; i < 256; ++i)
+    {
+        const int pal[3] = {colors[i].r, colors[i].g, colors[i].b};
+
+        for (c = 0; c < 3; ++c)
+        {
+            mean_base[c] += ((v_palette[i] >> (16 - 8 * c)) & 0xff) / 256.0;
+            mean_pal[c] += pal[c] / 256.0;
+        }
+    }
+
+    for (i = 0; i < 256; ++i)
+    {
+        const int pal[3] = {colors[i].r, colors[i].g, colors[i].b};
+
+        for (c = 0; c < 3; ++c)
+        {
+            const double base = ((v_palette[i] >> (16 - 8 * c)) & 0xff) - mean_base[c];
+
+            cov += base * (pal[c] - mean_pal[c]);
+            var += base * base;
+        }
+    }
+
+    k = var > 0 ? BETWEEN(0.0, 1.0, cov / var) : 1.0;
+    tint.a = (Uint8)((1 - k) * 255 + 0.5);
+
+    if (tint.a)
+    {
+        Uint8 *const channel[3] = {&tint.r, &tint.g, &tint.b};
+
+        for (c = 0; c < 3; ++c)
+        {
+            const double t = (mean_pal[c] - k * mean_base[c]) / (1 - k);
+
+            *channel[c] = (Uint8)BETWEEN(0.0, 255.0, t + 0.5);
+        }
+    }
+}
+
+#endif
+
 void I_SetPalette(byte *palette)
 {
   // haleyjd
@@ -879,7 +1033,12 @@ void I_SetPalette(byte *palette)
     colors[i].b = gamma[*palette++];
   }
 
+#ifdef TRUECOLOR
+  UpdatePixels(gamma);
+  UpdateTint(colors);
+#else
   SDL_SetPaletteColors(screenbuffer->format->palette, colors, 0, 256);
+#endif
 
   if (vga_porch_flash)
   {
@@ -1111,22 +1270,35 @@ static double CurrentAspectRatio(void)
     return aspect_ratio;
 }
 
+static int ActualHeight(int height)
+{
+    return use_aspect ? (int)(height * 1.2) : height;
+}
+
+// Unscaled widescreen 16:9 resolution truncates to 426x240, which is not
+// quite 16:9. To avoid visual instability, we calculate the scaled width
+// without the actual aspect ratio. For example, at 1280x720 we get
+// 1278x720.
+
+static int ScaledWidth(int height)
+{
+    double vertscale = (double)ActualHeight(height) / (double)unscaled_actualheight;
+    return (int)ceil(video.unscaledw * vertscale);
+}
+
+// Without reset_pitch, only the view parameters change. This is what
+// dynamic resolution does, staying within the buffers allocated for the
+// pitch and height of the last full reset.
+
 static void ResetResolution(int height, boolean reset_pitch)
 {
     double aspect_ratio = CurrentAspectRatio();
 
-    actualheight = use_aspect ? (int)(height * 1.2) : height;
+    actualheight = ActualHeight(height);
     video.height = height;
 
     video.unscaledw = (int)(unscaled_actualheight * aspect_ratio);
-
-    // Unscaled widescreen 16:9 resolution truncates to 426x240, which is not
-    // quite 16:9. To avoid visual instability, we calculate the scaled width
-    // without the actual aspect ratio. For example, at 1280x720 we get
-    // 1278x720.
-
-    double vertscale = (double)actualheight / (double)unscaled_actualheight;
-    video.width = (int)ceil(video.unscaledw * vertscale);
+    video.width = ScaledWidth(height);
 
     // [FG] For performance reasons, SDL2 insists that the screen pitch, i.e.
     // the *number of bytes* that one horizontal row of pixels occupy in
@@ -1135,14 +1307,17 @@ static void ResetResolution(int height, boolean reset_pitch)
     if (reset_pitch)
     {
         video.pitch = (video.width + 3) & ~3;
+
+        // Visplanes are sized for the pitch.
+        Z_FreeTag(PU_VALLOC);
+        R_InitVisplanesRes();
+
+        drs_skip_frame = true;
     }
 
     video.deltaw = (video.unscaledw - NONWIDEWIDTH) / 2;
 
-    Z_FreeTag(PU_VALLOC);
-
     V_Init();
-    R_InitVisplanesRes();
     R_SetFuzzColumnMode();
     setsizeneeded = true; // run R_ExecuteSetViewSize
 
@@ -1150,8 +1325,6 @@ static void ResetResolution(int height, boolean reset_pitch)
       AM_ResetScreenSize();
 
     I_Printf(VB_DEBUG, "ResetResolution: %dx%d", video.width, video.height);
-
-    drs_skip_frame = true;
 }
 
 static void DestroyUpscaledTexture(void)
@@ -1161,13 +1334,50 @@ static void DestroyUpscaledTexture(void)
         SDL_DestroyTexture(texture_upscaled);
         texture_upscaled = NULL;
     }
+
+    upscaling = false;
 }
 
+// Pick texture size the next integer multiple of the screen dimensions.
+// If one screen dimension matches an integer multiple of the original
+// resolution, there is no need to overscale in this direction.
+
+static void UpscaledSize(const SDL_RendererInfo *info, int w, int h,
+                         int screen_width, int screen_height,
+                         int *w_upscale, int *h_upscale)
+{
+    *w_upscale = (w + screen_width - 1) / screen_width;
+    *h_upscale = (h + screen_height - 1) / screen_height;
+
+    while (*w_upscale * screen_width > info->max_texture_width)
+    {
+        --*w_upscale;
+    }
+    while (*h_upscale * screen_height > info->max_texture_height)
+    {
+        --*h_upscale;
+    }
+
+    if (*w_upscale < 1)
+    {
+        *w_upscale = 1;
+    }
+    if (*h_upscale < 1)
+    {
+        *h_upscale = 1;
+    }
+}
+
+// The upscaled texture is only created anew if forced or if it is too small.
+// With dynamic resolution, it is made large enough for every height that
+// I_DynamicResolution() may pick, so that changing the resolution only
+// changes the part of the texture in use.
+
 static void CreateUpscaledTexture(boolean force)
 {
     SDL_RendererInfo info;
     int w, h, w_upscale, h_upscale;
-    static int h_upscale_old, w_upscale_old;
+    static int texture_w, texture_h;
 
     const int screen_width = video.width;
     const int screen_height = video.height;
@@ -1205,68 +1415,89 @@ static void CreateUpscaledTexture(boolean force)
         w = h * screen_width / actualheight;
     }
 
-    // Pick texture size the next integer multiple of the screen dimensions.
-    // If one screen dimension matches an integer multiple of the original
-    // resolution, there is no need to overscale in this direction.
-
-    w_upscale = (w + screen_width - 1) / screen_width;
-    h_upscale = (h + screen_height - 1) / screen_height;
+    UpscaledSize(&info, w, h, screen_width, screen_height,
+                 &w_upscale, &h_upscale);
 
-    while (w_upscale * screen_width > info.max_texture_width)
-    {
-        --w_upscale;
-    }
-    while (h_upscale * screen_height > info.max_texture_height)
+    if (force)
     {
-        --h_upscale;
+        DestroyUpscaledTexture();
     }
 
-    if (w_upscale < 1)
-    {
-        w_upscale = 1;
-    }
-    if (h_upscale < 1)
+    if (!texture_upscaled
+        || (w_upscale > 1 && (w_upscale * screen_width > texture_w
+                              || h_upscale * screen_height > texture_h)))
     {
-        h_upscale = 1;
-    }
+        int height = DRS_MIN_HEIGHT - DRS_STEP;
 
-    // Create a new texture only if the upscale factors have actually changed.
+        DestroyUpscaledTexture();
 
-    if (h_upscale == h_upscale_old && w_upscale == w_upscale_old && !force)
-    {
-        return;
-    }
+        texture_w = texture_h = 0;
 
-    h_upscale_old = h_upscale;
-    w_upscale_old = w_upscale;
+        if (w_upscale > 1)
+        {
+            texture_w = w_upscale * screen_width;
+            texture_h = h_upscale * screen_height;
+        }
 
-    DestroyUpscaledTexture();
+        // Every height that dynamic resolution may pick, up to the full one.
 
-    if (w_upscale == 1)
+        while (dynamic_resolution && height < current_video_height)
+        {
+            int wu, hu, sw;
+
+            height = MIN(height + DRS_STEP, current_video_height);
+            sw = ScaledWidth(height);
+
+            UpscaledSize(&info, w, h, sw, height, &wu, &hu);
+
+            if (wu > 1)
+            {
+                texture_w = MAX(texture_w, wu * sw);
+                texture_h = MAX(texture_h, hu * height);
+            }
+        }
+
+        if (texture_w)
+        {
+            // Set the scaling quality for rendering the upscaled texture
+            // to "linear", which looks much softer and smoother than
+            // "nearest" but does a better job at downscaling from the
+            // upscaled texture to screen.
+
+            texture_upscaled = SDL_CreateTexture(renderer,
+                                                 SDL_GetWindowPixelFormat(screen),
+                                                 SDL_TEXTUREACCESS_TARGET,
+                                                 texture_w, texture_h);
+
+            SDL_SetTextureScaleMode(texture_upscaled, SDL_ScaleModeLinear);
+        }
+    }
+
+    if (w_upscale == 1 || !texture_upscaled)
     {
+        upscaling = false;
         SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
         return;
     }
-    else
-    {
-        SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
-    }
 
-    // Set the scaling quality for rendering the upscaled texture
-    // to "linear", which looks much softer and smoother than "nearest"
-    // but does a better job at downscaling from the upscaled texture to
-    // screen.
+    upscaled_rect.w = w_upscale * screen_width;
+    upscaled_rect.h = h_upscale * screen_height;
 
-    texture_upscaled = SDL_CreateTexture(renderer,
-                                         SDL_GetWindowPixelFormat(screen),
-                                         SDL_TEXTUREACCESS_TARGET,
-                                         w_upscale * screen_width,
-                                         h_upscale * screen_height);
+    // Clear what is left of a larger picture, linear scaling samples
+    // across the edges of the rectangle.
 
-    SDL_SetTextureScaleMode(texture_upscaled, SDL_ScaleModeLinear);
+    if (texture_w > upscaled_rect.w || texture_h > upscaled_rect.h)
+    {
+        SDL_SetRenderTarget(renderer, texture_upscaled);
+        SDL_RenderClear(renderer);
+        SDL_SetRenderTarget(renderer, NULL);
+    }
+
+    upscaling = true;
+    SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
 }
 
-static void ResetLogicalSize(void)
+static void ResetLogicalSize(boolean force)
 {
     blit_rect.w = video.width;
     blit_rect.h = video.height;
@@ -1278,7 +1509,7 @@ static void ResetLogicalSize(void)
 
     if (smooth_scaling)
     {
-        CreateUpscaledTexture(true);
+        CreateUpscaledTexture(force);
     }
     else
     {
@@ -1552,14 +1783,23 @@ static void CreateSurfaces(int w, int h)
         SDL_FreeSurface(screenbuffer);
     }
 
+#ifdef TRUECOLOR
+    // [Woof!] The true-colour one is in the texture format instead, so
+    // that it needs no conversion.
+    screenbuffer = SDL_CreateRGBSurfaceWithFormat(0,
+                                                  w, h, 32,
+                                                  SDL_PIXELFORMAT_ARGB8888);
+#else
     screenbuffer = SDL_CreateRGBSurface(0,
                                         w, h, 8,
                                         0, 0, 0, 0);
+#endif
     SDL_FillRect(screenbuffer, NULL, 0);
 
     I_VideoBuffer = screenbuffer->pixels;
     V_RestoreBuffer();
 
+#ifndef TRUECOLOR
     if (argbbuffer != NULL)
     {
         SDL_FreeSurface(argbbuffer);
@@ -1577,6 +1817,7 @@ static void CreateSurfaces(int w, int h)
                                           rmask, gmask, bmask, amask);
         SDL_FillRect(argbbuffer, NULL, 0);
     }
+#endif
 
     I_SetPalette(W_CacheLumpName("PLAYPAL", PU_CACHE));
 
@@ -1588,7 +1829,11 @@ static void CreateSurfaces(int w, int h)
     }
 
     texture = SDL_CreateTexture(renderer,
+#ifdef TRUECOLOR
+                                SDL_PIXELFORMAT_ARGB8888,
+#else
                                 SDL_GetWindowPixelFormat(screen),
+#endif
                                 SDL_TEXTUREACCESS_STREAMING,
                                 w, h);
 
@@ -1631,7 +1876,7 @@ static void I_ReinitGraphicsMode(void)
     I_InitGraphicsMode();
     ResetResolution(CurrentResolutionHeight(), true);
     CreateSurfaces(video.pitch, video.height);
-    ResetLogicalSize();
+    ResetLogicalSize(true);
 }
 
 void I_ResetScreen(void)
@@ -1642,7 +1887,7 @@ void I_ResetScreen(void)
 
     ResetResolution(CurrentResolutionHeight(), true);
     CreateSurfaces(video.pitch, video.height);
-    ResetLogicalSize();
+    ResetLogicalSize(true);
 
     SDL_SetWindowMinimumSize(screen, video.unscaledw * 2,
                              use_aspect ? ACTUALHEIGHT * 2 : SCREENHEIGHT * 2);
@@ -1671,7 +1916,7 @@ void I_InitGraphics(void)
     I_InitGraphicsMode();    // killough 10/98
     ResetResolution(CurrentResolutionHeight(), true);
     CreateSurfaces(video.pitch, video.height);
-    ResetLogicalSize();
+    ResetLogicalSize(true);
 }
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,219 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Persistent cache for tables derived from WAD data at startup.
+//
+//      Each entry is a header followed by the raw table, so a hit is a
+//      single read into the final buffer. Entries are written in host
+//      byte order and are not meant to be shared between machines.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "m_cache.h"
+
+#include "d_main.h"
+#include "i_printf.h"
+#include "m_array.h"
+#include "m_io.h"
+#include "m_misc2.h"
+#include "w_wad.h"
+
+#define CACHE_VERSION 1
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t size;
+    uint64_t checksum;
+} cacheheader_t;
+
+static const char cache_magic[8] = {'W', 'O', 'O', 'F', 'C', 'A', 'C', 'H'};
+
+static uint64_t Mix(uint64_t hash, uint64_t value)
+{
+    hash ^= value;
+    hash *= 0xff51afd7ed558ccdull;
+    return hash ^ (hash >> 32);
+}
+
+uint64_t M_CacheHash(const void *data, size_t size, uint64_t hash)
+{
+    const byte *p = data;
+    uint64_t value;
+
+    hash = Mix(hash, size);
+
+    for (; size >= sizeof(value); p += sizeof(value), size -= sizeof(value))
+    {
+        memcpy(&value, p, sizeof(value));
+        hash = Mix(hash, value);
+    }
+
+    if (size)
+    {
+        value = 0;
+        memcpy(&value, p, size);
+        hash = Mix(hash, value);
+    }
+
+    return hash;
+}
+
+uint64_t M_CacheWadKey(void)
+{
+    static uint64_t key;
+    static boolean valid;
+    int i;
+
+    if (valid)
+    {
+        return key;
+    }
+
+    key = CACHE_VERSION;
+
+    for (i = 0; i < array_size(wadfiles); ++i)
+    {
+        struct stat st;
+
+        key = M_CacheHash(wadfiles[i], strlen(wadfiles[i]), key);
+
+        if (M_stat(wadfiles[i], &st) == 0)
+        {
+            key = Mix(key, st.st_size);
+            key = Mix(key, st.st_mtime);
+        }
+    }
+
+    // Marker lumps only have their name, size and namespace set, and
+    // nothing after the terminator of a short name is initialized.
+
+    for (i = 0; i < numlumps; ++i)
+    {
+        const lumpinfo_t *lump = &lumpinfo[i];
+
+        key = M_CacheHash(lump->name, strnlen(lump->name, 8), key);
+        key = Mix(key, ((uint64_t)lump->size << 8) | lump->namespace);
+
+        if (lump->size)
+        {
+            key = Mix(key, lump->position);
+        }
+    }
+
+    valid = true;
+
+    return key;
+}
+
+static char *CachePath(const char *name, uint64_t key)
+{
+    char *dir, *path, file[64];
+
+    M_snprintf(file, sizeof(file), "%s-%08x%08x.dat", name,
+               (unsigned int)(key >> 32), (unsigned int)key);
+
+    dir = M_StringJoin(D_DoomPrefDir(), DIR_SEPARATOR_S, "cache", NULL);
+    M_MakeDirectory(dir);
+    path = M_StringJoin(dir, DIR_SEPARATOR_S, file, NULL);
+    free(dir);
+
+    return path;
+}
+
+boolean M_ReadCache(const char *name, uint64_t key, void *dest, size_t size)
+{
+    cacheheader_t header;
+    boolean result;
+    char *path;
+    FILE *file;
+
+    path = CachePath(name, key);
+    file = M_fopen(path, "rb");
+    free(path);
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    result = fread(&header, sizeof(header), 1, file) == 1
+             && !memcmp(header.magic, cache_magic, sizeof(cache_magic))
+             && header.version == CACHE_VERSION
+             && header.key == key
+             && header.size == size
+             && fread(dest, 1, size, file) == size
+             && header.checksum == M_CacheHash(dest, size, 0);
+
+    fclose(file);
+
+    if (!result)
+    {
+        I_Printf(VB_DEBUG, "M_ReadCache: stale or damaged entry for %s", name);
+    }
+
+    return result;
+}
+
+void M_WriteCache(const char *name, uint64_t key, const void *data,
+                  size_t size)
+{
+    cacheheader_t header = {0};
+    boolean result;
+    char *path, *temp;
+    FILE *file;
+
+    path = CachePath(name, key);
+    temp = M_StringJoin(path, ".tmp", NULL);
+
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.size = size;
+    header.checksum = M_CacheHash(data, size, 0);
+
+    // Write to a temporary file first, so that an interrupted write
+    // never leaves a truncated entry behind under the final name.
+
+    file = M_fopen(temp, "wb");
+    result = file != NULL
+             && fwrite(&header, sizeof(header), 1, file) == 1
+             && fwrite(data, 1, size, file) == size;
+
+    if (file && fclose(file))
+    {
+        result = false;
+    }
+
+    if (result)
+    {
+        M_remove(path);
+        result = !M_rename(temp, path);
+    }
+
+    if (!result)
+    {
+        M_remove(temp);
+        I_Printf(VB_WARNING, "M_WriteCache: failed to write %s", path);
+    }
+
+    free(temp);
+    free(path);
+}
@@ -0,0 +1,38 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Persistent cache for tables derived from WAD data at startup.
+//
+
+#ifndef __M_CACHE__
+#define __M_CACHE__
+
+#include "doomtype.h"
+
+// Hash a block of memory, continuing from a previous hash or 0.
+uint64_t M_CacheHash(const void *data, size_t size, uint64_t hash);
+
+// Key for tables that depend on the loaded lumps: a hash of the lump
+// directory and of the size and modification time of every loaded file.
+uint64_t M_CacheWadKey(void);
+
+// Tables are stored as flat files in the "cache" subdirectory of
+// D_DoomPrefDir(), one per name and key. Callers mix any settings a
+// table depends on into its key. M_ReadCache() fails unless a valid
+// entry of exactly the given size exists.
+boolean M_ReadCache(const char *name, uint64_t key, void *dest, size_t size);
+void M_WriteCache(const char *name, uint64_t key, const void *data,
+                  size_t size);
+
+#endif
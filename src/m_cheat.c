@@ -730,6 +730,7 @@ static void cheat_skill(char *buf)
 
     G_SetFastParms(fastparm || gameskill == sk_nightmare);
     respawnmonsters = gameskill == sk_nightmare || respawnparm;
+    P_WakeThinkers();   // [Woof!] corpses may have to respawn now
   }
 }
 
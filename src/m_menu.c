@@ -32,6 +32,7 @@
 #include "v_video.h"
 #include "w_wad.h"
 #include "r_main.h"
+#include "r_data.h" // tran_filter_pct
 #include "hu_stuff.h"
 #include "g_game.h"
 #include "s_sound.h"
@@ -3785,7 +3786,7 @@ static void M_DrawCompat(void)
 // The General table.
 // killough 10/10/98
 
-extern int realtic_clock_rate, tran_filter_pct;
+extern int realtic_clock_rate;
 
 setup_menu_t gen_settings1[];
 setup_menu_t gen_settings2[];
@@ -4146,6 +4147,7 @@ enum {
   gen5_linear_sky,
   gen5_swirl,
   gen5_smoothlight,
+  gen5_spanplanes,
   gen5_gap2,
 
   gen5_menu_background,
@@ -4365,6 +4367,8 @@ setup_menu_t gen_settings5[] = {
   {"Smooth Diminishing Lighting", S_YESNO, m_null, M_X, M_SPC,
    {"smoothlight"}, 0, M_SmoothLight},
 
+  {"Span Plane Renderer", S_YESNO, m_null, M_X, M_SPC, {"r_spanplanes"}},
+
   {"", S_SKIP, m_null, M_X, M_SPC},
 
   {"Menu Backdrop", S_CHOICE, m_null, M_X, M_SPC,
@@ -42,8 +42,10 @@
 #include "s_sound.h"
 #include "sounds.h"
 #include "d_main.h"
+#include "r_data.h" // tran_filter_pct
 #include "r_draw.h" // [FG] fuzzcolumn_mode
 #include "r_sky.h" // [FG] stretchsky
+#include "r_plane.h" // [Woof!] r_spanplanes
 #include "hu_lib.h" // HU_MAXMESSAGES
 #include "net_client.h" // net_player_name
 #include "i_gamepad.h"
@@ -63,7 +65,6 @@ extern int dclick_use;
 // [FG] invert vertical axis
 extern int mouse_y_invert;
 extern int realtic_clock_rate;         // killough 4/13/98: adjustable timer
-extern int tran_filter_pct;            // killough 2/21/98
 extern int showMessages;
 extern int show_toggle_messages;
 extern int show_pickup_messages;
@@ -89,6 +90,8 @@ extern int winmm_reset_type;
 extern int winmm_reset_delay;
 #endif
 extern int opl_gain;
+extern boolean opl_prerender;
+extern int num_opl_chips;
 extern boolean demobar;
 extern boolean smoothlight;
 extern boolean brightmaps;
@@ -308,6 +311,13 @@ default_t defaults[] = {
     "1 for linear horizontal sky scrolling "
   },
 
+  {
+    "r_spanplanes",
+    (config_t *) &r_spanplanes, NULL,
+    {0}, {0,1}, number, ss_gen, wad_no,
+    "1 to draw floors and ceilings from row spans instead of visplanes"
+  },
+
   { // phares
     "translucency",
     (config_t *) &translucency, NULL,
@@ -529,6 +539,20 @@ default_t defaults[] = {
     "fine tune OPL emulation output level (default 200%)"
   },
 
+  {
+    "opl_prerender",
+    (config_t *) &opl_prerender, NULL,
+    {0}, {0, 1}, number, ss_none, wad_no,
+    "1 to render OPL music once and play it back from a cache"
+  },
+
+  {
+    "num_opl_chips",
+    (config_t *) &num_opl_chips, NULL,
+    {1}, {1, 6}, number, ss_none, wad_no,
+    "Number of emulated OPL chips (1-6)"
+  },
+
 #if defined(_WIN32)
   {
     "winmm_device",
@@ -115,14 +115,18 @@ static void M_TakeSnapshot (void)
 
   byte *p = current_snapshot;
 
-  const byte *s = I_VideoBuffer;
+  const pixel_t *s = I_VideoBuffer;
 
   int x, y;
   for (y = 0; y < SCREENHEIGHT; y++)
   {
     for (x = video.deltaw; x < NONWIDEWIDTH + video.deltaw; x++)
     {
+#ifdef TRUECOLOR
+      *p++ = V_PixelIndex(s[V_ScaleY(y) * video.pitch + V_ScaleX(x)]);
+#else
       *p++ = s[V_ScaleY(y) * video.pitch + V_ScaleX(x)];
+#endif
     }
   }
 
@@ -163,11 +167,12 @@ boolean M_DrawSnapshot (int n, int x, int y, int w, int h)
   const fixed_t step_x = (SCREENWIDTH << FRACBITS) / rect.sw;
   const fixed_t step_y = (SCREENHEIGHT << FRACBITS) / rect.sh;
 
-  byte *dest = I_VideoBuffer + rect.sy * video.pitch + rect.sx;
+  pixel_t *dest = I_VideoBuffer + rect.sy * video.pitch + rect.sx;
 
   fixed_t srcx, srcy;
   int destx, desty;
-  byte *destline, *srcline;
+  pixel_t *destline;
+  byte *srcline;
 
   for (desty = 0, srcy = 0; desty < rect.sh; desty++, srcy += step_y)
   {
@@ -176,7 +181,7 @@ boolean M_DrawSnapshot (int n, int x, int y, int w, int h)
 
     for (destx = 0, srcx = 0; destx < rect.sw; destx++, srcx += step_x)
     {
-      *destline++ = srcline[srcx >> FRACBITS];
+      *destline++ = V_Pixel(srcline[srcx >> FRACBITS]);
     }
   }
 
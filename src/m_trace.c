@@ -0,0 +1,257 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Frame timeline trace (-trace), written as Chrome trace JSON.
+//
+//      Every thread that opens a zone gets its own ring buffer, so
+//      recording a zone takes no locks. Only the most recent events of
+//      each thread are kept; they are written out when the program
+//      exits, also after an error. The buffer of a thread that has
+//      finished is handed to the next new thread, so threads that are
+//      started over and over (the demo writer) share one buffer.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "m_trace.h"
+
+#include "i_printf.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_io.h"
+#include "m_misc2.h"
+
+#define NUMEVENTS (1 << 17) // per thread, a few minutes of frames
+#define MAXDEPTH 32
+
+typedef struct
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} event_t;
+
+typedef struct tracebuf_s
+{
+    event_t events[NUMEVENTS];
+    unsigned int count;     // events recorded, may exceed NUMEVENTS
+
+    struct
+    {
+        const char *name;
+        uint64_t start;
+    } stack[MAXDEPTH];
+    int depth;              // may exceed MAXDEPTH, deeper zones are dropped
+
+    int id;
+    boolean finished;       // the owning thread has exited
+    struct tracebuf_s *next;
+} tracebuf_t;
+
+boolean trace_enabled;
+
+static char *tracefile;
+static SDL_TLSID tls;
+static SDL_mutex *mutex;    // protects the list of buffers
+static tracebuf_t *buffers;
+static int numbuffers;
+static uint64_t basetime, frequency;
+
+// Called by SDL when a thread that used a buffer exits.
+
+static void ReleaseBuffer(void *data)
+{
+    tracebuf_t *buf = data;
+
+    SDL_LockMutex(mutex);
+    buf->finished = true;
+    SDL_UnlockMutex(mutex);
+}
+
+static tracebuf_t *GetBuffer(void)
+{
+    tracebuf_t *buf = SDL_TLSGet(tls);
+
+    if (!buf)
+    {
+        SDL_LockMutex(mutex);
+
+        for (buf = buffers; buf; buf = buf->next)
+        {
+            if (buf->finished)
+            {
+                buf->finished = false;
+                buf->depth = 0;
+                break;
+            }
+        }
+
+        if (!buf && (buf = calloc(1, sizeof(*buf))))
+        {
+            buf->id = ++numbuffers;
+            buf->next = buffers;
+            buffers = buf;
+        }
+
+        SDL_UnlockMutex(mutex);
+
+        if (!buf)
+        {
+            return NULL;
+        }
+
+        SDL_TLSSet(tls, buf, ReleaseBuffer);
+    }
+
+    return buf;
+}
+
+void M_TraceBegin(const char *name)
+{
+    tracebuf_t *buf = GetBuffer();
+
+    if (buf && buf->depth++ < MAXDEPTH)
+    {
+        buf->stack[buf->depth - 1].name = name;
+        buf->stack[buf->depth - 1].start = SDL_GetPerformanceCounter();
+    }
+}
+
+void M_TraceEnd(void)
+{
+    tracebuf_t *buf = GetBuffer();
+    event_t *event;
+
+    if (!buf || buf->depth <= 0 || buf->depth-- > MAXDEPTH)
+    {
+        return;
+    }
+
+    event = &buf->events[buf->count++ % NUMEVENTS];
+    event->name = buf->stack[buf->depth].name;
+    event->start = buf->stack[buf->depth].start;
+    event->end = SDL_GetPerformanceCounter();
+}
+
+static double Microseconds(uint64_t time)
+{
+    return (double)(time - basetime) * 1000000.0 / frequency;
+}
+
+// Events are written as complete ("X") events, one array per thread.
+// Viewers sort them by timestamp, so the ring buffer order is fine.
+
+static void WriteTrace(void)
+{
+    FILE *file;
+    tracebuf_t *buf;
+    boolean first = true;
+
+    trace_enabled = false;
+
+    if (!(file = M_fopen(tracefile, "w")))
+    {
+        I_Printf(VB_WARNING, "M_WriteTrace: Failed to open %s", tracefile);
+        return;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    SDL_LockMutex(mutex);
+
+    for (buf = buffers; buf; buf = buf->next)
+    {
+        unsigned int i = 0;
+
+        fprintf(file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", buf->id, buf->id == 1 ? "main" : "worker");
+        first = false;
+
+        if (buf->count > NUMEVENTS)
+        {
+            i = buf->count - NUMEVENTS;
+        }
+
+        for (; i < buf->count; ++i)
+        {
+            const event_t *event = &buf->events[i % NUMEVENTS];
+
+            fprintf(file,
+                    ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    event->name, buf->id, Microseconds(event->start),
+                    Microseconds(event->end) - Microseconds(event->start));
+        }
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file))
+    {
+        I_Printf(VB_WARNING, "M_WriteTrace: Failed to write %s", tracefile);
+    }
+    else
+    {
+        I_Printf(VB_INFO, "M_WriteTrace: Trace written to %s", tracefile);
+    }
+}
+
+void M_InitTrace(void)
+{
+    int p;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // Record a timeline of the main loop, game simulation, renderer,
+    // status bar, HUD and sound updates. The most recent few minutes are
+    // written to the given file on exit, in Chrome trace format, which
+    // can be viewed in Perfetto or chrome://tracing.
+    //
+
+    p = M_CheckParmWithArgs("-trace", 1);
+
+    if (!p)
+    {
+        return;
+    }
+
+    tls = SDL_TLSCreate();
+    mutex = SDL_CreateMutex();
+
+    if (!tls || !mutex)
+    {
+        I_Printf(VB_WARNING, "M_InitTrace: %s", SDL_GetError());
+        return;
+    }
+
+    tracefile = M_StringDuplicate(myargv[p + 1]);
+    frequency = SDL_GetPerformanceFrequency();
+    basetime = SDL_GetPerformanceCounter();
+
+    // Register this thread first, so that it is listed as the main one.
+    if (GetBuffer())
+    {
+        trace_enabled = true;
+        I_AtExit(WriteTrace, true);
+    }
+}
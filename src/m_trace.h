@@ -0,0 +1,51 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Frame timeline trace (-trace), written as Chrome trace JSON.
+//
+
+#ifndef __M_TRACE__
+#define __M_TRACE__
+
+#include "doomtype.h"
+
+extern boolean trace_enabled;
+
+void M_InitTrace(void);
+
+// Zones nest and must be closed on the thread that opened them. The
+// name must be a string literal, only the pointer is stored.
+
+void M_TraceBegin(const char *name);
+void M_TraceEnd(void);
+
+#define TRACE_BEGIN(name)         \
+    do                            \
+    {                             \
+        if (trace_enabled)        \
+        {                         \
+            M_TraceBegin(name);   \
+        }                         \
+    } while (0)
+
+#define TRACE_END()               \
+    do                            \
+    {                             \
+        if (trace_enabled)        \
+        {                         \
+            M_TraceEnd();         \
+        }                         \
+    } while (0)
+
+#endif
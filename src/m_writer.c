@@ -0,0 +1,219 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Buffered file writer with a background thread.
+//
+//      Data is copied into one of two fixed-size blocks. A full block is
+//      handed to the thread, which writes it out while the caller fills
+//      the other one, so neither buffer growth nor disk latency ends up
+//      on the caller's thread.
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "m_writer.h"
+
+#include "i_system.h"
+#include "m_io.h"
+#include "m_misc2.h"
+#include "m_trace.h"
+
+#define BLOCKSIZE (256 * 1024)
+#define NUMBLOCKS 2
+
+typedef struct
+{
+    byte *data;
+    size_t size;
+} block_t;
+
+struct writer_s
+{
+    char *filename;
+    FILE *file;
+    SDL_Thread *thread;
+    SDL_sem *full;  // blocks waiting to be written
+    SDL_sem *free;  // blocks the caller can fill, apart from the current one
+    block_t blocks[NUMBLOCKS];
+    int current;    // block being filled by the caller
+    int next;       // block the thread writes next
+    int error;      // errno of the first failed write, set by the thread
+};
+
+static void WriteBlock(writer_t *writer, block_t *block)
+{
+    TRACE_BEGIN("M_WriteBlock");
+
+    errno = 0;
+
+    if (!writer->error
+        && fwrite(block->data, 1, block->size, writer->file) != block->size)
+    {
+        writer->error = errno ? errno : EIO;
+    }
+
+    block->size = 0;
+
+    TRACE_END();
+}
+
+// An empty block tells the thread to stop.
+
+static int WriterThread(void *data)
+{
+    writer_t *writer = data;
+
+    while (true)
+    {
+        block_t *block = &writer->blocks[writer->next];
+
+        SDL_SemWait(writer->full);
+
+        if (!block->size)
+        {
+            break;
+        }
+
+        WriteBlock(writer, block);
+
+        writer->next = (writer->next + 1) % NUMBLOCKS;
+        SDL_SemPost(writer->free);
+    }
+
+    return 0;
+}
+
+// Hand the current block to the thread and wait for a free one. Without
+// a thread, blocks are written out right away.
+
+static void SubmitBlock(writer_t *writer)
+{
+    if (!writer->thread)
+    {
+        WriteBlock(writer, &writer->blocks[writer->current]);
+        return;
+    }
+
+    SDL_SemPost(writer->full);
+    writer->current = (writer->current + 1) % NUMBLOCKS;
+    SDL_SemWait(writer->free);
+}
+
+writer_t *M_OpenWriter(const char *filename)
+{
+    writer_t *writer;
+    FILE *file;
+    int i;
+
+    errno = 0;
+
+    if (!(file = M_fopen(filename, "wb")))
+    {
+        return NULL;
+    }
+
+    writer = calloc(1, sizeof(*writer));
+    writer->filename = M_StringDuplicate(filename);
+    writer->file = file;
+
+    for (i = 0; i < NUMBLOCKS; ++i)
+    {
+        writer->blocks[i].data = I_Realloc(NULL, BLOCKSIZE);
+    }
+
+    writer->full = SDL_CreateSemaphore(0);
+    writer->free = SDL_CreateSemaphore(NUMBLOCKS - 1);
+
+    if (writer->full && writer->free)
+    {
+        writer->thread = SDL_CreateThread(WriterThread, "writer", writer);
+    }
+
+    return writer;
+}
+
+void M_WriteBuffered(writer_t *writer, const void *data, size_t size)
+{
+    const byte *p = data;
+
+    while (size)
+    {
+        block_t *block = &writer->blocks[writer->current];
+        const size_t count = MIN(size, BLOCKSIZE - block->size);
+
+        memcpy(block->data + block->size, p, count);
+        block->size += count;
+        p += count;
+        size -= count;
+
+        if (block->size == BLOCKSIZE)
+        {
+            SubmitBlock(writer);
+        }
+    }
+}
+
+boolean M_CloseWriter(writer_t *writer)
+{
+    boolean result;
+    int i;
+
+    if (writer->blocks[writer->current].size)
+    {
+        SubmitBlock(writer);
+    }
+
+    if (writer->thread)
+    {
+        SDL_SemPost(writer->full);
+        SDL_WaitThread(writer->thread, NULL);
+    }
+
+    if (writer->full)
+    {
+        SDL_DestroySemaphore(writer->full);
+    }
+    if (writer->free)
+    {
+        SDL_DestroySemaphore(writer->free);
+    }
+
+    if (fclose(writer->file) && !writer->error)
+    {
+        writer->error = errno ? errno : EIO;
+    }
+
+    result = !writer->error;
+
+    if (!result)
+    {
+        M_remove(writer->filename);
+    }
+
+    for (i = 0; i < NUMBLOCKS; ++i)
+    {
+        free(writer->blocks[i].data);
+    }
+
+    free(writer->filename);
+    errno = writer->error;
+    free(writer);
+
+    return result;
+}
@@ -0,0 +1,38 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Buffered file writer with a background thread.
+//
+
+#ifndef __M_WRITER__
+#define __M_WRITER__
+
+#include "doomtype.h"
+
+typedef struct writer_s writer_t;
+
+// Create a file that is written from a background thread. Returns NULL
+// if the file can't be created.
+writer_t *M_OpenWriter(const char *filename);
+
+// Append data to the file. The data is copied, so the caller can reuse
+// its buffer right away. Only waits if the thread is still writing the
+// previous block when the current one fills up.
+void M_WriteBuffered(writer_t *writer, const void *data, size_t size);
+
+// Write out everything that is still buffered and close the file.
+// Returns false and removes the file if any write failed.
+boolean M_CloseWriter(writer_t *writer);
+
+#endif
@@ -83,9 +83,13 @@ struct midi_file_s
     midi_track_t *tracks;
     unsigned int num_tracks;
 
-    // Data buffer used to store data read for SysEx or meta events:
+    // Events of all tracks, merged and sorted by time:
+    midi_timed_event_t *events;
+    unsigned int num_events;
+
+    // Copy of the file data, which SysEx and meta events point into:
     byte *buffer;
-    unsigned int buffer_size;
+    size_t buffer_size;
 };
 
 // Check the header of a chunk:
@@ -165,38 +169,26 @@ static boolean ReadVariableLength(unsigned int *result, MEMFILE *stream)
     return false;
 }
 
-// Read a byte sequence into the data buffer.
+// Read a byte sequence. The stream is opened on the file's data buffer,
+// so rather than allocating a copy we return a pointer into it.
 
 static void *ReadByteSequence(unsigned int num_bytes, MEMFILE *stream)
 {
-    unsigned int i;
-    byte *result;
-
-    // Allocate a buffer. Allocate one extra byte, as malloc(0) is
-    // non-portable.
+    void *buf;
+    size_t buflen;
+    long position;
 
-    result = malloc(num_bytes + 1);
+    mem_get_buf(stream, &buf, &buflen);
+    position = mem_ftell(stream);
 
-    if (result == NULL)
+    if (num_bytes > buflen - position
+     || mem_fseek(stream, num_bytes, MEM_SEEK_CUR) < 0)
     {
-        I_Printf(VB_ERROR, "ReadByteSequence: Failed to allocate buffer");
+        I_Printf(VB_ERROR, "ReadByteSequence: Unexpected end of file");
         return NULL;
     }
 
-    // Read the data:
-
-    for (i=0; i<num_bytes; ++i)
-    {
-        if (!ReadByte(&result[i], stream))
-        {
-            I_Printf(VB_ERROR, "ReadByteSequence: Error while reading byte %u",
-                               i);
-            free(result);
-            return NULL;
-        }
-    }
-
-    return result;
+    return (byte *) buf + position;
 }
 
 // Read a MIDI channel event.
@@ -388,30 +380,6 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     return false;
 }
 
-// Free an event:
-
-static void FreeEvent(midi_event_t *event)
-{
-    // Some event types have dynamically allocated buffers assigned
-    // to them that must be freed.
-
-    switch (event->event_type)
-    {
-        case MIDI_EVENT_SYSEX:
-        case MIDI_EVENT_SYSEX_SPLIT:
-            free(event->data.sysex.data);
-            break;
-
-        case MIDI_EVENT_META:
-            free(event->data.meta.data);
-            break;
-
-        default:
-            // Nothing to do.
-            break;
-    }
-}
-
 // Read and check the track chunk header
 
 static boolean ReadTrackHeader(midi_track_t *track, MEMFILE *stream)
@@ -464,11 +432,20 @@ static boolean ReadTrack(midi_track_t *track, MEMFILE *stream)
         //                      sizeof(midi_event_t) * (track->num_events + 1));
 
         // Depending on the state of the heap and the malloc implementation,
-        // realloc() one more event at a time can be VERY slow.
+        // realloc() one more event at a time can be VERY slow. Events take
+        // at least two bytes, so start from an estimate based on the track
+        // length and double from there.
 
         if (track->num_events == track->num_events_mem)
         {
-            track->num_events_mem += 100;
+            if (track->num_events_mem == 0)
+            {
+                track->num_events_mem = track->data_len / 4 + 1;
+            }
+            else
+            {
+                track->num_events_mem *= 2;
+            }
             new_events = realloc(track->events,
                                  sizeof (midi_event_t) * track->num_events_mem);
         }
@@ -506,13 +483,6 @@ static boolean ReadTrack(midi_track_t *track, MEMFILE *stream)
 
 static void FreeTrack(midi_track_t *track)
 {
-    unsigned int i;
-
-    for (i=0; i<track->num_events; ++i)
-    {
-        FreeEvent(&track->events[i]);
-    }
-
     free(track->events);
 }
 
@@ -544,6 +514,113 @@ static boolean ReadAllTracks(midi_file_t *file, MEMFILE *stream)
     return true;
 }
 
+// Merge the events of all tracks into a single array sorted by time, with
+// the absolute time of each event precomputed. Players can then walk one
+// contiguous array instead of keeping an iterator for every track.
+
+static boolean MergeTracks(midi_file_t *file)
+{
+    unsigned int *positions;
+    unsigned int *track_ticks;
+    unsigned int num_events = 0;
+    unsigned int division;
+    boolean smpte;
+    unsigned int tempo = 500 * 1000; // Default is 120 bpm.
+    unsigned int tempo_ticks = 0;
+    uint64_t tempo_us = 0;
+    unsigned int i, n;
+
+    for (i = 0; i < file->num_tracks; ++i)
+    {
+        num_events += file->tracks[i].num_events;
+    }
+
+    file->events = malloc(sizeof(midi_timed_event_t) * num_events);
+    positions = calloc(file->num_tracks, sizeof(*positions));
+    track_ticks = calloc(file->num_tracks, sizeof(*track_ticks));
+
+    if (file->events == NULL || positions == NULL || track_ticks == NULL)
+    {
+        free(positions);
+        free(track_ticks);
+        return false;
+    }
+
+    // Negative time division indicates SMPTE time, in which case ticks
+    // have a fixed length and tempo changes are ignored.
+
+    smpte = (short) SDL_SwapBE16(file->header.time_division) < 0;
+    division = MAX(MIDI_GetFileTimeDivision(file), 1);
+
+    for (n = 0; n < num_events; ++n)
+    {
+        midi_timed_event_t *timed = &file->events[n];
+        midi_event_t *event;
+        unsigned int next = file->num_tracks;
+        unsigned int next_ticks = 0;
+
+        // Take the earliest pending event. On ties the lower track number
+        // goes first, so events keep their order within each track.
+
+        for (i = 0; i < file->num_tracks; ++i)
+        {
+            midi_track_t *track = &file->tracks[i];
+            unsigned int ticks;
+
+            if (positions[i] >= track->num_events)
+            {
+                continue;
+            }
+
+            ticks = track_ticks[i] + track->events[positions[i]].delta_time;
+
+            if (next == file->num_tracks || ticks < next_ticks)
+            {
+                next = i;
+                next_ticks = ticks;
+            }
+        }
+
+        event = &file->tracks[next].events[positions[next]];
+        ++positions[next];
+        track_ticks[next] = next_ticks;
+
+        timed->event = *event;
+        timed->track = next;
+        timed->ticks = next_ticks;
+
+        if (smpte)
+        {
+            timed->us = (uint64_t) next_ticks * 1000 * 1000 / division;
+        }
+        else
+        {
+            timed->us = tempo_us + (uint64_t) (next_ticks - tempo_ticks)
+                                   * tempo / division;
+        }
+
+        // Tempo changes apply to all tracks from this point onwards.
+
+        if (event->event_type == MIDI_EVENT_META
+         && event->data.meta.type == MIDI_META_SET_TEMPO
+         && event->data.meta.length == 3)
+        {
+            byte *data = event->data.meta.data;
+
+            tempo = (data[0] << 16) | (data[1] << 8) | data[2];
+            tempo_ticks = next_ticks;
+            tempo_us = timed->us;
+        }
+    }
+
+    file->num_events = num_events;
+
+    free(positions);
+    free(track_ticks);
+
+    return true;
+}
+
 // Read and check the header chunk.
 
 static boolean ReadFileHeader(midi_file_t *file, MEMFILE *stream)
@@ -595,6 +672,8 @@ void MIDI_FreeFile(midi_file_t *file)
         free(file->tracks);
     }
 
+    free(file->events);
+    free(file->buffer);
     free(file);
 }
 
@@ -612,12 +691,26 @@ midi_file_t *MIDI_LoadFile(void *buf, size_t buflen)
 
     file->tracks = NULL;
     file->num_tracks = 0;
-    file->buffer = NULL;
-    file->buffer_size = 0;
+    file->events = NULL;
+    file->num_events = 0;
+
+    // Keep a copy of the file data, which SysEx and meta events point
+    // into.
+
+    file->buffer = malloc(buflen);
+    file->buffer_size = buflen;
+
+    if (file->buffer == NULL)
+    {
+        MIDI_FreeFile(file);
+        return NULL;
+    }
+
+    memcpy(file->buffer, buf, buflen);
 
     // Open file
 
-    stream = mem_fopen_read(buf, buflen);
+    stream = mem_fopen_read(file->buffer, file->buffer_size);
 
     if (stream == NULL)
     {
@@ -646,6 +739,14 @@ midi_file_t *MIDI_LoadFile(void *buf, size_t buflen)
 
     mem_fclose(stream);
 
+    // Merge them into a single timeline:
+
+    if (!MergeTracks(file))
+    {
+        MIDI_FreeFile(file);
+        return NULL;
+    }
+
     return file;
 }
 
@@ -656,6 +757,15 @@ unsigned int MIDI_NumTracks(midi_file_t *file)
     return file->num_tracks;
 }
 
+// Get the events of all tracks merged into a single array.
+
+midi_timed_event_t *MIDI_GetMergedEvents(midi_file_t *file,
+                                         unsigned int *num_events)
+{
+    *num_events = file->num_events;
+    return file->events;
+}
+
 // Start iterating over the events in a track.
 
 midi_track_iter_t *MIDI_IterateTrack(midi_file_t *file, unsigned int track)
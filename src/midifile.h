@@ -184,6 +184,21 @@ typedef struct
     } data;
 } midi_event_t;
 
+// An event from the merged event list of a file.
+
+typedef struct
+{
+    // Time since the start of the song, in ticks and in microseconds
+    // (with tempo changes applied):
+    unsigned int ticks;
+    uint64_t us;
+
+    // Track the event was read from:
+    unsigned int track;
+
+    midi_event_t event;
+} midi_timed_event_t;
+
 // Load a MIDI file.
 
 midi_file_t *MIDI_LoadFile(void *buf, size_t buflen);
@@ -200,6 +215,12 @@ unsigned int MIDI_GetFileTimeDivision(midi_file_t *file);
 
 unsigned int MIDI_NumTracks(midi_file_t *file);
 
+// Get the events of all tracks merged into a single array, sorted by time.
+// The array is owned by the file.
+
+midi_timed_event_t *MIDI_GetMergedEvents(midi_file_t *file,
+                                         unsigned int *num_events);
+
 // Start iterating over the events in a track.
 
 midi_track_iter_t *MIDI_IterateTrack(midi_file_t *file, unsigned int track_num);
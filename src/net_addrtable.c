@@ -0,0 +1,162 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Hash table of entries keyed by network address.
+//
+//      Used by the network modules to map addresses to their net_addr_t
+//      and by the server to map addresses to clients, so that finding
+//      the sender of a packet takes constant time however many
+//      addresses have been seen. Collisions are resolved by linear
+//      probing, and the table is kept at most half full so that probe
+//      sequences stay short.
+//
+
+#include <string.h>
+
+#include "net_addrtable.h"
+
+#include "z_zone.h"
+
+#define INITIAL_SIZE 16
+
+uint32_t NET_AddrTableHash(uint32_t value)
+{
+    value *= 0x9e3779b1;
+    value ^= value >> 16;
+
+    return value;
+}
+
+static int HomeSlot(net_addrtable_t *table, const void *key)
+{
+    return table->hash(key) & (table->size - 1);
+}
+
+// Returns the slot holding the key, or the empty slot where it should be
+// inserted.
+
+static int FindSlot(net_addrtable_t *table, const void *key)
+{
+    int i;
+
+    for (i = HomeSlot(table, key); table->entries[i] != NULL;
+         i = (i + 1) & (table->size - 1))
+    {
+        if (table->equal(key, table->key(table->entries[i])))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+// Sets the size of the table and reinserts all entries.
+
+static void Resize(net_addrtable_t *table, int size)
+{
+    void **old_entries = table->entries;
+    int old_size = table->size;
+    int i;
+
+    table->size = size;
+    table->entries = Z_Malloc(sizeof(*table->entries) * size, PU_STATIC, 0);
+    memset(table->entries, 0, sizeof(*table->entries) * size);
+
+    for (i = 0; i < old_size; ++i)
+    {
+        if (old_entries[i] != NULL)
+        {
+            const void *key = table->key(old_entries[i]);
+
+            table->entries[FindSlot(table, key)] = old_entries[i];
+        }
+    }
+
+    if (old_entries)
+    {
+        Z_Free(old_entries);
+    }
+}
+
+void *NET_AddrTableFind(net_addrtable_t *table, const void *key)
+{
+    if (!table->count)
+    {
+        return NULL;
+    }
+
+    return table->entries[FindSlot(table, key)];
+}
+
+void NET_AddrTableAdd(net_addrtable_t *table, void *entry)
+{
+    if ((table->count + 1) * 2 > table->size)
+    {
+        Resize(table, table->size ? table->size * 2 : INITIAL_SIZE);
+    }
+
+    table->entries[FindSlot(table, table->key(entry))] = entry;
+    ++table->count;
+}
+
+void NET_AddrTableRemove(net_addrtable_t *table, void *entry)
+{
+    int i, j, k;
+
+    if (!table->count)
+    {
+        return;
+    }
+
+    for (i = HomeSlot(table, table->key(entry)); table->entries[i] != entry;
+         i = (i + 1) & (table->size - 1))
+    {
+        if (table->entries[i] == NULL)
+        {
+            return;
+        }
+    }
+
+    table->entries[i] = NULL;
+    --table->count;
+
+    // Shift back any following entries that can no longer be reached from
+    // their preferred slot now that there is a gap in the probe sequence.
+
+    for (j = (i + 1) & (table->size - 1); table->entries[j] != NULL;
+         j = (j + 1) & (table->size - 1))
+    {
+        k = HomeSlot(table, table->key(table->entries[j]));
+
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+        {
+            continue;
+        }
+
+        table->entries[i] = table->entries[j];
+        table->entries[j] = NULL;
+        i = j;
+    }
+}
+
+void NET_AddrTableClear(net_addrtable_t *table)
+{
+    if (table->entries)
+    {
+        memset(table->entries, 0, sizeof(*table->entries) * table->size);
+    }
+
+    table->count = 0;
+}
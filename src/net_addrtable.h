@@ -0,0 +1,59 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Hash table of entries keyed by network address.
+//
+
+#ifndef NET_ADDRTABLE_H
+#define NET_ADDRTABLE_H
+
+#include <stdint.h>
+
+#include "doomtype.h"
+
+// An open-addressing hash table of entries that each contain their own
+// key. Only the callbacks need to be set, e.g.
+//
+//   static net_addrtable_t table =
+//   {
+//       .hash = HashKey, .key = EntryKey, .equal = KeysEqual
+//   };
+
+typedef struct
+{
+    uint32_t (*hash)(const void *key);
+    const void *(*key)(const void *entry);
+    boolean (*equal)(const void *a, const void *b);
+
+    void **entries;
+    int size;       // always a power of two, 0 before first use
+    int count;
+} net_addrtable_t;
+
+// Mix the bits of a value into a hash for NET_AddrTable tables.
+uint32_t NET_AddrTableHash(uint32_t value);
+
+// Return the entry with the given key, or NULL.
+void *NET_AddrTableFind(net_addrtable_t *table, const void *key);
+
+// Add an entry. Its key must not be in the table yet.
+void NET_AddrTableAdd(net_addrtable_t *table, void *entry);
+
+// Remove an entry, if it is in the table. The entry itself isn't freed.
+void NET_AddrTableRemove(net_addrtable_t *table, void *entry);
+
+// Remove all entries.
+void NET_AddrTableClear(net_addrtable_t *table);
+
+#endif /* #ifndef NET_ADDRTABLE_H */
@@ -26,8 +26,8 @@
 #include "m_argv.h"
 
 #include "net_common.h"
-#include "net_sdl.h"
 #include "net_server.h"
+#include "net_udp.h"
 
 // 
 // People can become confused about how dedicated servers work.  Game
@@ -67,7 +67,7 @@ void NET_DedicatedServer(void)
 
     NET_OpenLog();
     NET_SV_Init();
-    NET_SV_AddModule(&net_sdl_module);
+    NET_SV_AddModule(NET_UDPModule());
     NET_SV_RegisterWithMaster();
 
     while (true)
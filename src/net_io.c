@@ -18,13 +18,19 @@
 
 #include <stdio.h>
 
+#include "i_printf.h"
 #include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "net_defs.h"
 #include "net_io.h"
 #include "z_zone.h"
 
 #define MAX_MODULES 16
 
+// Interval between packet statistics dumps, in milliseconds.
+#define STATS_PERIOD 5000
+
 struct _net_context_s
 {
     net_module_t *modules[MAX_MODULES];
@@ -33,10 +39,63 @@ struct _net_context_s
 
 net_addr_t net_broadcast_addr;
 
+// Packet counters, printed periodically with -netstats.
+
+typedef struct
+{
+    unsigned int packets;
+    unsigned int bytes;
+} net_counter_t;
+
+static net_counter_t sent_stats, recv_stats;
+static boolean print_stats = false;
+static int stats_start_time;
+
+static void CountPacket(net_counter_t *counter, net_packet_t *packet)
+{
+    ++counter->packets;
+    counter->bytes += packet->len;
+}
+
+static void PrintStats(void)
+{
+    int now = I_GetTimeMS();
+    int elapsed = now - stats_start_time;
+
+    if (elapsed < STATS_PERIOD)
+    {
+        return;
+    }
+
+    I_Printf(VB_INFO, "netstats: received %u packets/s (%u bytes/s), "
+             "sent %u packets/s (%u bytes/s)",
+             (unsigned int) (recv_stats.packets * 1000ull / elapsed),
+             (unsigned int) (recv_stats.bytes * 1000ull / elapsed),
+             (unsigned int) (sent_stats.packets * 1000ull / elapsed),
+             (unsigned int) (sent_stats.bytes * 1000ull / elapsed));
+
+    recv_stats.packets = recv_stats.bytes = 0;
+    sent_stats.packets = sent_stats.bytes = 0;
+    stats_start_time = now;
+}
+
 net_context_t *NET_NewContext(void)
 {
     net_context_t *context;
 
+    //!
+    // @category net
+    //
+    // Periodically print the number of packets and bytes sent and
+    // received per second.
+    //
+
+    if (!print_stats && M_CheckParm("-netstats"))
+    {
+        print_stats = true;
+        stats_start_time = I_GetTimeMS();
+    }
+
     context = Z_Malloc(sizeof(net_context_t), PU_STATIC, 0);
     context->num_modules = 0;
 
@@ -76,6 +135,7 @@ net_addr_t *NET_ResolveAddress(net_context_t *context, const char *addr)
 void NET_SendPacket(net_addr_t *addr, net_packet_t *packet)
 {
     addr->module->SendPacket(addr, packet);
+    CountPacket(&sent_stats, packet);
 }
 
 void NET_SendBroadcast(net_context_t *context, net_packet_t *packet)
@@ -85,6 +145,7 @@ void NET_SendBroadcast(net_context_t *context, net_packet_t *packet)
     for (i=0; i<context->num_modules; ++i)
     {
         context->modules[i]->SendPacket(&net_broadcast_addr, packet);
+        CountPacket(&sent_stats, packet);
     }
 }
 
@@ -101,10 +162,18 @@ boolean NET_RecvPacket(net_context_t *context,
         if (context->modules[i]->RecvPacket(addr, packet))
         {
             NET_ReferenceAddress(*addr);
+            CountPacket(&recv_stats, *packet);
             return true;
         }
     }
 
+    // No more packets waiting, a good time to report.
+
+    if (print_stats)
+    {
+        PrintStats();
+    }
+
     return false;
 }
 
@@ -23,14 +23,34 @@
 
 static int total_packet_memory = 0;
 
+// Freed packets of the standard size are kept and reused, so that the
+// steady stream of packets sent and received during a game does not go
+// through the zone allocator.
+
+#define MAX_POOLED_PACKETS 256
+
+static net_packet_t *packet_pool[MAX_POOLED_PACKETS];
+static int num_pooled_packets = 0;
+
 net_packet_t *NET_NewPacket(int initial_size)
 {
     net_packet_t *packet;
 
+    if (initial_size <= NET_PACKET_POOL_SIZE)
+    {
+        if (num_pooled_packets > 0)
+        {
+            packet = packet_pool[--num_pooled_packets];
+            packet->len = 0;
+            packet->pos = 0;
+
+            return packet;
+        }
+
+        initial_size = NET_PACKET_POOL_SIZE;
+    }
+
     packet = (net_packet_t *) Z_Malloc(sizeof(net_packet_t), PU_STATIC, 0);
-    
-    if (initial_size == 0)
-        initial_size = 256;
 
     packet->alloced = initial_size;
     packet->data = Z_Malloc(initial_size, PU_STATIC, 0);
@@ -61,6 +81,13 @@ net_packet_t *NET_PacketDup(net_packet_t *packet)
 void NET_FreePacket(net_packet_t *packet)
 {
     //printf("%p: destroyed\n", packet);
+
+    if (packet->alloced == NET_PACKET_POOL_SIZE
+     && num_pooled_packets < MAX_POOLED_PACKETS)
+    {
+        packet_pool[num_pooled_packets++] = packet;
+        return;
+    }
     
     total_packet_memory -= sizeof(net_packet_t) + packet->alloced;
     Z_Free(packet->data);
@@ -20,6 +20,10 @@
 
 #include "net_defs.h"
 
+// Packets up to this size, enough for any UDP datagram we send, are
+// allocated at this size and recycled when freed.
+#define NET_PACKET_POOL_SIZE 1500
+
 net_packet_t *NET_NewPacket(int initial_size);
 net_packet_t *NET_PacketDup(net_packet_t *packet);
 void NET_FreePacket(net_packet_t *packet);
@@ -31,7 +31,7 @@
 #include "net_packet.h"
 #include "net_query.h"
 #include "net_structrw.h"
-#include "net_sdl.h"
+#include "net_udp.h"
 
 // DNS address of the Internet master server.
 
@@ -586,8 +586,8 @@ void NET_Query_Init(void)
     if (query_context == NULL)
     {
         query_context = NET_NewContext();
-        NET_AddModule(query_context, &net_sdl_module);
-        net_sdl_module.InitClient();
+        NET_AddModule(query_context, NET_UDPModule());
+        NET_UDPModule()->InitClient();
     }
 
     free(targets);
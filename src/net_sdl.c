@@ -23,6 +23,7 @@
 #include "i_system.h"
 #include "m_argv.h"
 #include "m_misc2.h"
+#include "net_addrtable.h"
 #include "net_defs.h"
 #include "net_io.h"
 #include "net_packet.h"
@@ -48,82 +49,52 @@ typedef struct
     IPaddress sdl_addr;
 } addrpair_t;
 
-static addrpair_t **addr_table;
-static int addr_table_size = -1;
+// Addresses are kept in a hash table keyed by host and port, so that
+// looking up the sender of a packet takes constant time however many
+// addresses the server has seen.
 
-// Initializes the address table
-
-static void NET_SDL_InitAddrTable(void)
+static uint32_t HashAddress(const void *key)
 {
-    addr_table_size = 16;
+    const IPaddress *addr = key;
+
+    return NET_AddrTableHash(addr->host
+                             ^ ((uint32_t) addr->port << 16) ^ addr->port);
+}
 
-    addr_table = Z_Malloc(sizeof(addrpair_t *) * addr_table_size,
-                          PU_STATIC, 0);
-    memset(addr_table, 0, sizeof(addrpair_t *) * addr_table_size);
+static const void *AddressKey(const void *entry)
+{
+    return &((const addrpair_t *) entry)->sdl_addr;
 }
 
-static boolean AddressesEqual(IPaddress *a, IPaddress *b)
+static boolean AddressesEqual(const void *a, const void *b)
 {
-    return a->host == b->host
-        && a->port == b->port;
+    const IPaddress *addr_a = a, *addr_b = b;
+
+    return addr_a->host == addr_b->host
+        && addr_a->port == addr_b->port;
 }
 
+static net_addrtable_t addr_table =
+{
+    .hash = HashAddress, .key = AddressKey, .equal = AddressesEqual
+};
+
 // Finds an address by searching the table.  If the address is not found,
 // it is added to the table.
 
 static net_addr_t *NET_SDL_FindAddress(IPaddress *addr)
 {
     addrpair_t *new_entry;
-    int empty_entry = -1;
-    int i;
 
-    if (addr_table_size < 0)
-    {
-        NET_SDL_InitAddrTable();
-    }
+    new_entry = NET_AddrTableFind(&addr_table, addr);
 
-    for (i=0; i<addr_table_size; ++i)
+    if (new_entry != NULL)
     {
-        if (addr_table[i] != NULL
-         && AddressesEqual(addr, &addr_table[i]->sdl_addr))
-        {
-            return &addr_table[i]->net_addr;
-        }
-
-        if (empty_entry < 0 && addr_table[i] == NULL)
-            empty_entry = i;
+        return &new_entry->net_addr;
     }
 
     // Was not found in list.  We need to add it.
 
-    // Is there any space in the table? If not, increase the table size
-
-    if (empty_entry < 0)
-    {
-        addrpair_t **new_addr_table;
-        int new_addr_table_size;
-
-        // after reallocing, we will add this in as the first entry
-        // in the new block of memory
-
-        empty_entry = addr_table_size;
-        
-        // allocate a new array twice the size, init to 0 and copy 
-        // the existing table in.  replace the old table.
-
-        new_addr_table_size = addr_table_size * 2;
-        new_addr_table = Z_Malloc(sizeof(addrpair_t *) * new_addr_table_size,
-                                  PU_STATIC, 0);
-        memset(new_addr_table, 0, sizeof(addrpair_t *) * new_addr_table_size);
-        memcpy(new_addr_table, addr_table, 
-               sizeof(addrpair_t *) * addr_table_size);
-        Z_Free(addr_table);
-        addr_table = new_addr_table;
-        addr_table_size = new_addr_table_size;
-    }
-
-    // Add a new entry
-    
     new_entry = Z_Malloc(sizeof(addrpair_t), PU_STATIC, 0);
 
     new_entry->sdl_addr = *addr;
@@ -131,26 +102,22 @@ static net_addr_t *NET_SDL_FindAddress(IPaddress *addr)
     new_entry->net_addr.handle = &new_entry->sdl_addr;
     new_entry->net_addr.module = &net_sdl_module;
 
-    addr_table[empty_entry] = new_entry;
+    NET_AddrTableAdd(&addr_table, new_entry);
 
     return &new_entry->net_addr;
 }
 
 static void NET_SDL_FreeAddress(net_addr_t *addr)
 {
-    int i;
-    
-    for (i=0; i<addr_table_size; ++i)
+    addrpair_t *entry = NET_AddrTableFind(&addr_table, addr->handle);
+
+    if (entry == NULL || addr != &entry->net_addr)
     {
-        if (addr == &addr_table[i]->net_addr)
-        {
-            Z_Free(addr_table[i]);
-            addr_table[i] = NULL;
-            return;
-        }
+        I_Error("NET_SDL_FreeAddress: Attempted to remove an unused address!");
     }
 
-    I_Error("NET_SDL_FreeAddress: Attempted to remove an unused address!");
+    NET_AddrTableRemove(&addr_table, entry);
+    Z_Free(entry);
 }
 
 static boolean NET_SDL_InitClient(void)
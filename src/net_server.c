@@ -29,6 +29,7 @@
 #include "m_argv.h"
 #include "m_misc2.h"
 
+#include "net_addrtable.h"
 #include "net_client.h"
 #include "net_common.h"
 #include "net_defs.h"
@@ -523,23 +524,45 @@ static void NET_SV_AdvanceWindow(void)
     }
 }
 
-// Given an address, find the corresponding client
+// Active clients are indexed by address in a hash table, so that finding
+// the sender of a packet does not depend on the number of clients.
+// Addresses are unique per host and port, so the net_addr_t pointer itself
+// is the key.
 
-static net_client_t *NET_SV_FindClient(net_addr_t *addr)
+static uint32_t HashClientAddr(const void *key)
 {
-    int i;
+    return NET_AddrTableHash((uint32_t) ((uintptr_t) key >> 4));
+}
 
-    for (i=0; i<MAXNETNODES; ++i) 
-    {
-        if (clients[i].active && clients[i].addr == addr)
-        {
-            // found the client
+static const void *ClientAddr(const void *entry)
+{
+    return ((const net_client_t *) entry)->addr;
+}
 
-            return &clients[i];
-        }
+static boolean ClientAddrsEqual(const void *a, const void *b)
+{
+    return a == b;
+}
+
+static net_addrtable_t client_table =
+{
+    .hash = HashClientAddr, .key = ClientAddr, .equal = ClientAddrsEqual
+};
+
+static void NET_SV_DeactivateClient(net_client_t *client)
+{
+    if (client->active)
+    {
+        NET_AddrTableRemove(&client_table, client);
+        client->active = false;
     }
+}
 
-    return NULL;
+// Given an address, find the corresponding client
+
+static net_client_t *NET_SV_FindClient(net_addr_t *addr)
+{
+    return NET_AddrTableFind(&client_table, addr);
 }
 
 // send a rejection packet to a client
@@ -565,6 +588,7 @@ static void NET_SV_InitNewClient(net_client_t *client, net_addr_t *addr,
     NET_Conn_InitServer(&client->connection, addr, protocol);
     client->addr = addr;
     NET_ReferenceAddress(addr);
+    NET_AddrTableAdd(&client_table, client);
     client->last_send_time = -1;
 
     // init the ticcmd send queue
@@ -763,7 +787,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
 
         if (client->connection.state == NET_CONN_STATE_DISCONNECTED)
         {
-            client->active = false;
+            NET_SV_DeactivateClient(client);
         }
     }
 
@@ -1791,7 +1815,7 @@ static void NET_SV_RunClient(net_client_t *client)
 
     if (client->connection.state == NET_CONN_STATE_DISCONNECTED)
     {
-        client->active = false;
+        NET_SV_DeactivateClient(client);
 
         // If we were about to start a game, any player disconnecting
         // should cause an abort.
@@ -1872,6 +1896,8 @@ void NET_SV_Init(void)
         clients[i].active = false;
     }
 
+    NET_AddrTableClear(&client_table);
+
     NET_SV_AssignPlayers();
 
     server_state = SERVER_WAITING_LAUNCH;
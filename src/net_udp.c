@@ -0,0 +1,467 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Networking module which uses native sockets. Packets are received
+//      in batches with recvmmsg() directly into pooled packet buffers, so
+//      draining the socket every tic needs neither allocations nor copies.
+//
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#ifdef HAVE_RECVMMSG
+  #include <errno.h>
+  #include <netdb.h>
+  #include <unistd.h>
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+#endif
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc2.h"
+#include "net_addrtable.h"
+#include "net_defs.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_sdl.h"
+#include "net_udp.h"
+#include "z_zone.h"
+
+#ifdef HAVE_RECVMMSG
+
+#define DEFAULT_PORT 2342
+
+// Number of packets received with a single system call.
+#define RECV_BATCH 32
+
+static net_module_t net_udp_module;
+
+static boolean initted = false;
+static int port = DEFAULT_PORT;
+static int sockfd = -1;
+
+// Receive ring: each slot holds a packet from the packet pool, which
+// recvmmsg() fills in place. Slots are handed out in order and refilled
+// before the next batch is received.
+
+static net_packet_t *recv_packets[RECV_BATCH];
+static struct sockaddr_in recv_addrs[RECV_BATCH];
+static struct iovec recv_iovecs[RECV_BATCH];
+static struct mmsghdr recv_msgs[RECV_BATCH];
+static int recv_count = 0;
+static int recv_next = 0;
+
+typedef struct
+{
+    net_addr_t net_addr;
+    struct sockaddr_in sin_addr;
+} addrpair_t;
+
+// Addresses are kept in a hash table keyed by host and port, in the same
+// way as in the SDL_net module.
+
+static uint32_t HashAddress(const void *key)
+{
+    const struct sockaddr_in *addr = key;
+
+    return NET_AddrTableHash(addr->sin_addr.s_addr
+                             ^ ((uint32_t) addr->sin_port << 16)
+                             ^ addr->sin_port);
+}
+
+static const void *AddressKey(const void *entry)
+{
+    return &((const addrpair_t *) entry)->sin_addr;
+}
+
+static boolean AddressesEqual(const void *a, const void *b)
+{
+    const struct sockaddr_in *addr_a = a, *addr_b = b;
+
+    return addr_a->sin_addr.s_addr == addr_b->sin_addr.s_addr
+        && addr_a->sin_port == addr_b->sin_port;
+}
+
+static net_addrtable_t addr_table =
+{
+    .hash = HashAddress, .key = AddressKey, .equal = AddressesEqual
+};
+
+// Finds an address by searching the table.  If the address is not found,
+// it is added to the table.
+
+static net_addr_t *NET_UDP_FindAddress(struct sockaddr_in *addr)
+{
+    addrpair_t *new_entry;
+
+    new_entry = NET_AddrTableFind(&addr_table, addr);
+
+    if (new_entry != NULL)
+    {
+        return &new_entry->net_addr;
+    }
+
+    new_entry = Z_Malloc(sizeof(addrpair_t), PU_STATIC, 0);
+
+    memset(&new_entry->sin_addr, 0, sizeof(new_entry->sin_addr));
+    new_entry->sin_addr.sin_family = AF_INET;
+    new_entry->sin_addr.sin_addr = addr->sin_addr;
+    new_entry->sin_addr.sin_port = addr->sin_port;
+    new_entry->net_addr.refcount = 0;
+    new_entry->net_addr.handle = &new_entry->sin_addr;
+    new_entry->net_addr.module = &net_udp_module;
+
+    NET_AddrTableAdd(&addr_table, new_entry);
+
+    return &new_entry->net_addr;
+}
+
+static void NET_UDP_FreeAddress(net_addr_t *addr)
+{
+    addrpair_t *entry = NET_AddrTableFind(&addr_table, addr->handle);
+
+    if (entry == NULL || addr != &entry->net_addr)
+    {
+        I_Error("NET_UDP_FreeAddress: Attempted to remove an unused address!");
+    }
+
+    NET_AddrTableRemove(&addr_table, entry);
+    Z_Free(entry);
+}
+
+static boolean OpenSocket(int bind_port)
+{
+    struct sockaddr_in sin;
+    int broadcast = 1;
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (sockfd < 0)
+    {
+        return false;
+    }
+
+    setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST,
+               &broadcast, sizeof(broadcast));
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+    sin.sin_port = htons(bind_port);
+
+    if (bind(sockfd, (struct sockaddr *) &sin, sizeof(sin)) < 0)
+    {
+        close(sockfd);
+        sockfd = -1;
+        return false;
+    }
+
+    recv_count = recv_next = 0;
+
+    initted = true;
+
+    return true;
+}
+
+static boolean NET_UDP_InitClient(void)
+{
+    int p;
+
+    if (initted)
+        return true;
+
+    p = M_CheckParmWithArgs("-port", 1);
+    if (p > 0)
+        port = M_ParmArgToInt(p);
+
+    if (!OpenSocket(0))
+    {
+        I_Error("NET_UDP_InitClient: Unable to open a socket!");
+    }
+
+    return true;
+}
+
+static boolean NET_UDP_InitServer(void)
+{
+    int p;
+
+    if (initted)
+        return true;
+
+    p = M_CheckParmWithArgs("-port", 1);
+    if (p > 0)
+        port = M_ParmArgToInt(p);
+
+    if (!OpenSocket(port))
+    {
+        I_Error("NET_UDP_InitServer: Unable to bind to port %i", port);
+    }
+
+    return true;
+}
+
+static void NET_UDP_SendPacket(net_addr_t *addr, net_packet_t *packet)
+{
+    struct sockaddr_in sin;
+
+    if (addr == &net_broadcast_addr)
+    {
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+        sin.sin_port = htons(port);
+    }
+    else
+    {
+        sin = *((struct sockaddr_in *) addr->handle);
+    }
+
+    // Failures are not fatal: UDP delivery is unreliable anyway, and the
+    // protocol resends whatever is lost.
+
+    sendto(sockfd, packet->data, packet->len, 0,
+           (struct sockaddr *) &sin, sizeof(sin));
+}
+
+// Receive the next batch of packets into the ring. Returns the number of
+// packets received.
+
+static int ReceiveBatch(void)
+{
+    int i, result;
+
+    for (i = 0; i < RECV_BATCH; ++i)
+    {
+        if (recv_packets[i] == NULL)
+        {
+            recv_packets[i] = NET_NewPacket(NET_PACKET_POOL_SIZE);
+        }
+
+        recv_iovecs[i].iov_base = recv_packets[i]->data;
+        recv_iovecs[i].iov_len = recv_packets[i]->alloced;
+
+        memset(&recv_msgs[i], 0, sizeof(recv_msgs[i]));
+        recv_msgs[i].msg_hdr.msg_name = &recv_addrs[i];
+        recv_msgs[i].msg_hdr.msg_namelen = sizeof(recv_addrs[i]);
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iovecs[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    result = recvmmsg(sockfd, recv_msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+
+    if (result < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+         || errno == ECONNREFUSED)
+        {
+            return 0;
+        }
+
+        I_Error("NET_UDP_RecvPacket: Error receiving packet: %s",
+                strerror(errno));
+    }
+
+    return result;
+}
+
+static boolean NET_UDP_RecvPacket(net_addr_t **addr, net_packet_t **packet)
+{
+    int i;
+
+    for (;;)
+    {
+        if (recv_next >= recv_count)
+        {
+            recv_count = ReceiveBatch();
+            recv_next = 0;
+
+            // no packets received
+
+            if (recv_count == 0)
+            {
+                return false;
+            }
+        }
+
+        i = recv_next++;
+
+        // Drop truncated datagrams, as SDL_net would.
+
+        if ((recv_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) == 0)
+        {
+            break;
+        }
+    }
+
+    // Hand the packet over to the caller; its slot gets a new packet from
+    // the pool before the next batch.
+
+    *packet = recv_packets[i];
+    recv_packets[i] = NULL;
+    (*packet)->len = recv_msgs[i].msg_len;
+    (*packet)->pos = 0;
+
+    *addr = NET_UDP_FindAddress(&recv_addrs[i]);
+
+    return true;
+}
+
+static void NET_UDP_AddrToString(net_addr_t *addr, char *buffer,
+                                 int buffer_len)
+{
+    struct sockaddr_in *sin;
+    uint32_t host;
+    uint16_t addr_port;
+
+    sin = (struct sockaddr_in *) addr->handle;
+    host = ntohl(sin->sin_addr.s_addr);
+    addr_port = ntohs(sin->sin_port);
+
+    M_snprintf(buffer, buffer_len, "%i.%i.%i.%i",
+               (host >> 24) & 0xff, (host >> 16) & 0xff,
+               (host >> 8) & 0xff, host & 0xff);
+
+    // Only include the port if it is not the default one, see
+    // NET_SDL_AddrToString.
+    if (addr_port != DEFAULT_PORT)
+    {
+        char portbuf[10];
+        M_snprintf(portbuf, sizeof(portbuf), ":%i", addr_port);
+        M_StringConcat(buffer, portbuf, buffer_len);
+    }
+}
+
+static net_addr_t *NET_UDP_ResolveAddress(const char *address)
+{
+    struct addrinfo hints;
+    struct addrinfo *result;
+    struct sockaddr_in sin;
+    char *addr_hostname;
+    int addr_port;
+    char *colon;
+
+    colon = strchr(address, ':');
+
+    addr_hostname = M_StringDuplicate(address);
+    if (colon != NULL)
+    {
+        addr_hostname[colon - address] = '\0';
+        addr_port = atoi(colon + 1);
+    }
+    else
+    {
+        addr_port = port;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(addr_hostname, NULL, &hints, &result) != 0)
+    {
+        free(addr_hostname);
+
+        // unable to resolve
+
+        return NULL;
+    }
+
+    free(addr_hostname);
+
+    memcpy(&sin, result->ai_addr, sizeof(sin));
+    sin.sin_port = htons(addr_port);
+
+    freeaddrinfo(result);
+
+    return NET_UDP_FindAddress(&sin);
+}
+
+static void NET_UDP_Shutdown(void)
+{
+    int i;
+
+    if (!initted)
+        return;
+
+    close(sockfd);
+    sockfd = -1;
+
+    for (i = 0; i < RECV_BATCH; ++i)
+    {
+        if (recv_packets[i] != NULL)
+        {
+            NET_FreePacket(recv_packets[i]);
+            recv_packets[i] = NULL;
+        }
+    }
+
+    recv_count = recv_next = 0;
+
+    initted = false;
+}
+
+// Complete module
+
+static net_module_t net_udp_module =
+{
+    NET_UDP_InitClient,
+    NET_UDP_InitServer,
+    NET_UDP_SendPacket,
+    NET_UDP_RecvPacket,
+    NET_UDP_AddrToString,
+    NET_UDP_FreeAddress,
+    NET_UDP_ResolveAddress,
+    NET_UDP_Shutdown,
+};
+
+#endif // HAVE_RECVMMSG
+
+net_module_t *NET_UDPModule(void)
+{
+#ifdef HAVE_RECVMMSG
+    static net_module_t *module = NULL;
+
+    if (module == NULL)
+    {
+        //!
+        // @category net
+        // @platform Linux
+        //
+        // Use native sockets for networking instead of SDL_net. Packets
+        // are received in batches, with fewer system calls.
+        //
+
+        if (M_CheckParm("-udpnet"))
+        {
+            module = &net_udp_module;
+        }
+        else
+        {
+            module = &net_sdl_module;
+        }
+    }
+
+    return module;
+#else
+    return &net_sdl_module;
+#endif
+}
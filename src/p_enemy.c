@@ -33,6 +33,7 @@
 #include "g_game.h"
 #include "p_enemy.h"
 #include "p_tick.h"
+#include "m_array.h"
 #include "m_bbox.h"
 
 #include "p_action.h"
@@ -64,44 +65,67 @@ static void P_NewChaseDir(mobj_t *actor);
 
 //
 // Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
+// Traverse adjacent sectors,
 // sound blocking lines cut off traversal.
 //
 // killough 5/5/98: reformatted, cleaned up
+//
+// [Woof!] Uses an explicit stack instead of recursion, so that large maps
+// cannot overflow the C stack, and the sector adjacency lists built by
+// P_GroupLines(). A sector may be flooded again when it is reached with
+// fewer sound blocking lines in between, so the results do not depend on
+// the order in which sectors are visited.
+
+typedef struct
+{
+  sector_t *sec;
+  int soundblocks;
+} soundnode_t;
+
+static soundnode_t *soundstack;
 
 static void P_RecursiveSound(sector_t *sec, int soundblocks,
 			     mobj_t *soundtarget)
 {
-  int i;
+  array_clear(soundstack);
+  array_push(soundstack, ((soundnode_t){sec, soundblocks}));
 
-  // wake up all monsters in this sector
-  if (sec->validcount == validcount && sec->soundtraversed <= soundblocks+1)
-    return;             // already flooded
+  while (array_size(soundstack))
+    {
+      const soundnode_t node = soundstack[--array_ptr(soundstack)->size];
+      int i;
 
-  sec->validcount = validcount;
-  sec->soundtraversed = soundblocks+1;
-  P_SetTarget(&sec->soundtarget, soundtarget);     // killough 11/98
+      sec = node.sec;
+      soundblocks = node.soundblocks;
 
-  for (i=0; i<sec->linecount; i++)
-    {
-      sector_t *other;
-      line_t *check = sec->lines[i];
+      // wake up all monsters in this sector
+      if (!R_MarkSector(&validcount, sec) &&
+          sec->soundtraversed <= soundblocks+1)
+        continue;       // already flooded
 
-      if (!(check->flags & ML_TWOSIDED))
-        continue;
+      sec->soundtraversed = soundblocks+1;
+      P_SetTarget(&sec->soundtarget, soundtarget);     // killough 11/98
 
-      P_LineOpening(check);
+      // pushed in reverse, so that they are popped in line order
+      for (i = sec->soundlinkcount - 1; i >= 0; i--)
+        {
+          const line_t *check = sec->soundlinks[i].line;
+          sector_t *other = sec->soundlinks[i].other;
 
-      if (openrange <= 0)
-        continue;       // closed door
+          if (!(check->flags & ML_TWOSIDED))
+            continue;
 
-      other=sides[check->sidenum[sides[check->sidenum[0]].sector==sec]].sector;
+          // P_LineOpening(), without touching its globals
+          if (MIN(sec->ceilingheight, other->ceilingheight) -
+              MAX(sec->floorheight, other->floorheight) <= 0)
+            continue;       // closed door
 
-      if (!(check->flags & ML_SOUNDBLOCK))
-        P_RecursiveSound(other, soundblocks, soundtarget);
-      else
-        if (!soundblocks)
-          P_RecursiveSound(other, 1, soundtarget);
+          if (!(check->flags & ML_SOUNDBLOCK))
+            array_push(soundstack, ((soundnode_t){other, soundblocks}));
+          else
+            if (!soundblocks)
+              array_push(soundstack, ((soundnode_t){other, 1}));
+        }
     }
 }
 
@@ -117,7 +141,7 @@ void P_NoiseAlert(mobj_t *target, mobj_t *emitter)
   if (target && target->player && (target->player->cheats & CF_NOTARGET))
     return;
 
-  validcount++;
+  R_NewValidCount(&validcount);
   P_RecursiveSound(emitter->subsector->sector, 0, target);
 }
 
@@ -642,7 +666,7 @@ static fixed_t P_AvoidDropoff(mobj_t *actor)
 
   // check lines
 
-  validcount++;
+  R_NewValidCount(&validcount);
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
       P_BlockLinesIterator(bx, by, PIT_AvoidDropoff);  // all contacted lines
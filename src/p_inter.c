@@ -805,6 +805,10 @@ void P_DamageMobjBy(mobj_t *target,mobj_t *inflictor, mobj_t *source, int damage
   player_t *player;
   boolean justhit;          // killough 11/98
 
+  // [Woof!] wake the target up first, callers may push it around even
+  // if it takes no damage (A_VileAttack)
+  P_WakeThinker(&target->thinker);
+
   // killough 8/31/98: allow bouncers to take damage
   if (!(target->flags & (MF_SHOOTABLE | MF_BOUNCES)))
     return; // shouldn't happen...
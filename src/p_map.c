@@ -24,8 +24,10 @@
 #include "p_mobj.h"
 #include "p_maputl.h"
 #include "p_map.h"
+#include "p_prof.h"
 #include "p_setup.h"
 #include "p_spec.h"
+#include "p_tick.h"
 #include "s_sound.h"
 #include "sounds.h"
 #include "p_inter.h"
@@ -271,7 +273,7 @@ boolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, boolean boss)
   tmfloorz = tmdropoffz = newsubsec->sector->floorheight;
   tmceilingz = newsubsec->sector->ceilingheight;
 
-  validcount++;
+  R_NewValidCount(&validcount);
   numspechit = 0;
 
   // stomp on any things contacted
@@ -710,7 +712,7 @@ boolean Check_Sides(mobj_t *actor, int x, int y)
 
   // xl->xh, yl->yh determine the mapblock set to search
 
-  validcount++; // prevents checking same line twice
+  R_NewValidCount(&validcount); // prevents checking same line twice
   for (bx = xl ; bx <= xh ; bx++)
     for (by = yl ; by <= yh ; by++)
       if (!P_BlockLinesIterator(bx,by,PIT_CrossLine))
@@ -747,7 +749,7 @@ boolean Check_Sides(mobj_t *actor, int x, int y)
 //  numspeciallines
 //
 
-boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y) 
+static boolean CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 {
   int xl, xh, yl, yh, bx, by;
   subsector_t *newsubsec;
@@ -778,7 +780,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 
   tmfloorz = tmdropoffz = newsubsec->sector->floorheight;
   tmceilingz = newsubsec->sector->ceilingheight;
-  validcount++;
+  R_NewValidCount(&validcount);
   numspechit = 0;
 
   if (tmflags & MF_NOCLIP)
@@ -814,7 +816,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
   // the P_BlockLinesIterator.
   if (mbf21)
   {
-    validcount++;
+    R_NewValidCount(&validcount);
   }
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
@@ -824,6 +826,19 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
   return true;
 }
 
+boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
+{
+  if (tickprofile)
+  {
+    const uint64_t start = P_ProfileStart();
+    const boolean result = CheckPosition(thing, x, y);
+    P_ProfileQuery(prof_checkposition, start);
+    return result;
+  }
+
+  return CheckPosition(thing, x, y);
+}
+
 //
 // P_TryMove
 // Attempt to move to a new position,
@@ -831,7 +846,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 //
 // killough 3/15/98: allow dropoff as option
 
-boolean P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, boolean dropoff)
+static boolean TryMove(mobj_t *thing, fixed_t x, fixed_t y, boolean dropoff)
 {
   fixed_t oldx, oldy;
 
@@ -931,6 +946,19 @@ boolean P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, boolean dropoff)
   return true;
 }
 
+boolean P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, boolean dropoff)
+{
+  if (tickprofile)
+  {
+    const uint64_t start = P_ProfileStart();
+    const boolean result = TryMove(thing, x, y, dropoff);
+    P_ProfileQuery(prof_trymove, start);
+    return result;
+  }
+
+  return TryMove(thing, x, y, dropoff);
+}
+
 //
 // killough 9/12/98:
 //
@@ -1033,7 +1061,7 @@ void P_ApplyTorque(mobj_t *mo)
   int bx,by,flags = mo->intflags; //Remember the current state, for gear-change
 
   tmthing = mo;
-  validcount++; // prevents checking same line twice
+  R_NewValidCount(&validcount); // prevents checking same line twice
       
   for (bx = xl ; bx <= xh ; bx++)
     for (by = yl ; by <= yh ; by++)
@@ -1920,6 +1948,8 @@ boolean PIT_ChangeSector(mobj_t *thing)
 {
   mobj_t *mo;
 
+  P_WakeThinker(&thing->thinker);   // [Woof!] floor or ceiling moved
+
   if (P_ThingHeightClip(thing))
     return true; // keep checking
 
@@ -2264,7 +2294,7 @@ void P_CreateSecNodeList(mobj_t *thing,fixed_t x,fixed_t y)
   tmbbox[BOXRIGHT]  = x + tmthing->radius;
   tmbbox[BOXLEFT]   = x - tmthing->radius;
 
-  validcount++; // used to make sure we only process a line once
+  R_NewValidCount(&validcount); // used to make sure we only process a line once
 
   xl = (tmbbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
   xh = (tmbbox[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
@@ -22,6 +22,7 @@
 
 #include "r_defs.h"
 #include "d_player.h"
+#include "r_state.h"
 
 #define USERANGE        (64*FRACUNIT)
 #define MELEERANGE      (64*FRACUNIT)
@@ -44,6 +45,7 @@ boolean P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, boolean dropoff);
 boolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y,boolean boss);
 void    P_SlideMove(mobj_t *mo);
 boolean P_CheckSight(mobj_t *t1, mobj_t *t2);
+boolean P_CheckSightVC(mobj_t *t1, mobj_t *t2, validcount_t *vc);
 boolean P_CheckFov(mobj_t *t1, mobj_t *t2, angle_t fov);
 void    P_UseLines(player_t *player);
 
@@ -26,7 +26,9 @@
 #include "r_main.h"
 #include "p_maputl.h"
 #include "p_map.h"
+#include "p_prof.h"
 #include "p_setup.h"
+#include "p_tick.h"
 
 //
 // P_AproxDistance
@@ -264,6 +266,8 @@ void P_SetThingPosition(mobj_t *thing)
 {                                                      // link into subsector
   subsector_t *ss = thing->subsector = R_PointInSubsector(thing->x, thing->y);
 
+  P_WakeThinker(&thing->thinker);   // [Woof!] moved things are not dormant
+
   if (!(thing->flags & MF_NOSECTOR))
     {
       // invisible things don't go into the sector links
@@ -366,9 +370,9 @@ boolean ThingIsOnLine(mobj_t *t, line_t *l)
 
 //
 // P_BlockLinesIterator
-// The validcount flags are used to avoid checking lines
+// The validcount stamps are used to avoid checking lines
 // that are marked in multiple mapblocks,
-// so increment validcount before the first call
+// so call R_NewValidCount(&validcount) before the first call
 // to P_BlockLinesIterator, then make one or more calls
 // to it.
 //
@@ -397,9 +401,8 @@ boolean P_BlockLinesIterator(int x, int y, boolean func(line_t*))
   for ( ; *list != -1 ; list++)                                   // phares
     {
       line_t *ld = &lines[*list];
-      if (ld->validcount == validcount)
+      if (!R_MarkLine(&validcount, ld))
         continue;       // line has already been checked
-      ld->validcount = validcount;
       if (!func(ld))
         return false;
     }
@@ -830,8 +833,8 @@ static void InterceptsOverrun(int num_intercepts, intercept_t *intercept)
 //
 // killough 5/3/98: reformatted, cleaned up
 
-boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
-                       int flags, boolean trav(intercept_t *))
+static boolean PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                            int flags, boolean trav(intercept_t *))
 {
   fixed_t xt1, yt1;
   fixed_t xt2, yt2;
@@ -842,7 +845,7 @@ boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   int     mapxstep, mapystep;
   int     count;
 
-  validcount++;
+  R_NewValidCount(&validcount);
   intercept_p = intercepts;
 
   if (!((x1-bmaporgx)&(MAPBLOCKSIZE-1)))
@@ -947,6 +950,20 @@ boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   return P_TraverseIntercepts(trav, FRACUNIT);
 }
 
+boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                       int flags, boolean trav(intercept_t *))
+{
+  if (tickprofile)
+  {
+    const uint64_t start = P_ProfileStart();
+    const boolean result = PathTraverse(x1, y1, x2, y2, flags, trav);
+    P_ProfileQuery(prof_pathtraverse, start);
+    return result;
+  }
+
+  return PathTraverse(x1, y1, x2, y2, flags, trav);
+}
+
 //
 // mbf21: RoughBlockCheck
 // [XA] adapted from Hexen -- used by P_RoughTargetSearch
@@ -25,6 +25,7 @@
 #include "r_things.h"
 #include "p_maputl.h"
 #include "p_map.h"
+#include "p_prof.h"
 #include "p_tick.h"
 #include "p_spec.h"
 #include "sounds.h"
@@ -65,6 +66,8 @@ boolean P_SetMobjState(mobj_t* mobj,statenum_t state)
   boolean ret = true;                         // return value
   statenum_t* tempstate = NULL;               // for use with recursion
 
+  P_WakeThinker(&mobj->thinker);              // [Woof!] end dormancy
+
   if (recursion++)                            // if recursion detected,
     seenstate = tempstate = Z_Calloc(num_states, sizeof(statenum_t), PU_STATIC, 0); // allocate state table
 
@@ -88,7 +91,12 @@ boolean P_SetMobjState(mobj_t* mobj,statenum_t state)
       // Call action functions when the state is set
 
       if (st->action.p1)
-	st->action.p1(mobj);
+      {
+        if (tickprofile)
+          P_ProfileAction(mobj, st);
+        else
+          st->action.p1(mobj);
+      }
 
       seenstate[state] = 1 + st->nextstate;   // killough 4/9/98
 
@@ -696,6 +704,30 @@ static inline void MusInfoThinker (mobj_t *thing)
   }
 }
 
+//
+// P_MobjIsDormant
+//
+// [Woof!] True if P_MobjThinker() has nothing left to do for an object
+// until something else moves it, changes its state or moves its sector:
+// it rests on the floor in a state that never ends, with its interpolation
+// data up to date. Anything that could take damage, respawn or tip over
+// a ledge is left running, and so is everything in strict mode or with
+// vanilla compatibility.
+//
+
+static boolean P_MobjIsDormant(const mobj_t *mobj)
+{
+  return mobj->tics == -1 && !strictmode && !demo_compatibility &&
+    !(mobj->momx | mobj->momy | mobj->momz) &&
+    mobj->z == mobj->floorz &&
+    (mobj->z <= mobj->dropoffz || mobj->flags & MF_NOGRAVITY) &&
+    !(mobj->flags & (MF_SHOOTABLE | MF_BOUNCES | MF_SKULLFLY)) &&
+    !(mobj->flags & MF_COUNTKILL && respawnmonsters) &&
+    !mobj->player && mobj->interp == true &&
+    mobj->x == mobj->oldx && mobj->y == mobj->oldy &&
+    mobj->z == mobj->oldz && mobj->angle == mobj->oldangle;
+}
+
 //
 // P_MobjThinker
 //
@@ -797,21 +829,73 @@ void P_MobjThinker (mobj_t* mobj)
 	++mobj->movecount >= 12*35 && !(leveltime & 31) &&
 	P_Random (pr_respawn) <= 4)
       P_NightmareRespawn(mobj);          // check for nightmare respawn
+
+  if (P_MobjIsDormant(mobj))
+    P_SleepThinker(&mobj->thinker);
 }
 
 
+//
+// P_AllocMobj
+//
+// [Woof!] Mobjs are carved out of PU_LEVEL slabs in allocation order, so
+// that things spawned together are also close together in memory, and
+// removed ones are recycled through a free list linked by thinker.next.
+// The slabs go away with the rest of the level in P_SetupLevel().
+//
+
+#define MOBJSLABSIZE 256
+
+static mobj_t *mobjslab, *freemobjs;
+static int mobjslabused;
+
+void P_ClearMobjPool(void)
+{
+  mobjslab = freemobjs = NULL;
+  mobjslabused = 0;
+}
+
+mobj_t *P_AllocMobj(void)
+{
+  mobj_t *mobj;
+
+  if (freemobjs)
+  {
+    mobj = freemobjs;
+    freemobjs = (mobj_t *) mobj->thinker.next;
+  }
+  else
+  {
+    if (!mobjslab || mobjslabused == MOBJSLABSIZE)
+    {
+      mobjslab = Z_Malloc(MOBJSLABSIZE * sizeof *mobjslab, PU_LEVEL, NULL);
+      mobjslabused = 0;
+    }
+
+    mobj = &mobjslab[mobjslabused++];
+  }
+
+  memset(mobj, 0, sizeof *mobj);
+
+  return mobj;
+}
+
+void P_FreeMobj(mobj_t *mobj)
+{
+  mobj->thinker.next = (thinker_t *) freemobjs;
+  freemobjs = mobj;
+}
+
 //
 // P_SpawnMobj
 //
 
 mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 {
-  mobj_t *mobj = Z_Malloc(sizeof *mobj, PU_LEVEL, NULL);
+  mobj_t *mobj = P_AllocMobj();
   mobjinfo_t *info = &mobjinfo[type];
   state_t    *st;
 
-  memset(mobj, 0, sizeof *mobj);
-
   mobj->type = type;
   mobj->info = info;
   mobj->x = x;
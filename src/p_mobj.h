@@ -251,6 +251,12 @@ enum {
 
 // killough 9/8/98: changed some fields to shorts,
 // for better memory usage (if only for cache).
+//
+// [Woof!] Fields are grouped by how often they are touched: first what
+// P_MobjThinker() and the blockmap and sector iterators use every tic,
+// then what rendering and monster AI use, then what is only read on
+// spawn, respawn or for savegames. Mobjs themselves are allocated from
+// per-level slabs, see P_SpawnMobj().
 
 typedef struct mobj_s
 {
@@ -262,21 +268,20 @@ typedef struct mobj_s
     fixed_t             y;
     fixed_t             z;
 
-    // More list: links in sector (if needed)
-    struct mobj_s*      snext;
-    struct mobj_s**     sprev; // killough 8/10/98: change to ptr-to-ptr
+    // Momentums, used to update position.
+    fixed_t             momx;
+    fixed_t             momy;
+    fixed_t             momz;
 
-    //More drawing info: to determine current sprite.
-    angle_t             angle;  // orientation
-    spritenum_t         sprite; // used to find patch_t and flip value
-    int                 frame;  // might be ORed with FF_FULLBRIGHT
+    int                 flags;
+    int                 flags2; // mbf21
+    int                 intflags;  // killough 9/15/98: internal flags
 
-    // Interaction info, by BLOCKMAP.
-    // Links in blocks (if needed).
-    struct mobj_s*      bnext;
-    struct mobj_s**     bprev; // killough 8/11/98: change to ptr-to-ptr
-    
-    struct subsector_s* subsector;
+    int                 tics;   // state tic counter
+    state_t*            state;
+
+    mobjtype_t          type;
+    mobjinfo_t*         info;   // &mobjinfo[mobj->type]
 
     // The closest interval over all contacted Sectors.
     fixed_t             floorz;
@@ -289,33 +294,40 @@ typedef struct mobj_s
     fixed_t             radius;
     fixed_t             height; 
 
-    // Momentums, used to update position.
-    fixed_t             momx;
-    fixed_t             momy;
-    fixed_t             momz;
-
     // If == validcount, already checked.
     int                 validcount;
 
-    mobjtype_t          type;
-    mobjinfo_t*         info;   // &mobjinfo[mobj->type]
+    // Interaction info, by BLOCKMAP.
+    // Links in blocks (if needed).
+    struct mobj_s*      bnext;
+    struct mobj_s**     bprev; // killough 8/11/98: change to ptr-to-ptr
     
-    int                 tics;   // state tic counter
-    state_t*            state;
-    int                 flags;
-    int                 flags2; // mbf21
-    int                 intflags;  // killough 9/15/98: internal flags
+    struct subsector_s* subsector;
+
+    // More list: links in sector (if needed)
+    struct mobj_s*      snext;
+    struct mobj_s**     sprev; // killough 8/10/98: change to ptr-to-ptr
+
+    //More drawing info: to determine current sprite.
+    angle_t             angle;  // orientation
+    spritenum_t         sprite; // used to find patch_t and flip value
+    int                 frame;  // might be ORed with FF_FULLBRIGHT
+
     int                 health;
 
-    // Movement direction, movement generation (zig-zagging).
-    short               movedir;        // 0-7
-    short               movecount;      // when 0, select a new dir
-    short               strafecount;    // killough 9/8/98: monster strafing
+    // Additional info record for player avatars only.
+    // Only valid if type == MT_PLAYER
+    struct player_s*    player;
 
     // Thing being chased/attacked (or NULL),
     // also the originator for missiles.
     struct mobj_s*      target;
 
+    // Movement direction, movement generation (zig-zagging).
+    short               movedir;        // 0-7
+    short               movecount;      // when 0, select a new dir
+    short               strafecount;    // killough 9/8/98: monster strafing
+
     // Reaction time: if non 0, don't attack yet.
     // Used by player to freeze a bit after teleporting.
     short               reactiontime;   
@@ -329,15 +341,28 @@ typedef struct mobj_s
 
     short               gear; // killough 11/98: used in torque simulation
 
-    // Additional info record for player avatars only.
-    // Only valid if type == MT_PLAYER
-    struct player_s*    player;
-
     // Player number last looked for.
     short               lastlook;       
 
-    // For nightmare respawn.
-    mapthing_t          spawnpoint;     
+    // [AM] If true, ok to interpolate this tic.
+    int                 interp;
+
+    // [AM] Previous position of mobj before think.
+    //      Used to interpolate between positions.
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;
+
+    // killough 8/2/98: friction properties part of sectors,
+    // not objects -- removed friction properties from here
+    // Andrey Budko: restored friction properties here
+    // Friction values for the sector the object is in
+    int friction;                                           // phares 3/17/98
+    int movefactor;
+
+    // a linked list of sectors where this object appears
+    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*      tracer; 
@@ -356,27 +381,10 @@ typedef struct mobj_s
     struct mobj_s* below_thing;                                     //   |
                                                                     // phares
 
-    // killough 8/2/98: friction properties part of sectors,
-    // not objects -- removed friction properties from here
-    // Andrey Budko: restored friction properties here
-    // Friction values for the sector the object is in
-    int friction;                                           // phares 3/17/98
-    int movefactor;
-
-    // a linked list of sectors where this object appears
-    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
-
     // SEE WARNING ABOVE ABOUT POINTER FIELDS!!!
 
-    // [AM] If true, ok to interpolate this tic.
-    int                 interp;
-
-    // [AM] Previous position of mobj before think.
-    //      Used to interpolate between positions.
-    fixed_t		oldx;
-    fixed_t		oldy;
-    fixed_t		oldz;
-    angle_t		oldangle;
+    // For nightmare respawn.
+    mapthing_t          spawnpoint;     
 
     // [FG] colored blood and gibs
     int bloodcolor;
@@ -426,6 +434,9 @@ void P_UpdateDirectVerticalAiming(void);
 mobj_t *P_SubstNullMobj(mobj_t *mobj);
 void    P_RespawnSpecials(void);
 mobj_t  *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
+mobj_t  *P_AllocMobj(void);
+void    P_FreeMobj(mobj_t *mobj);
+void    P_ClearMobjPool(void);
 void    P_RemoveMobj(mobj_t *th);
 boolean P_SetMobjState(mobj_t *mobj, statenum_t state);
 void    P_MobjThinker(mobj_t *mobj);
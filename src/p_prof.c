@@ -0,0 +1,488 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Playsim profiler (-tickprofile).
+//
+//      Calls and time are counted per thinker function, per mobj type,
+//      per state (merged by action function in the output) and for a few
+//      map queries. Times are inclusive, e.g. the time of a mobj type
+//      includes its actions and the queries they make.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "p_prof.h"
+
+#include "d_deh.h"
+#include "doomdef.h"
+#include "i_printf.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc2.h"
+#include "p_spec.h"
+#include "p_tick.h"
+
+boolean tickprofile;
+
+profsample_t profile_total = {"playsim"};
+profsample_t profile_top[PROFILE_TOP];
+int profile_numtop;
+
+static const struct
+{
+    actionf_p1 function;
+    const char *name;
+} thinkers[] = {
+    {(actionf_p1)P_MobjThinker,          "P_MobjThinker"},
+    {(actionf_p1)P_RemoveThinkerDelayed, "P_RemoveThinkerDelayed"},
+    {(actionf_p1)T_MoveCeiling,          "T_MoveCeiling"},
+    {(actionf_p1)T_VerticalDoor,         "T_VerticalDoor"},
+    {(actionf_p1)T_MoveFloor,            "T_MoveFloor"},
+    {(actionf_p1)T_PlatRaise,            "T_PlatRaise"},
+    {(actionf_p1)T_MoveElevator,         "T_MoveElevator"},
+    {(actionf_p1)T_LightFlash,           "T_LightFlash"},
+    {(actionf_p1)T_StrobeFlash,          "T_StrobeFlash"},
+    {(actionf_p1)T_Glow,                 "T_Glow"},
+    {(actionf_p1)T_FireFlicker,          "T_FireFlicker"},
+    {(actionf_p1)T_Scroll,               "T_Scroll"},
+    {(actionf_p1)T_Friction,             "T_Friction"},
+    {(actionf_p1)T_Pusher,               "T_Pusher"},
+    {NULL,                               "other thinkers"},
+};
+
+#define NUMTHINKERS arrlen(thinkers)
+
+static const char *queries[NUMPROFQUERIES] = {
+    "P_CheckSight",
+    "P_CheckPosition",
+    "P_TryMove",
+    "P_PathTraverse",
+};
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t time;  // performance counter ticks
+} counter_t;
+
+// All counters live in one array, so that the HUD window can be taken
+// with a single copy.
+
+typedef enum
+{
+    group_thinker,
+    group_type,
+    group_action,
+    group_query,
+    NUMGROUPS
+} group_t;
+
+static const char *group_names[NUMGROUPS] = {
+    "thinkers", "mobj types", "actions", "queries"
+};
+
+static counter_t *counters, *window;
+static int numcounters;
+static int first[NUMGROUPS + 1];
+
+static counter_t ticker, window_ticker;
+static int numstates, numtypes;
+static int *state_order;  // states sorted by action, for merging
+static boolean ticking, reported;
+static uint64_t frequency;
+static char level[9];
+
+typedef struct
+{
+    group_t group;
+    int index;  // counter, or position in state_order for actions
+    uint64_t calls, time;
+} entry_t;
+
+static entry_t *entries;
+
+static int CompareStates(const void *a, const void *b)
+{
+    const uintptr_t x = (uintptr_t)states[*(const int *)a].action.v;
+    const uintptr_t y = (uintptr_t)states[*(const int *)b].action.v;
+
+    return x < y ? -1 : x > y ? 1 : *(const int *)a - *(const int *)b;
+}
+
+static int CompareEntries(const void *a, const void *b)
+{
+    const uint64_t x = ((const entry_t *)a)->time;
+    const uint64_t y = ((const entry_t *)b)->time;
+
+    return x > y ? -1 : x < y ? 1 : 0;
+}
+
+void P_InitProfile(void)
+{
+    //!
+    // @category demo
+    //
+    // Profile the game simulation. Shows the most expensive thinkers,
+    // mobj types, actions and map queries in a HUD widget and prints a
+    // report at the end of each level.
+    //
+
+    tickprofile = M_ParmExists("-tickprofile");
+
+    if (tickprofile)
+    {
+        frequency = SDL_GetPerformanceFrequency();
+        I_AtExit(P_ProfileReport, false);
+    }
+}
+
+// Counters are set up per level, DEHACKED may have added types and states.
+
+static void SetupCounters(void)
+{
+    int i;
+
+    numstates = num_states;
+    numtypes = num_mobj_types;
+
+    first[group_thinker] = 0;
+    first[group_type] = first[group_thinker] + NUMTHINKERS;
+    first[group_action] = first[group_type] + numtypes;
+    first[group_query] = first[group_action] + numstates;
+    first[NUMGROUPS] = first[group_query] + NUMPROFQUERIES;
+    numcounters = first[NUMGROUPS];
+
+    counters = I_Realloc(counters, numcounters * sizeof(*counters));
+    window = I_Realloc(window, numcounters * sizeof(*window));
+    entries = I_Realloc(entries, numcounters * sizeof(*entries));
+
+    state_order = I_Realloc(state_order, numstates * sizeof(*state_order));
+    for (i = 0; i < numstates; ++i)
+    {
+        state_order[i] = i;
+    }
+    qsort(state_order, numstates, sizeof(*state_order), CompareStates);
+}
+
+void P_ProfileStartLevel(const char *mapname)
+{
+    if (!tickprofile)
+    {
+        return;
+    }
+
+    P_ProfileReport();
+
+    if (numstates != num_states || numtypes != num_mobj_types)
+    {
+        SetupCounters();
+    }
+
+    memset(counters, 0, numcounters * sizeof(*counters));
+    memset(window, 0, numcounters * sizeof(*window));
+    memset(&ticker, 0, sizeof(ticker));
+    memset(&window_ticker, 0, sizeof(window_ticker));
+    reported = false;
+    M_StringCopy(level, mapname, sizeof(level));
+}
+
+//
+// Counting
+//
+
+uint64_t P_ProfileStart(void)
+{
+    return SDL_GetPerformanceCounter();
+}
+
+static inline void Count(counter_t *counter, uint64_t start)
+{
+    counter->calls++;
+    counter->time += SDL_GetPerformanceCounter() - start;
+}
+
+void P_ProfileThinker(thinker_t *thinker)
+{
+    const actionf_p1 function = thinker->function.p1;
+    int type = -1, i;
+    uint64_t start;
+
+    if (!ticking)
+    {
+        function(thinker);
+        return;
+    }
+
+    // The thinker may free itself, look at it first.
+
+    for (i = 0; i < NUMTHINKERS - 1; ++i)
+    {
+        if (thinkers[i].function == function)
+        {
+            break;
+        }
+    }
+
+    if (function == (actionf_p1)P_MobjThinker)
+    {
+        type = ((mobj_t *)thinker)->type;
+    }
+
+    start = P_ProfileStart();
+    function(thinker);
+
+    if (type >= 0 && type < numtypes)
+    {
+        Count(&counters[first[group_type] + type], start);
+    }
+    Count(&counters[first[group_thinker] + i], start);
+}
+
+void P_ProfileAction(mobj_t *mobj, state_t *state)
+{
+    const int index = state - states;
+    const uint64_t start = P_ProfileStart();
+
+    state->action.p1(mobj);
+
+    if (ticking && index < numstates)
+    {
+        Count(&counters[first[group_action] + index], start);
+    }
+}
+
+void P_ProfileQuery(profquery_t query, uint64_t start)
+{
+    if (ticking)
+    {
+        Count(&counters[first[group_query] + query], start);
+    }
+}
+
+//
+// Output
+//
+
+static void EntryName(const entry_t *entry, char *buf, size_t size)
+{
+    switch (entry->group)
+    {
+        case group_thinker:
+            M_StringCopy(buf, thinkers[entry->index - first[group_thinker]].name,
+                         size);
+            break;
+
+        case group_type:
+            {
+                const int type = entry->index - first[group_type];
+
+                M_snprintf(buf, size, "thing %d (%.4s)", type + 1,
+                           sprnames[states[mobjinfo[type].spawnstate].sprite]);
+            }
+            break;
+
+        case group_action:
+            {
+                const state_t *state = &states[state_order[entry->index]];
+                const char *name = deh_GetCodePointerName(state->action);
+
+                if (name)
+                {
+                    M_StringCopy(buf, name, size);
+                }
+                else
+                {
+                    M_snprintf(buf, size, "frame %d",
+                               state_order[entry->index]);
+                }
+            }
+            break;
+
+        default:
+            M_StringCopy(buf, queries[entry->index - first[group_query]],
+                         size);
+            break;
+    }
+}
+
+// Collect the counters that changed since base (or since the start of
+// the level) into entries, with the states of each action merged into
+// one entry, sorted by time.
+
+static int CollectEntries(const counter_t *base)
+{
+    static const counter_t zero;
+    int numentries = 0;
+    int group, i;
+
+    for (group = 0; group < NUMGROUPS; ++group)
+    {
+        for (i = first[group]; i < first[group + 1]; ++i)
+        {
+            const counter_t *from;
+            entry_t *entry;
+            int index = i;
+
+            if (group == group_action)
+            {
+                index = first[group] + state_order[i - first[group]];
+            }
+
+            from = base ? &base[index] : &zero;
+
+            if (counters[index].calls == from->calls)
+            {
+                continue;
+            }
+
+            entry = &entries[numentries];
+
+            if (group == group_action && numentries > 0
+                && entry[-1].group == group_action
+                && states[state_order[entry[-1].index]].action.v
+                   == states[state_order[i - first[group]]].action.v)
+            {
+                entry--;
+            }
+            else
+            {
+                entry->group = group;
+                entry->index = group == group_action ? i - first[group] : i;
+                entry->calls = entry->time = 0;
+                numentries++;
+            }
+
+            entry->calls += counters[index].calls - from->calls;
+            entry->time += counters[index].time - from->time;
+        }
+    }
+
+    qsort(entries, numentries, sizeof(*entries), CompareEntries);
+
+    return numentries;
+}
+
+static double Microseconds(uint64_t time)
+{
+    return time * 1000000.0 / frequency;
+}
+
+// Once a second, take the averages shown by the HUD widget. The entry of
+// P_MobjThinker is left out, the mobj types are a breakdown of it.
+
+#define WINDOW TICRATE
+
+static void UpdateWindow(void)
+{
+    const uint64_t tics = ticker.calls - window_ticker.calls;
+    int numentries, i;
+
+    numentries = CollectEntries(window);
+
+    profile_numtop = 0;
+
+    for (i = 0; i < numentries && profile_numtop < PROFILE_TOP; ++i)
+    {
+        profsample_t *sample = &profile_top[profile_numtop];
+
+        if (entries[i].group == group_thinker
+            && entries[i].index == first[group_thinker])
+        {
+            continue;
+        }
+
+        EntryName(&entries[i], sample->name, sizeof(sample->name));
+        sample->calls = entries[i].calls / tics;
+        sample->us = Microseconds(entries[i].time) / tics;
+        profile_numtop++;
+    }
+
+    profile_total.calls = 1;
+    profile_total.us = Microseconds(ticker.time - window_ticker.time) / tics;
+
+    memcpy(window, counters, numcounters * sizeof(*window));
+    window_ticker = ticker;
+}
+
+uint64_t P_ProfileBeginTic(void)
+{
+    ticking = numcounters > 0;
+
+    return P_ProfileStart();
+}
+
+void P_ProfileEndTic(uint64_t start)
+{
+    if (!ticking)
+    {
+        return;
+    }
+
+    ticking = false;
+    reported = false;
+    Count(&ticker, start);
+
+    if (ticker.calls - window_ticker.calls >= WINDOW)
+    {
+        UpdateWindow();
+    }
+}
+
+#define REPORT_LINES 12
+
+void P_ProfileReport(void)
+{
+    const double tics = ticker.calls;
+    const double total = Microseconds(ticker.time);
+    int numentries, group, i;
+
+    if (!tickprofile || !ticker.calls || reported)
+    {
+        return;
+    }
+
+    reported = true;
+    numentries = CollectEntries(NULL);
+
+    I_Printf(VB_INFO, "P_ProfileReport: %s, %d tics, %.3f ms per tic",
+             level, (int)ticker.calls, total / tics / 1000.0);
+
+    for (group = 0; group < NUMGROUPS; ++group)
+    {
+        int lines = 0;
+
+        I_Printf(VB_INFO, "  %-28s %10s %10s %7s", group_names[group],
+                 "calls/tic", "us/tic", "share");
+
+        for (i = 0; i < numentries && lines < REPORT_LINES; ++i)
+        {
+            const double time = Microseconds(entries[i].time);
+            char name[32];
+
+            if (entries[i].group != group)
+            {
+                continue;
+            }
+
+            EntryName(&entries[i], name, sizeof(name));
+            I_Printf(VB_INFO, "  %-28s %10.1f %10.1f %6.1f%%", name,
+                     entries[i].calls / tics, time / tics,
+                     100.0 * time / total);
+            lines++;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Playsim profiler (-tickprofile).
+//
+
+#ifndef __P_PROF__
+#define __P_PROF__
+
+#include "doomtype.h"
+#include "d_think.h"
+#include "info.h"
+#include "p_mobj.h"
+
+extern boolean tickprofile;
+
+typedef enum
+{
+    prof_checksight,
+    prof_checkposition,
+    prof_trymove,
+    prof_pathtraverse,
+    NUMPROFQUERIES
+} profquery_t;
+
+void P_InitProfile(void);
+
+// Report the level that is being left, if any, and start counting anew.
+void P_ProfileStartLevel(const char *mapname);
+void P_ProfileReport(void);
+
+// Everything below is only called if tickprofile is set. The profiler
+// only counts while P_Ticker() runs.
+
+uint64_t P_ProfileStart(void);
+uint64_t P_ProfileBeginTic(void);
+void P_ProfileEndTic(uint64_t start);
+void P_ProfileThinker(thinker_t *thinker);
+void P_ProfileAction(mobj_t *mobj, state_t *state);
+void P_ProfileQuery(profquery_t query, uint64_t start);
+
+// Averages over the last second, for the HUD widget.
+
+#define PROFILE_TOP 4
+
+typedef struct
+{
+    char name[24];
+    int calls;  // per tic
+    int us;     // microseconds per tic
+} profsample_t;
+
+extern profsample_t profile_total;
+extern profsample_t profile_top[PROFILE_TOP];
+extern int profile_numtop;
+
+#endif
@@ -2291,6 +2291,9 @@ void P_UnArchiveThinkers (void)
       thinker_t *next = th->next;
       if (th->function.p1 == (actionf_p1)P_MobjThinker)
         P_RemoveMobj ((mobj_t *) th);
+      else if (th->function.p1 == (actionf_p1)P_RemoveThinkerDelayed &&
+               th->pooled)
+        P_FreeMobj ((mobj_t *) th);
       else
         Z_Free (th);
       th = next;
@@ -2319,7 +2322,7 @@ void P_UnArchiveThinkers (void)
   // haleyjd 11/03/06: use idx to save "size" for rangechecking
   for (idx = 1; *save_p++ == tc_mobj; idx++)    // killough 2/14/98
     {
-      mobj_t *mobj = Z_Malloc(sizeof(mobj_t), PU_LEVEL, NULL);
+      mobj_t *mobj = P_AllocMobj();
 
       // killough 2/14/98 -- insert pointers to thinkers into table, in order:
       mobj_p[idx] = mobj;
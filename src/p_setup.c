@@ -28,6 +28,7 @@
 #include "r_things.h"
 #include "p_maputl.h"
 #include "p_map.h"
+#include "p_prof.h"
 #include "p_setup.h"
 #include "p_spec.h"
 #include "p_tick.h"
@@ -36,6 +37,7 @@
 #include "s_musinfo.h" // [crispy] S_ParseMusInfo()
 #include "m_misc2.h" // [FG] M_StringJoin()
 #include "m_swap.h"
+#include "m_trace.h"
 #include "nano_bsp.h"
 #include "st_stuff.h"
 
@@ -61,6 +63,8 @@ subsector_t *subsectors;
 
 int      numnodes;
 node_t   *nodes;
+bspnode_t *bspnodes;
+bspbbox_t *bspbboxes;
 
 int      numlines;
 line_t   *lines;
@@ -404,6 +408,84 @@ void P_LoadNodes (int lump)
   Z_Free (data);
 }
 
+//
+// P_LayoutNodes
+// Copies the nodes into bspnodes and bspbboxes, numbered depth-first from
+// the root downwards. The root stays at numnodes-1, the first child of a
+// node directly precedes it and the walk down a subtree stays within a
+// small part of the arrays.
+//
+
+static void P_LayoutNodes(void)
+{
+  int *remap, *stack;
+  int i, sp = 0, next = numnodes - 1;
+
+  bspnodes = Z_Malloc(numnodes * sizeof(*bspnodes), PU_LEVEL, 0);
+  bspbboxes = Z_Malloc(numnodes * sizeof(*bspbboxes), PU_LEVEL, 0);
+
+  if (numnodes <= 0)
+    return;
+
+  remap = Z_Malloc(2 * numnodes * sizeof(*remap), PU_STATIC, 0);
+  stack = remap + numnodes;
+
+  for (i = 0; i < numnodes; i++)
+    remap[i] = -1;
+
+  // Every node is pushed at most once, so the stack can't overflow even
+  // if the node data is broken.
+  remap[numnodes - 1] = numnodes - 1;
+  stack[sp++] = numnodes - 1;
+
+  while (sp)
+    {
+      const node_t *no = nodes + stack[--sp];
+      int j;
+
+      remap[no - nodes] = next--;
+
+      for (j = 1; j >= 0; j--)
+        {
+          const int child = no->children[j];
+
+          if (!(child & NF_SUBSECTOR) && child < numnodes && remap[child] < 0)
+            {
+              remap[child] = 0; // pushed
+              stack[sp++] = child;
+            }
+        }
+    }
+
+  // Nodes that can't be reached from the root go at the start.
+  for (i = 0; i < numnodes; i++)
+    if (remap[i] < 0)
+      remap[i] = next--;
+
+  for (i = 0; i < numnodes; i++)
+    {
+      const node_t *no = nodes + i;
+      bspnode_t *out = bspnodes + remap[i];
+      int j;
+
+      out->x = no->x;
+      out->y = no->y;
+      out->dx = no->dx;
+      out->dy = no->dy;
+
+      for (j = 0; j < 2; j++)
+        {
+          const int child = no->children[j];
+
+          out->children[j] = child & NF_SUBSECTOR || child >= numnodes ?
+                             child : remap[child];
+        }
+
+      memcpy(bspbboxes[remap[i]].bbox, no->bbox, sizeof(no->bbox));
+    }
+
+  Z_Free(remap);
+}
 
 //
 // P_LoadThings
@@ -1237,8 +1319,9 @@ void P_DegenMobjThinker(void *p)
 
 int P_GroupLines (void)
 {
-  int i, total;
+  int i, j, total, totallinks;
   line_t **linebuffer;
+  soundlink_t *linkbuffer;
 
   // look up sector number for each subsector
   for (i=0; i<numsubsectors; i++)
@@ -1308,6 +1391,39 @@ int P_GroupLines (void)
       block = block < 0 ? 0 : block;
       sector->blockbox[BOXLEFT]=block;
     }
+
+  // [Woof!] Sector adjacency for P_NoiseAlert(), so that the flood fill
+  // does not have to step over one-sided lines and look up sidedefs.
+  // The ML_TWOSIDED and ML_SOUNDBLOCK flags are still checked as it goes.
+
+  for (totallinks=0, i=0; i<numlines; i++)
+    if (lines[i].sidenum[1] != NO_INDEX)
+      totallinks += lines[i].backsector != lines[i].frontsector ? 2 : 1;
+
+  linkbuffer = Z_Malloc(totallinks * sizeof(*linkbuffer), PU_LEVEL, 0);
+
+  for (i=0; i<numsectors; i++)
+    {
+      sector_t *sector = sectors+i;
+
+      sector->soundlinks = linkbuffer;
+      sector->soundlinkcount = 0;
+
+      for (j=0; j<sector->linecount; j++)
+        {
+          line_t *line = sector->lines[j];
+
+          if (line->sidenum[1] == NO_INDEX)
+            continue;
+
+          linkbuffer->line = line;
+          linkbuffer->other = sides[line->sidenum[sides[line->sidenum[0]].sector
+                                                  == sector]].sector;
+          linkbuffer++;
+          sector->soundlinkcount++;
+        }
+    }
+
     return total;
 }
 
@@ -1557,6 +1673,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   mapformat_t mapformat;
   boolean gen_blockmap, pad_reject;
 
+  TRACE_BEGIN("P_SetupLevel");
+
   totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
   max_kill_requirement = 0;
   wminfo.partime = 180;
@@ -1585,6 +1703,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   Z_FreeTag(PU_LEVEL);
   Z_FreeTag(PU_CACHE);
 
+  P_ClearMobjPool();
   P_InitThinkers();
 
   // if working with a devlopment map, reload it
@@ -1593,6 +1712,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   // find map name
   strcpy(lumpname, MAPNAME(episode, map));
 
+  P_ProfileStartLevel(lumpname);
+
   lumpnum = W_GetNumForName(lumpname);
 
   leveltime = 0;
@@ -1604,6 +1725,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   // killough 4/4/98: split load of sidedefs into two parts,
   // to allow texture names to be used in special linedefs
 
+  TRACE_BEGIN("P_SetupLevel: geometry");
+
   // [FG] check nodes format
   mapformat = P_CheckMapFormat(lumpnum);
 
@@ -1641,6 +1764,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   P_LoadSegs      (lumpnum+ML_SEGS);
   }
 
+  P_LayoutNodes();
+
   // [FG] pad the REJECT table when the lump is too small
   pad_reject = P_LoadReject (lumpnum+ML_REJECT, P_GroupLines());
 
@@ -1649,6 +1774,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 
   // [crispy] fix long wall wobble
   P_SegLengths(false);
+
+  TRACE_END();
+
   // [crispy] blinking key or skull in the status bar
   memset(st_keyorskull, 0, sizeof(st_keyorskull));
 
@@ -1658,7 +1786,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   bodyqueslot = 0;
   deathmatch_p = deathmatchstarts;
   P_MapStart();
+  TRACE_BEGIN("P_LoadThings");
   P_LoadThings(lumpnum+ML_THINGS);
+  TRACE_END();
 
   // if deathmatch, randomly spawn the active players
   if (deathmatch)
@@ -1683,12 +1813,18 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   iquehead = iquetail = 0;
 
   // set up world state
+  TRACE_BEGIN("P_SpawnSpecials");
   P_SpawnSpecials();
+  TRACE_END();
   P_MapEnd();
 
   // preload graphics
   if (precache)
+  {
+    TRACE_BEGIN("R_PrecacheLevel");
     R_PrecacheLevel();
+    TRACE_END();
+  }
 
   // [FG] log level setup
   I_Printf(VB_INFO, "P_SetupLevel: %.8s (%s), Skill %d, %s%s%s, %s",
@@ -1704,6 +1840,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
     gen_blockmap ? "+Blockmap" : "",
     pad_reject ? "+Reject" : "",
     G_GetCurrentComplevelName());
+
+  TRACE_END();
 }
 
 //
@@ -20,6 +20,7 @@
 #include "doomstat.h"
 #include "r_main.h"
 #include "p_maputl.h"
+#include "p_prof.h"
 #include "p_setup.h"
 #include "m_bbox.h"
 
@@ -34,6 +35,7 @@ typedef struct {
   divline_t strace;                // from t1 to t2
   fixed_t topslope, bottomslope;   // slopes to top and bottom of target
   fixed_t bbox[4];
+  validcount_t *vc;                // lines crossed so far
 } los_t;
 
 //
@@ -99,11 +101,9 @@ static boolean P_CrossSubsector(int num, register los_t *los)
         continue;
 
       // allready checked other side?
-      if (line->validcount == validcount)
+      if (!R_MarkLine(los->vc, line))
         continue;
 
-      line->validcount = validcount;
-
       // OPTIMIZE: killough 4/20/98: Added quick bounding-box rejection test
 
       // [FG] Compatibility bug in P_CrossSubsector
@@ -199,7 +199,7 @@ static boolean P_CrossBSPNode(int bspnum, register los_t *los)
 {
   while (!(bspnum & NF_SUBSECTOR))
     {
-      register const node_t *bsp = nodes + bspnum;
+      register const bspnode_t *bsp = bspnodes + bspnum;
       int side = P_DivlineSide(los->strace.x,los->strace.y,(divline_t *)bsp)&1;
       if (side == P_DivlineSide(los->t2x, los->t2y, (divline_t *) bsp))
          bspnum = bsp->children[side]; // doesn't touch the other side
@@ -219,8 +219,11 @@ static boolean P_CrossBSPNode(int bspnum, register los_t *los)
 // Uses REJECT.
 //
 // killough 4/20/98: cleaned up, made to use new LOS struct
+//
+// Marks lines in vc, so checks given separate stamps can run at the same
+// time. Playsim code must pass &validcount to keep demos in sync.
 
-boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+boolean P_CheckSightVC(mobj_t *t1, mobj_t *t2, validcount_t *vc)
 {
   const sector_t *s1 = t1->subsector->sector;
   const sector_t *s2 = t2->subsector->sector;
@@ -258,7 +261,8 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
   // An unobstructed LOS is possible.
   // Now look from eyes of t1 to any part of t2.
 
-  validcount++;
+  R_NewValidCount(vc);
+  los.vc = vc;
 
   los.topslope = (los.bottomslope = t2->z - (los.sightzstart =
                                              t1->z + t1->height -
@@ -280,6 +284,19 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
   return P_CrossBSPNode(numnodes-1, &los);
 }
 
+boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+{
+  if (tickprofile)
+  {
+    const uint64_t start = P_ProfileStart();
+    const boolean result = P_CheckSightVC(t1, t2, &validcount);
+    P_ProfileQuery(prof_checksight, start);
+    return result;
+  }
+
+  return P_CheckSightVC(t1, t2, &validcount);
+}
+
 //
 // mbf21: P_CheckFov
 // Returns true if t2 is within t1's field of view.
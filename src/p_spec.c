@@ -2715,6 +2715,7 @@ void T_Scroll(scroll_t *s)
           {
 	  thing->momx += dx, thing->momy += dy;
 	  thing->intflags |= MIF_SCROLLING;
+	  P_WakeThinker(&thing->thinker);   // [Woof!] pushed things are not dormant
           }
       break;
 
@@ -3209,6 +3210,7 @@ boolean PIT_PushThing(mobj_t* thing)
           thing->momx += FixedMul(speed,finecosine[pushangle]);
           thing->momy += FixedMul(speed,finesine[pushangle]);
           thing->intflags |= MIF_SCROLLING;
+          P_WakeThinker(&thing->thinker);   // [Woof!] pushed things are not dormant
         }
     }
   return true;
@@ -3339,6 +3341,7 @@ void T_Pusher(pusher_t *p)
       thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
       thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
       thing->intflags |= MIF_SCROLLING;
+      P_WakeThinker(&thing->thinker);   // [Woof!] pushed things are not dormant
     }
 }
 
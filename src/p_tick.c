@@ -22,6 +22,8 @@
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_map.h"
+#include "p_prof.h"
+#include "m_trace.h"
 #include "s_musinfo.h" // [crispy] T_MAPMusic()
 
 int leveltime;
@@ -89,6 +91,15 @@ void P_UpdateThinker(thinker_t *thinker)
      ((mobj_t *) thinker)->flags & MF_FRIEND ?
      th_friends : th_enemies : th_misc;
 
+   // [Woof!] only thinkers no search looks for may go dormant
+   if (thinker->dormant)
+   {
+     if (tclass == th_misc)
+       tclass = th_dormant;
+     else
+       thinker->dormant = false;
+   }
+
    // Remove from current thread, if in one -- haleyjd: from PrBoom
    if((th = thinker->cnext) != NULL)
       (th->cprev = thinker->cprev)->cnext = th;
@@ -114,6 +125,7 @@ void P_AddThinker(thinker_t* thinker)
   thinkercap.prev = thinker;
 
   thinker->references = 0;    // killough 11/98: init reference counter to 0
+  thinker->dormant = false;
 
   // killough 8/29/98: set sentinel pointers, and then add to appropriate list
   thinker->cnext = thinker->cprev = thinker;
@@ -148,7 +160,10 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
       // haleyjd 6/17/08: remove from threaded list now
       (thinker->cnext->cprev = thinker->cprev)->cnext = thinker->cnext;
 
-      Z_Free(thinker);
+      if (thinker->pooled)
+        P_FreeMobj((mobj_t *) thinker);
+      else
+        Z_Free(thinker);
    }
 }
 
@@ -166,6 +181,11 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 //
 void P_RemoveThinker(thinker_t *thinker)
 {
+   // [Woof!] remember if this is a mobj, it goes back to the mobj pool
+   if (thinker->function.p1 != (actionf_p1)P_RemoveThinkerDelayed)
+     thinker->pooled = thinker->function.p1 == (actionf_p1)P_MobjThinker;
+
+   thinker->dormant = false;
    thinker->function.p1 = (actionf_p1)P_RemoveThinkerDelayed;
    
    // killough 8/29/98: remove immediately from threaded list
@@ -184,6 +204,42 @@ void P_RemoveThinker(thinker_t *thinker)
    P_UpdateThinker(thinker);
 }
 
+//
+// P_SleepThinker
+//
+// [Woof!] Mobjs which would not do anything in P_MobjThinker() until
+// something else touches them are moved onto the th_dormant thread and
+// skipped by P_RunThinkers(). They stay in the main thinker list, so that
+// a woken up thinker runs at the same point of the tic as it used to, and
+// everything that walks the main list still sees them.
+//
+
+void P_SleepThinker(thinker_t *thinker)
+{
+  if (!thinker->dormant)
+  {
+    thinker->dormant = true;
+    P_UpdateThinker(thinker);
+  }
+}
+
+void P_WakeThinker(thinker_t *thinker)
+{
+  if (thinker->dormant)
+  {
+    thinker->dormant = false;
+    P_UpdateThinker(thinker);
+  }
+}
+
+void P_WakeThinkers(void)
+{
+  thinker_t *cap = &thinkerclasscap[th_dormant];
+
+  while (cap->cnext != cap)
+    P_WakeThinker(cap->cnext);
+}
+
 //
 // P_SetTarget
 //
@@ -232,8 +288,13 @@ static void P_RunThinkers (void)
   for (currentthinker = thinkercap.next;
        currentthinker != &thinkercap;
        currentthinker = currentthinker->next)
-    if (currentthinker->function.p1)
-      currentthinker->function.p1(currentthinker);
+    if (!currentthinker->dormant && currentthinker->function.p1)
+    {
+      if (tickprofile)
+        P_ProfileThinker(currentthinker);
+      else
+        currentthinker->function.p1(currentthinker);
+    }
 
   // [crispy] support MUSINFO lump (dynamic music changing)
   T_MusInfo();
@@ -280,6 +341,7 @@ static void P_FrozenTicker (void)
 void P_Ticker (void)
 {
   int i;
+  uint64_t start = 0;
 
   // pause if in menu and at least one tic has been run
   //
@@ -293,12 +355,17 @@ void P_Ticker (void)
 		 players[consoleplayer].viewz != 1))
     return;
 
+  TRACE_BEGIN("P_Ticker");
+
   if (frozen_mode)
   {
     P_FrozenTicker();
   }
   else
   {
+  if (tickprofile)
+    start = P_ProfileBeginTic();
+
   P_MapStart();
   if (gamestate == GS_LEVEL)
   {
@@ -311,9 +378,14 @@ void P_Ticker (void)
   P_UpdateSpecials();
   P_RespawnSpecials();
   P_MapEnd();
+
+  if (tickprofile)
+    P_ProfileEndTic(start);
   }
 
   leveltime++;                       // for par times
+
+  TRACE_END();
 }
 
 //----------------------------------------------------------------------------
@@ -34,6 +34,11 @@ void P_RemoveThinkerDelayed(thinker_t *thinker);    // killough 4/25/98
 
 void P_UpdateThinker(thinker_t *thinker);   // killough 8/29/98
 
+// [Woof!] dormant mobjs are not run until woken up
+void P_SleepThinker(thinker_t *thinker);
+void P_WakeThinker(thinker_t *thinker);
+void P_WakeThinkers(void);
+
 void P_SetTarget(mobj_t **mo, mobj_t *target);   // killough 11/98
 
 // killough 8/29/98: threads of thinkers, for more efficient searches
@@ -42,6 +47,7 @@ typedef enum {
    th_misc,
    th_friends,
    th_enemies,
+   th_dormant, // [Woof!] mobjs skipped by P_RunThinkers()
    NUMTHCLASS
 } th_class;
 
@@ -32,11 +32,13 @@ static const char *params[] = {
 "-dedicated",
 "-dm3",
 "-left",
+"-netstats",
 "-oldsync",
 "-privateserver",
 "-right",
 "-server",
 "-solo-net",
+"-udpnet",
 "-blockmap",
 "-bsp",
 "-force_old_zdoom_nodes",
@@ -47,7 +49,10 @@ static const char *params[] = {
 "-nooptions",
 "-tranmap",
 "-levelstat",
+"-tickprofile",
+"-wadstats",
 "-longtics",
+"-packdemo",
 "-shorttics",
 "-strict",
 "-nogui",
@@ -93,6 +98,7 @@ static const char *params_with_args[] = {
 "-setmem",
 "-spechit",
 "-statdump",
+"-trace",
 };
 
 #define HELP_STRING "Usage: woof [options] \n\
@@ -658,7 +658,7 @@ void R_RenderBSPNode(int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))  // Found a subsector?
     {
-      node_t *bsp = &nodes[bspnum];
+      const bspnode_t *bsp = &bspnodes[bspnum];
 
       // Decide which side the view point is on.
       int side = R_PointOnSide(viewx, viewy, bsp);
@@ -668,7 +668,7 @@ void R_RenderBSPNode(int bspnum)
 
       // Possibly divide back space.
 
-      if (!R_CheckBBox(bsp->bbox[side^=1]))
+      if (!R_CheckBBox(bspbboxes[bspnum].bbox[side^=1]))
         return;
 
       bspnum = bsp->children[side];
@@ -26,6 +26,7 @@
 #include "r_sky.h"
 #include "m_io.h"
 #include "m_argv.h" // M_CheckParm()
+#include "m_cache.h"
 #include "m_misc2.h"
 #include "m_swap.h"
 #include "v_video.h" // cr_dark
@@ -471,6 +472,92 @@ static void R_GenerateLookup(int texnum, int *const errors)
   Z_Free(count);                    // killough 4/9/98
 }
 
+//
+// R_ReadLookupCache
+//
+// [Woof!] The column lookups only depend on the loaded lumps, so they are
+// kept in the startup cache, which also spares reading every patch. The
+// entry holds the composite sizes, then all column offsets, then all
+// column lumps, each texture's columns following the previous one's.
+//
+
+static size_t R_LookupCacheColumns(void)
+{
+  size_t i, columns = 0;
+
+  for (i = 0; i < numtextures; i++)
+    columns += textures[i]->width;
+
+  return columns;
+}
+
+#define LOOKUPCACHESIZE(columns) \
+  (numtextures * sizeof(int) + (columns) * (sizeof(unsigned) + sizeof(short)))
+
+static boolean R_ReadLookupCache(uint64_t key)
+{
+  size_t columns = R_LookupCacheColumns(), size = LOOKUPCACHESIZE(columns);
+  byte *cache = Z_Malloc(size, PU_STATIC, 0);
+  const unsigned *colofs;
+  const short *collump;
+  int i, x;
+
+  if (!M_ReadCache("texlookup", key, cache, size))
+    {
+      Z_Free(cache);
+      return false;
+    }
+
+  memcpy(texturecompositesize, cache, numtextures * sizeof(int));
+  colofs = (const unsigned *) (cache + numtextures * sizeof(int));
+  collump = (const short *) (colofs + columns);
+
+  for (i = 0; i < numtextures; i++)
+    {
+      const int width = textures[i]->width, height = textures[i]->height;
+
+      memcpy(texturecolumnofs[i], colofs, width * sizeof(*colofs));
+      memcpy(texturecolumnlump[i], collump, width * sizeof(*collump));
+      colofs += width;
+      collump += width;
+
+      for (x = 0; x < width; x++)
+        texturecolumnofs2[i][x] = x * height;
+
+      texturecomposite[i] = 0;
+      texturecomposite2[i] = 0;
+    }
+
+  Z_Free(cache);
+  return true;
+}
+
+static void R_WriteLookupCache(uint64_t key)
+{
+  size_t columns = R_LookupCacheColumns(), size = LOOKUPCACHESIZE(columns);
+  byte *cache = Z_Malloc(size, PU_STATIC, 0);
+  unsigned *colofs;
+  short *collump;
+  int i;
+
+  memcpy(cache, texturecompositesize, numtextures * sizeof(int));
+  colofs = (unsigned *) (cache + numtextures * sizeof(int));
+  collump = (short *) (colofs + columns);
+
+  for (i = 0; i < numtextures; i++)
+    {
+      const int width = textures[i]->width;
+
+      memcpy(colofs, texturecolumnofs[i], width * sizeof(*colofs));
+      memcpy(collump, texturecolumnlump[i], width * sizeof(*collump));
+      colofs += width;
+      collump += width;
+    }
+
+  M_WriteCache("texlookup", key, cache, size);
+  Z_Free(cache);
+}
+
 //
 // R_GetColumn
 //
@@ -734,11 +821,16 @@ void R_InitTextures (void)
     I_Error("\n\n%d errors.", errors);
     
   // Precalculate whatever possible.
-  for (i=0 ; i<numtextures ; i++)
-    R_GenerateLookup(i, &errors);
+  if (!R_ReadLookupCache(M_CacheWadKey()))
+    {
+      for (i=0 ; i<numtextures ; i++)
+        R_GenerateLookup(i, &errors);
 
-  if (errors)
-    I_Error("\n\n%d errors.", errors);
+      if (errors)
+        I_Error("\n\n%d errors.", errors);
+
+      R_WriteLookupCache(M_CacheWadKey());
+    }
 
   // Create translation table for global animation.
   // killough 4/9/98: make column offsets 32-bit;
@@ -799,6 +891,7 @@ void R_InitSpriteLumps(void)
 {
   int i;
   patch_t *patch;
+  fixed_t *cache;
 
   firstspritelump = W_GetNumForName("S_START") + 1;
   lastspritelump = W_GetNumForName("S_END") - 1;
@@ -812,6 +905,26 @@ void R_InitSpriteLumps(void)
   spritetopoffset =
     Z_Malloc(numspritelumps*sizeof*spritetopoffset, PU_STATIC, 0);
 
+  // [Woof!] the sprite metrics are kept in the startup cache, so that
+  // warm starts do not have to read every sprite lump
+  cache = Z_Malloc(3*numspritelumps*sizeof(*cache), PU_STATIC, 0);
+
+  if (M_ReadCache("spritelumps", M_CacheWadKey(), cache,
+                  3*numspritelumps*sizeof(*cache)))
+    {
+      memcpy(spritewidth, cache, numspritelumps*sizeof(*cache));
+      memcpy(spriteoffset, cache + numspritelumps,
+             numspritelumps*sizeof(*cache));
+      memcpy(spritetopoffset, cache + 2*numspritelumps,
+             numspritelumps*sizeof(*cache));
+
+      for (i=0 ; i< numspritelumps ; i+=128)
+        I_PutChar(VB_INFO, '.');
+
+      Z_Free(cache);
+      return;
+    }
+
   for (i=0 ; i< numspritelumps ; i++)
     {
       if (!(i&127))            // killough
@@ -822,6 +935,15 @@ void R_InitSpriteLumps(void)
       spriteoffset[i] = SHORT(patch->leftoffset)<<FRACBITS;
       spritetopoffset[i] = SHORT(patch->topoffset)<<FRACBITS;
     }
+
+  memcpy(cache, spritewidth, numspritelumps*sizeof(*cache));
+  memcpy(cache + numspritelumps, spriteoffset, numspritelumps*sizeof(*cache));
+  memcpy(cache + 2*numspritelumps, spritetopoffset,
+         numspritelumps*sizeof(*cache));
+
+  M_WriteCache("spritelumps", M_CacheWadKey(), cache,
+               3*numspritelumps*sizeof(*cache));
+  Z_Free(cache);
 }
 
 //
@@ -833,6 +955,28 @@ void R_InitSpriteLumps(void)
 // killough 4/4/98: Add support for C_START/C_END markers
 //
 
+#ifdef TRUECOLOR
+
+// [Woof!] The colormaps hold pixels, converted from the colormap lumps.
+// They have to be rebuilt whenever the gamma level changes.
+
+static byte **colormaplumps;
+static int *colormapsizes;
+
+void R_UpdateColormaps(void)
+{
+  int i, j;
+
+  if (!colormaps)
+    return;
+
+  for (i=0; i<numcolormaps; i++)
+    for (j=0; j<colormapsizes[i]; j++)
+      colormaps[i][j] = V_Pixel(colormaplumps[i][j]);
+}
+
+#endif
+
 void R_InitColormaps(void)
 {
   int i;
@@ -841,6 +985,26 @@ void R_InitColormaps(void)
   numcolormaps = lastcolormaplump - firstcolormaplump;
   colormaps = Z_Malloc(sizeof(*colormaps) * numcolormaps, PU_STATIC, 0);
 
+#ifdef TRUECOLOR
+  colormaplumps = Z_Malloc(sizeof(*colormaplumps) * numcolormaps, PU_STATIC, 0);
+  colormapsizes = Z_Malloc(sizeof(*colormapsizes) * numcolormaps, PU_STATIC, 0);
+
+  for (i=0; i<numcolormaps; i++)
+    {
+      const int lump = i ? i+firstcolormaplump : W_GetNumForName("COLORMAP");
+
+      colormaplumps[i] = W_CacheLumpNum(lump, PU_STATIC);
+      colormapsizes[i] = W_LumpLength(lump);
+      colormaps[i] = Z_Malloc(sizeof(**colormaps) * colormapsizes[i],
+                              PU_STATIC, 0);
+    }
+
+  R_UpdateColormaps();
+
+  // [FG] dark/shaded color translation table
+  cr_dark = &colormaplumps[0][256*15];
+  cr_shaded = &colormaplumps[0][256*6];
+#else
   colormaps[0] = W_CacheLumpNum(W_GetNumForName("COLORMAP"), PU_STATIC);
 
   for (i=1; i<numcolormaps; i++)
@@ -849,6 +1013,7 @@ void R_InitColormaps(void)
   // [FG] dark/shaded color translation table
   cr_dark = &colormaps[0][256*15];
   cr_shaded = &colormaps[0][256*6];
+#endif
 }
 
 // killough 4/4/98: get colormap number from name
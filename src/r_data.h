@@ -47,10 +47,14 @@ void R_InitTranMap(int);      // killough 3/6/98: translucency initialization
 int R_ColormapNumForName(const char *name);      // killough 4/4/98
 
 void R_InitColormaps(void);   // killough 8/9/98
+#ifdef TRUECOLOR
+void R_UpdateColormaps(void);
+#endif
 
 boolean R_IsPatchLump (const int lump);
 
 extern byte *main_tranmap, *tranmap;
+extern int tran_filter_pct;
 
 #endif
 
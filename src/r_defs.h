@@ -91,7 +91,6 @@ typedef struct
   mobj_t *soundtarget;   // thing that made a sound (or null)
   int blockbox[4];       // mapblock bounding box for height changes
   degenmobj_t soundorg;  // origin for any sounds played by the sector
-  int validcount;        // if == validcount, already checked
   mobj_t *thinglist;     // list of mobjs in sector
 
   // killough 8/28/98: friction is a sector property, not an mobj property.
@@ -137,6 +136,10 @@ typedef struct
   int linecount;
   struct line_s **lines;
 
+  // [Woof!] two-sided lines and the sectors behind them, for P_NoiseAlert()
+  int soundlinkcount;
+  struct soundlink_s *soundlinks;
+
   // WiggleFix: [kb] For R_FixWiggle()
   int cachedheight;
   int scaleindex;
@@ -171,6 +174,12 @@ typedef struct
   fixed_t old_ceiling_yoffs;
 } sector_t;
 
+typedef struct soundlink_s
+{
+  struct line_s *line;
+  sector_t *other;      // sector on the other side, may be the same one
+} soundlink_t;
+
 //
 // The SideDef.
 //
@@ -224,7 +233,6 @@ typedef struct line_s
   slopetype_t slopetype; // To aid move clipping.
   sector_t *frontsector; // Front and back sector.
   sector_t *backsector; 
-  int validcount;        // if == validcount, already checked
   void *specialdata;     // thinker_t for reversable actions
   int tranlump;          // killough 4/11/98: translucency filter, -1 == none
   int firsttag,nexttag;  // killough 4/17/98: improves searches for tags.
@@ -309,6 +317,22 @@ typedef struct
   int children[2];    // If NF_SUBSECTOR its a subsector.
 } node_t;
 
+//
+// BSP node as walked by point, sight and render traversals. Nodes are laid
+// out depth-first, and the bounding boxes are kept apart so that point
+// queries only touch partitions and children.
+//
+typedef struct
+{
+  fixed_t  x,  y, dx, dy;        // Partition line.
+  int children[2];               // If NF_SUBSECTOR its a subsector.
+} bspnode_t;
+
+typedef struct
+{
+  fixed_t bbox[2][4];            // Bounding box for each child.
+} bspbbox_t;
+
 // posts are runs of non masked source pixels
 typedef struct
 {
@@ -329,7 +353,7 @@ typedef post_t column_t;
 // from darkening PLAYPAL to all black.
 // Could use even more than 32 levels.
 
-typedef byte  lighttable_t; 
+typedef pixel_t lighttable_t;
 
 //
 // Masked 2s linedefs
@@ -452,6 +476,7 @@ typedef struct visplane
   int picnum, lightlevel, minx, maxx;
   fixed_t height;
   fixed_t xoffs, yoffs;         // killough 2/28/98: Support scrolling flats
+  int spans;                    // [Woof!] first of its spans, -1 if none
   unsigned short *bottom;
   unsigned short pad1;          // leave pads for [minx-1]/[maxx+1]
   unsigned short top[3];
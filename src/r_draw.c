@@ -45,7 +45,7 @@ int  scaledviewy;
 int  viewheight;
 int  viewwindowx;
 int  viewwindowy; 
-static byte **ylookup = NULL;
+static pixel_t **ylookup = NULL;
 static int  *columnofs = NULL;
 static int  linesize;  // killough 11/98
 
@@ -63,6 +63,7 @@ byte *main_tranmap;     // killough 4/11/98
 // background.
 
 static pixel_t *background_buffer = NULL;
+static boolean background_filled;
 
 //
 // R_DrawColumn
@@ -90,7 +91,7 @@ byte    dc_skycolor;
 void R_DrawColumn (void) 
 { 
   int              count; 
-  register byte    *dest;            // killough
+  register pixel_t *dest;            // killough
   register fixed_t frac;            // killough
   fixed_t          fracstep;     
 
@@ -192,7 +193,7 @@ void R_DrawColumn (void)
 void R_DrawTLColumn (void)                                           
 { 
   int              count; 
-  register byte    *dest;           // killough
+  register pixel_t *dest;           // killough
   register fixed_t frac;            // killough
   fixed_t          fracstep;
 
@@ -232,6 +233,14 @@ void R_DrawTLColumn (void)
     register lighttable_t *const *colormap = dc_colormap;
     register int heightmask = dc_texheight-1;
     register const byte *brightmap = dc_brightmap;
+#ifdef TRUECOLOR
+    // [Woof!] Blend by the translucency percentage instead of a filter
+    // map, which also stands in for custom TRANMAP lumps.
+    const unsigned int alpha = tran_filter_pct * 256 / 100;
+#define TLPIXEL(c) V_BlendPixels((c), *dest, alpha)
+#else
+#define TLPIXEL(c) tranmap[(*dest<<8)+(c)]
+#endif
     if (dc_texheight & heightmask)   // not a power of 2 -- killough
       {
         heightmask++;
@@ -252,7 +261,7 @@ void R_DrawTLColumn (void)
               
             // [crispy] brightmaps
             byte src = source[frac>>FRACBITS];
-            *dest = tranmap[(*dest<<8)+colormap[brightmap[src]][src]]; // phares
+            *dest = TLPIXEL(colormap[brightmap[src]][src]); // phares
             dest += linesize;          // killough 11/98
             if ((frac += fracstep) >= heightmask)
               frac -= heightmask;
@@ -264,19 +273,20 @@ void R_DrawTLColumn (void)
         while ((count-=2)>=0)   // texture height is a power of 2 -- killough
           {
             byte src = source[(frac>>FRACBITS) & heightmask];
-            *dest = tranmap[(*dest<<8)+colormap[brightmap[src]][src]]; // phares
+            *dest = TLPIXEL(colormap[brightmap[src]][src]); // phares
             dest += linesize;   // killough 11/98
             frac += fracstep;
-            *dest = tranmap[(*dest<<8)+colormap[brightmap[src]][src]]; // phares
+            *dest = TLPIXEL(colormap[brightmap[src]][src]); // phares
             dest += linesize;   // killough 11/98
             frac += fracstep;
           }
         if (count & 1)
         {
           byte src = source[(frac>>FRACBITS) & heightmask];
-          *dest = tranmap[(*dest<<8)+colormap[brightmap[src]][src]]; // phares
+          *dest = TLPIXEL(colormap[brightmap[src]][src]); // phares
         }
       }
+#undef TLPIXEL
   }
 } 
 
@@ -287,7 +297,7 @@ void R_DrawTLColumn (void)
 void R_DrawSkyColumn(void)
 {
   int count;
-  byte *dest;
+  pixel_t *dest;
   fixed_t frac;
   fixed_t fracstep;
 
@@ -313,6 +323,9 @@ void R_DrawSkyColumn(void)
     const lighttable_t *colormap = dc_colormap[0];
     const byte skycolor = dc_skycolor;
     int heightmask = dc_texheight - 1;
+#ifdef TRUECOLOR
+    const unsigned int alpha = tran_filter_pct * 256 / 100;
+#endif
 
     // Fill in the median color here
     // Have two intermediary fade lines, using the main_tranmap structure
@@ -343,11 +356,18 @@ void R_DrawSkyColumn(void)
 
         for (i = 0; i < n; ++i)
           {
+#ifdef TRUECOLOR
+            *dest = V_BlendPixels(colormap[skycolor],
+                                  V_BlendPixels(colormap[skycolor],
+                                                colormap[source[0]], alpha),
+                                  alpha);
+#else
             *dest = main_tranmap[(main_tranmap[(colormap[source[0]] << 8) +
                                                 colormap[skycolor]
                                               ] << 8
                                   ) + colormap[skycolor]
                                 ];
+#endif
             dest += linesize;
             frac += fracstep;
           }
@@ -365,7 +385,11 @@ void R_DrawSkyColumn(void)
 
         for (i = 0; i < n; ++i)
           {
+#ifdef TRUECOLOR
+            *dest = V_BlendPixels(colormap[skycolor], colormap[source[0]], alpha);
+#else
             *dest = main_tranmap[(colormap[source[0]] << 8) + colormap[skycolor]];
+#endif
             dest += linesize;
             frac += fracstep;
           }
@@ -427,6 +451,13 @@ static const int fuzzoffset[FUZZTABLE] = {
 
 static int fuzzpos = 0; 
 
+// [Woof!] The true-colour build darkens the pixel itself.
+#ifdef TRUECOLOR
+#define FUZZPIXEL(p) V_ShadePixel((p), 6)
+#else
+#define FUZZPIXEL(p) fullcolormap[6*256+(p)]
+#endif
+
 // [crispy] draw fuzz effect independent of rendering frame rate
 static int fuzzpos_tic;
 
@@ -457,7 +488,7 @@ void R_SetFuzzPosDraw(void)
 static void R_DrawFuzzColumn_orig(void)
 { 
   int      count; 
-  byte     *dest; 
+  pixel_t  *dest; 
   boolean  cutoff = false;
 
   // Adjust borders. Low... 
@@ -508,7 +539,7 @@ static void R_DrawFuzzColumn_orig(void)
       // fraggle 1/8/2000: fix with the bugfix from lees
       // why_i_left_doom.html
 
-      *dest = fullcolormap[6*256+dest[fuzzoffset[fuzzpos++] ? -linesize : linesize]];
+      *dest = FUZZPIXEL(dest[fuzzoffset[fuzzpos++] ? -linesize : linesize]);
       dest += linesize;             // killough 11/98
 
       // Clamp table lookup index.
@@ -520,16 +551,26 @@ static void R_DrawFuzzColumn_orig(void)
   // draw one extra line using only pixels of that line and the one above
   if (cutoff)
   {
-    *dest = fullcolormap[6*256+dest[linesize*fuzzoffset[fuzzpos]]];
+    *dest = FUZZPIXEL(dest[linesize*fuzzoffset[fuzzpos]]);
   }
 }
 
 // [FG] "blocky" spectre drawing for hires mode
 
+inline static void R_FillFuzz(pixel_t *dest, pixel_t fuzz, int nx)
+{
+#ifdef TRUECOLOR
+  while (nx--)
+    *dest++ = fuzz;
+#else
+  memset(dest, fuzz, nx);
+#endif
+}
+
 static void R_DrawFuzzColumn_block(void)
 {
   int count;
-  byte *dest;
+  pixel_t *dest;
   boolean cutoff = false;
   const int nx = video.xscale >> FRACBITS;
   const int ny = video.yscale >> FRACBITS;
@@ -572,12 +613,12 @@ static void R_DrawFuzzColumn_block(void)
       // [FG] draw only even pixels as (nx * ny) squares
       //      using the same fuzzoffset value
       const int offset = fuzzoffset[fuzzpos] ? -ny * linesize : ny * linesize;
-      const byte fuzz = fullcolormap[6 * 256 + dest[offset]];
+      const pixel_t fuzz = FUZZPIXEL(dest[offset]);
       int i;
 
       for (i = 0; i < ny && count - i > 0; i++)
       {
-        memset(dest, fuzz, nx);
+        R_FillFuzz(dest, fuzz, nx);
         dest += linesize;
       }
 
@@ -589,12 +630,12 @@ static void R_DrawFuzzColumn_block(void)
   if (cutoff)
     {
       const int offset = ny * linesize * fuzzoffset[fuzzpos];
-      const byte fuzz = fullcolormap[6 * 256 + dest[offset]];
+      const pixel_t fuzz = FUZZPIXEL(dest[offset]);
       int i;
 
       for (i = 0; i < ny; i++)
       {
-        memset(dest, fuzz, nx);
+        R_FillFuzz(dest, fuzz, nx);
         dest += linesize;
       }
     }
@@ -627,7 +668,7 @@ byte *dc_translation, *translationtables;
 void R_DrawTranslatedColumn (void) 
 { 
   int      count; 
-  byte     *dest; 
+  pixel_t  *dest; 
   fixed_t  frac;
   fixed_t  fracstep;     
  
@@ -731,8 +772,8 @@ byte *ds_source;
 void R_DrawSpan (void) 
 { 
   byte *source;
-  byte **colormap;
-  byte *dest;
+  lighttable_t **colormap;
+  pixel_t *dest;
   const byte *brightmap;
     
   unsigned count;
@@ -805,11 +846,18 @@ void R_InitBufferRes(void)
   if (solidcol) Z_Free(solidcol);
   if (columnofs) Z_Free(columnofs);
   if (ylookup) Z_Free(ylookup);
+  if (background_buffer) Z_Free(background_buffer);
 
   columnofs = Z_Malloc(video.width * sizeof(*columnofs), PU_STATIC, NULL);
   ylookup = Z_Malloc(video.height * sizeof(*ylookup), PU_STATIC, NULL);
 
   solidcol = Z_Calloc(1, video.width * sizeof(*solidcol), PU_STATIC, NULL);
+
+  // [Woof!] Dynamic resolution only lowers the height from here, so the
+  // background is allocated once and merely redrawn on view changes.
+  background_buffer = Z_Malloc(video.pitch * video.height * sizeof(*background_buffer),
+                               PU_STATIC, NULL);
+  background_filled = false;
 }
 
 //
@@ -842,11 +890,7 @@ void R_InitBuffer(void)
   for (i = viewheight; i--; )
     ylookup[i] = I_VideoBuffer + (i + viewwindowy) * linesize; // killough 11/98
 
-  if (background_buffer != NULL)
-  {
-    Z_Free(background_buffer);
-    background_buffer = NULL;
-  }
+  background_filled = false;
 }
 
 void R_DrawBorder (int x, int y, int w, int h)
@@ -893,13 +937,6 @@ void R_FillBackScreen (void)
   if (scaledviewwidth == video.unscaledw)
     return;
 
-  // Allocate the background buffer if necessary
-  if (background_buffer == NULL)
-  {
-    int size = video.pitch * video.height;
-    background_buffer = Z_Malloc(size * sizeof(*background_buffer), PU_STATIC, NULL);
-  }
-
   V_UseBuffer(background_buffer);
 
   V_DrawBackground(gamemode == commercial ? "GRNROCK" : "FLOOR7_2");
@@ -907,6 +944,8 @@ void R_FillBackScreen (void)
   R_DrawBorder(scaledviewx, scaledviewy, scaledviewwidth, scaledviewheight);
 
   V_RestoreBuffer();
+
+  background_filled = true;
 }
 
 //
@@ -915,7 +954,7 @@ void R_FillBackScreen (void)
 
 void R_VideoErase(int x, int y, int w, int h)
 {
-  if (background_buffer == NULL)
+  if (!background_filled)
     return;
 
   V_CopyRect(x, y, background_buffer, w, h, x, y);
@@ -935,7 +974,7 @@ void R_DrawViewBorder(void)
 {
   int side;
 
-  if (scaledviewwidth == video.unscaledw || background_buffer == NULL)
+  if (scaledviewwidth == video.unscaledw || !background_filled)
     return;
 
   // copy top
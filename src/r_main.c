@@ -30,7 +30,9 @@
 #include "r_draw.h"
 #include "r_sky.h"
 #include "r_voxel.h"
+#include "i_timer.h"
 #include "i_video.h"
+#include "m_trace.h"
 #include "v_video.h"
 #include "v_flextran.h"
 #include "st_stuff.h"
@@ -44,7 +46,8 @@
 // node, by d_net.c, to set up a L/M/R session.
 
 int viewangleoffset;
-int validcount = 1;         // increment every time a check is made
+validcount_t validcount;    // increment every time a check is made
+validcount_t rendervalidcount;
 lighttable_t *fixedcolormap;
 int      centerx, centery;
 fixed_t  centerxfrac, centeryfrac;
@@ -58,7 +61,7 @@ double deltatics;
 boolean raw_input;
 fixed_t  viewcos, viewsin;
 player_t *viewplayer;
-extern lighttable_t **walllights;
+extern const unsigned short *walllights;
 fixed_t  viewheightfrac; // [FG] sprite clipping optimizations
 
 //
@@ -96,11 +99,10 @@ int LIGHTZSHIFT;
 // killough 4/4/98: support dynamic number of them as well
 
 int numcolormaps;
-lighttable_t ***(*c_scalelight) = NULL;
-lighttable_t ***(*c_zlight) = NULL;
-lighttable_t **(*scalelight) = NULL;
-lighttable_t **scalelightfixed = NULL;
-lighttable_t **(*zlight) = NULL;
+static unsigned short *lighttables = NULL;
+unsigned short *scalelight = NULL;
+static unsigned short *scalelightfixed = NULL;
+unsigned short *zlight = NULL;
 lighttable_t *fullcolormap;
 lighttable_t **colormaps;
 
@@ -124,9 +126,9 @@ void (*colfunc)(void) = R_DrawColumn;     // current column draw function
 // Workaround for optimization bug in clang
 // fixes desync in competn/doom/fp2-3655.lmp and in dmnsns.wad dmn01m909.lmp
 #if defined(__clang__)
-int R_PointOnSide(volatile fixed_t x, volatile fixed_t y, node_t *node)
+int R_PointOnSide(volatile fixed_t x, volatile fixed_t y, const bspnode_t *node)
 #else
-int R_PointOnSide(fixed_t x, fixed_t y, node_t *node)
+int R_PointOnSide(fixed_t x, fixed_t y, const bspnode_t *node)
 #endif
 {
   if (!node->dx)
@@ -362,36 +364,10 @@ boolean smoothlight;
 
 void R_InitLightTables (void)
 {
-  int i, cm;
-    
-  if (c_scalelight)
-  {
-    for (cm = 0; cm < numcolormaps; ++cm)
-    {
-      for (i = 0; i < LIGHTLEVELS; ++i)
-        Z_Free(c_scalelight[cm][i]);
-
-      Z_Free(c_scalelight[cm]);
-    }
-    Z_Free(c_scalelight);
-  }
-
-  if (scalelightfixed)
-  {
-    Z_Free(scalelightfixed);
-  }
-
-  if (c_zlight)
-  {
-    for (cm = 0; cm < numcolormaps; ++cm)
-    {
-      for (i = 0; i < LIGHTLEVELS; ++i)
-        Z_Free(c_zlight[cm][i]);
+  int i;
 
-      Z_Free(c_zlight[cm]);
-    }
-    Z_Free(c_zlight);
-  }
+  if (lighttables)
+    Z_Free(lighttables);
 
   if (smoothlight)
   {
@@ -414,17 +390,13 @@ void R_InitLightTables (void)
       LIGHTZSHIFT = 20;
   }
 
-  scalelightfixed = Z_Malloc(MAXLIGHTSCALE * sizeof(*scalelightfixed), PU_STATIC, 0);
-
-  // killough 4/4/98: dynamic colormaps
-  c_zlight = Z_Malloc(sizeof(*c_zlight) * numcolormaps, PU_STATIC, 0);
-  c_scalelight = Z_Malloc(sizeof(*c_scalelight) * numcolormaps, PU_STATIC, 0);
-
-  for (cm = 0; cm < numcolormaps; ++cm)
-  {
-    c_zlight[cm] = Z_Malloc(LIGHTLEVELS * sizeof(**c_zlight), PU_STATIC, 0);
-    c_scalelight[cm] = Z_Malloc(LIGHTLEVELS * sizeof(**c_scalelight), PU_STATIC, 0);
-  }
+  // [Woof!] zlight, scalelight and the fixed colormap row in one block,
+  // which is all there is to redo for smoothlight.
+  lighttables = Z_Malloc((LIGHTLEVELS * (MAXLIGHTZ + MAXLIGHTSCALE) + MAXLIGHTSCALE)
+                         * sizeof(*lighttables), PU_STATIC, 0);
+  zlight = lighttables;
+  scalelight = zlight + LIGHTLEVELS * MAXLIGHTZ;
+  scalelightfixed = scalelight + LIGHTLEVELS * MAXLIGHTSCALE;
 
   // Calculate the light levels to use
   //  for each level / distance combination.
@@ -432,16 +404,10 @@ void R_InitLightTables (void)
     {
       int j, startmap = ((LIGHTLEVELS-LIGHTBRIGHT-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 
-      for (cm = 0; cm < numcolormaps; ++cm)
-      {
-        c_scalelight[cm][i] = Z_Malloc(MAXLIGHTSCALE * sizeof(***c_scalelight), PU_STATIC, 0);
-        c_zlight[cm][i] = Z_Malloc(MAXLIGHTZ * sizeof(***c_zlight), PU_STATIC, 0);
-      }
-
       for (j=0; j<MAXLIGHTZ; j++)
         {
           int scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
-          int t, level = startmap - (scale >>= LIGHTSCALESHIFT)/DISTMAP;
+          int level = startmap - (scale >>= LIGHTSCALESHIFT)/DISTMAP;
 
           if (level < 0)
             level = 0;
@@ -449,10 +415,7 @@ void R_InitLightTables (void)
             if (level >= NUMCOLORMAPS)
               level = NUMCOLORMAPS-1;
 
-          // killough 3/20/98: Initialize multiple colormaps
-          level *= 256;
-          for (t=0; t<numcolormaps; t++)         // killough 4/4/98
-            c_zlight[t][i][j] = colormaps[t] + level;
+          zlight[i * MAXLIGHTZ + j] = level * 256;
         }
     }
 }
@@ -612,7 +575,7 @@ void R_ExecuteSetViewSize (void)
 
       for (j=0 ; j<MAXLIGHTSCALE ; j++)
         {                                       // killough 11/98:
-          int t, level = startmap - j*NONWIDEWIDTH/scaledviewwidth_nonwide/DISTMAP;
+          int level = startmap - j*NONWIDEWIDTH/scaledviewwidth_nonwide/DISTMAP;
 
           if (level < 0)
             level = 0;
@@ -620,11 +583,7 @@ void R_ExecuteSetViewSize (void)
           if (level >= NUMCOLORMAPS)
             level = NUMCOLORMAPS-1;
 
-          // killough 3/20/98: initialize multiple colormaps
-          level *= 256;
-
-          for (t=0; t<numcolormaps; t++)     // killough 4/4/98
-            c_scalelight[t][i][j] = colormaps[t] + level;
+          scalelight[i * MAXLIGHTSCALE + j] = level * 256;
         }
     }
 
@@ -652,6 +611,24 @@ void R_Init (void)
   R_SetFuzzColumnMode();
 }
 
+//
+// R_NewValidCount
+// Starts a traversal, allocating the stamps for the current level on
+// first use. They are PU_LEVEL, so the next level gets fresh ones.
+//
+
+void R_NewValidCount(validcount_t *vc)
+{
+  if (!vc->lines)
+  {
+    Z_Calloc(numlines, sizeof(*vc->lines), PU_LEVEL, (void **) &vc->lines);
+    Z_Calloc(numsectors, sizeof(*vc->sectors), PU_LEVEL,
+             (void **) &vc->sectors);
+  }
+
+  vc->count++;
+}
+
 //
 // R_PointInSubsector
 //
@@ -668,7 +645,7 @@ subsector_t *R_PointInSubsector(fixed_t x, fixed_t y)
   }
 
   while (!(nodenum & NF_SUBSECTOR))
-    nodenum = nodes[nodenum].children[R_PointOnSide(x, y, nodes+nodenum)];
+    nodenum = bspnodes[nodenum].children[R_PointOnSide(x, y, bspnodes+nodenum)];
   return &subsectors[nodenum & ~NF_SUBSECTOR];
 }
 
@@ -782,23 +759,21 @@ void R_SetupFrame (player_t *player)
     cm = 0;
 
   fullcolormap = colormaps[cm];
-  zlight = c_zlight[cm];
-  scalelight = c_scalelight[cm];
 
   if (player->fixedcolormap)
     {
       fixedcolormap = fullcolormap   // killough 3/20/98: use fullcolormap
-        + player->fixedcolormap*256*sizeof(lighttable_t);
+        + player->fixedcolormap*256;
         
       walllights = scalelightfixed;
 
       for (i=0 ; i<MAXLIGHTSCALE ; i++)
-        scalelightfixed[i] = fixedcolormap;
+        scalelightfixed[i] = player->fixedcolormap*256;
     }
   else
     fixedcolormap = 0;
 
-  validcount++;
+  R_NewValidCount(&rendervalidcount);
 }
 
 //
@@ -806,6 +781,7 @@ void R_SetupFrame (player_t *player)
 //
 
 int rendered_visplanes, rendered_segs, rendered_vissprites, rendered_voxels;
+uint64_t rendered_time;
 
 static void R_ClearStats(void)
 {
@@ -820,7 +796,7 @@ int autodetect_hom = 0;       // killough 2/7/98: HOM autodetection flag
 //
 // R_RenderView
 //
-void R_RenderPlayerView (player_t* player)
+static void R_RenderView (player_t* player)
 {       
   R_ClearStats();
 
@@ -839,7 +815,12 @@ void R_RenderPlayerView (player_t* player)
       extern int lastshottic;
       const int linesize = video.width;
       int i , color = !flashing_hom || (gametic % 20) < 9 ? 0xb0 : 0;
+#ifdef TRUECOLOR
+      for (i=0;i<viewheight*linesize;i++)
+        I_VideoBuffer[viewwindowy*linesize+i] = V_Pixel(color);
+#else
       memset(I_VideoBuffer+viewwindowy*linesize,color,viewheight*linesize);
+#endif
       for (i=0;i<47*47;i++)
         {
           char t =
@@ -897,7 +878,7 @@ void R_RenderPlayerView (player_t* player)
 "////////////////////////////////g\3\211\206\202\\\201\200\201\202\203dde/////"
 "/////////////////////////////\234\3db\203\203\203\203adec////////////////////"
 "/////////////////hffed\211de////////////////////"[i];
-          c[i] = t=='/' ? color : t;
+          c[i] = V_Pixel(t=='/' ? color : t);
         }
       if (gametic-lastshottic < TICRATE*2 && gametic-lastshottic > TICRATE/8)
         V_DrawBlock(scaledviewx +  scaledviewwidth/2 - 24,
@@ -909,7 +890,9 @@ void R_RenderPlayerView (player_t* player)
   NetUpdate ();
 
   // The head node is the last node output.
+  TRACE_BEGIN("R_RenderBSPNode");
   R_RenderBSPNode (numnodes-1);
+  TRACE_END();
 
   VX_NearbySprites ();
 
@@ -920,19 +903,32 @@ void R_RenderPlayerView (player_t* player)
   // Check for new console commands.
   NetUpdate ();
     
+  TRACE_BEGIN("R_DrawPlanes");
   R_DrawPlanes ();
+  TRACE_END();
     
   // Check for new console commands.
   NetUpdate ();
     
   // [crispy] draw fuzz effect independent of rendering frame rate
   R_SetFuzzPosDraw();
+  TRACE_BEGIN("R_DrawMasked");
   R_DrawMasked ();
+  TRACE_END();
 
   // Check for new console commands.
   NetUpdate ();
 }
 
+void R_RenderPlayerView (player_t* player)
+{
+  const uint64_t start = I_GetTimeUS();
+
+  R_RenderView(player);
+
+  rendered_time = I_GetTimeUS() - start;
+}
+
 void R_InitAnyRes(void)
 {
   R_InitSpritesRes();
@@ -40,7 +40,6 @@ extern fixed_t  centeryfrac;
 extern fixed_t  focallength;
 extern fixed_t  projection;
 extern fixed_t  skyiscale;
-extern int      validcount;
 extern int      linecount;
 extern int      loopcount;
 extern fixed_t  viewheightfrac; // [FG] sprite clipping optimizations
@@ -50,6 +49,7 @@ extern fixed_t  viewheightfrac; // [FG] sprite clipping optimizations
 //
 
 extern int rendered_visplanes, rendered_segs, rendered_vissprites, rendered_voxels;
+extern uint64_t rendered_time; // [Woof!] microseconds, drives dynamic resolution
 
 //
 // Lighting LUT.
@@ -67,11 +67,21 @@ extern int LIGHTSCALESHIFT;
 extern int MAXLIGHTZ;
 extern int LIGHTZSHIFT;
 
-// killough 3/20/98: Allow colormaps to be dynamic (e.g. underwater)
-extern lighttable_t **(*scalelight);
-extern lighttable_t **(*zlight);
+// [Woof!] The light tables hold offsets into fullcolormap, which are the
+// same for every colormap. Both live in one block, a row per light level.
+extern unsigned short *scalelight;  // [LIGHTLEVELS][MAXLIGHTSCALE]
+extern unsigned short *zlight;      // [LIGHTLEVELS][MAXLIGHTZ]
 extern int numcolormaps;    // killough 4/4/98: dynamic number of maps
-// killough 3/20/98, 4/4/98: end dynamic colormaps
+
+inline static const unsigned short *R_ScaleLight(int lightnum)
+{
+  return scalelight + BETWEEN(0, LIGHTLEVELS-1, lightnum) * MAXLIGHTSCALE;
+}
+
+inline static const unsigned short *R_ZLight(int lightnum)
+{
+  return zlight + BETWEEN(0, LIGHTLEVELS-1, lightnum) * MAXLIGHTZ;
+}
 
 extern boolean setsmoothlight;
 void R_SmoothLight(void);
@@ -94,7 +104,7 @@ extern void (*colfunc)(void);
 // Utility functions.
 //
 
-int R_PointOnSide(fixed_t x, fixed_t y, node_t *node);
+int R_PointOnSide(fixed_t x, fixed_t y, const bspnode_t *node);
 int R_PointOnSegSide(fixed_t x, fixed_t y, seg_t *line);
 angle_t R_PointToAngle(fixed_t x, fixed_t y);
 angle_t R_PointToAngle2(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2);
@@ -43,6 +43,7 @@
 #include "r_bmaps.h" // [crispy] R_BrightmapForTexName()
 #include "r_swirl.h" // [crispy] R_DistortedFlat()
 #include "v_video.h"
+#include "m_array.h"
 
 #define MAXVISPLANES 128    /* must be a power of 2 */
 
@@ -76,7 +77,7 @@ static int *spanstart = NULL;                // killough 2/8/98
 // texture mapping
 //
 
-static lighttable_t **planezlight;
+static const unsigned short *planezlight;
 static fixed_t planeheight;
 
 // killough 2/8/98: make variables static
@@ -93,6 +94,28 @@ fixed_t *yslope = NULL, *distscale = NULL;
 boolean linearsky;
 static angle_t *xtoskyangle;
 
+// [Woof!] Span plane renderer. Instead of keeping the columns of every
+// visplane for the whole frame, the floor and ceiling columns of each wall
+// are turned into row runs as soon as the wall is done. Every screen row
+// keeps its last run open, so that runs of the same plane which touch are
+// merged into one span. Visplanes then only carry the plane parameters and
+// a list of spans, and are never split.
+
+boolean r_spanplanes;
+static boolean spanplanes;      // r_spanplanes, latched for the frame
+
+typedef struct
+{
+  int next;         // next span of the same plane, -1 if none
+  int pos;          // row of a flat span, column of a sky span
+  int start, stop;  // columns of a flat span, rows of a sky span
+} planespan_t;
+
+static planespan_t *planespans;
+
+static visplane_t **rowplane;   // plane of the open run on each row, or NULL
+static int *rowstart, *rowstop;
+
 //
 // R_InitPlanes
 // Only at game startup.
@@ -118,6 +141,10 @@ void R_InitPlanesRes(void)
 
   if (openings) Z_Free(openings);
 
+  if (rowplane) Z_Free(rowplane);
+  if (rowstart) Z_Free(rowstart);
+  if (rowstop) Z_Free(rowstop);
+
   floorclip = Z_Calloc(1, video.width * sizeof(*floorclip), PU_STATIC, NULL);
   ceilingclip = Z_Calloc(1, video.width * sizeof(*ceilingclip), PU_STATIC, NULL);
   spanstart = Z_Calloc(1, video.height * sizeof(*spanstart), PU_STATIC, NULL);
@@ -132,6 +159,10 @@ void R_InitPlanesRes(void)
 
   openings = Z_Calloc(1, video.width * video.height * sizeof(*openings), PU_STATIC, NULL);
 
+  rowplane = Z_Calloc(1, video.height * sizeof(*rowplane), PU_STATIC, NULL);
+  rowstart = Z_Calloc(1, video.height * sizeof(*rowstart), PU_STATIC, NULL);
+  rowstop = Z_Calloc(1, video.height * sizeof(*rowstop), PU_STATIC, NULL);
+
   xtoskyangle = linearsky ? linearskyangle : xtoviewangle;
 }
 
@@ -212,7 +243,7 @@ static void R_MapPlane(int y, int x1, int x2)
       index = distance >> LIGHTZSHIFT;
       if (index >= MAXLIGHTZ )
         index = MAXLIGHTZ-1;
-      ds_colormap[0] = planezlight[index];
+      ds_colormap[0] = fullcolormap + planezlight[index];
       ds_colormap[1] = fullcolormap;
     }
 
@@ -244,6 +275,12 @@ void R_ClearPlanes(void)
 
   // texture calculation
   memset(cachedheight, 0, viewheight * sizeof(*cachedheight));
+
+  if ((spanplanes = r_spanplanes))
+  {
+    memset(rowplane, 0, viewheight * sizeof(*rowplane));
+    array_clear(planespans);
+  }
 }
 
 // New function, by Lee Killough
@@ -253,9 +290,11 @@ static visplane_t *new_visplane(unsigned hash)
   visplane_t *check = freetail;
   if (!check)
   {
-    const int size = sizeof(*check) + (video.width * 2) * sizeof(*check->top);
+    // [Woof!] Sized for the pitch, the widest the screen gets until the
+    // next full reset, so that dynamic resolution can keep visplanes.
+    const int size = sizeof(*check) + (video.pitch * 2) * sizeof(*check->top);
     check = Z_Calloc(1, size, PU_VALLOC, NULL);
-    check->bottom = &check->top[video.width + 2];
+    check->bottom = &check->top[video.pitch + 2];
   }
   else
     if (!(freetail = freetail->next))
@@ -279,6 +318,7 @@ visplane_t *R_DupPlane(const visplane_t *pl, int start, int stop)
       new_pl->yoffs = pl->yoffs;
       new_pl->minx = start;
       new_pl->maxx = stop;
+      new_pl->spans = -1;
       memset(new_pl->top, UCHAR_MAX, video.width * sizeof(*new_pl->top));
 
       return new_pl;
@@ -328,8 +368,11 @@ visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel,
   check->maxx = -1;
   check->xoffs = xoffs;               // killough 2/28/98: Save offsets
   check->yoffs = yoffs;
+  check->spans = -1;
 
-  memset(check->top, UCHAR_MAX, video.width * sizeof(*check->top));
+  // [Woof!] R_CheckPlane() clears the columns of each wall in span mode
+  if (!spanplanes)
+    memset(check->top, UCHAR_MAX, video.width * sizeof(*check->top));
 
   return check;
 }
@@ -341,6 +384,16 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop)
 {
   int intrl, intrh, unionl, unionh, x;
 
+  // [Woof!] The columns are only kept until R_MarkPlaneSpans(), so walls
+  // never overlap in them.
+  if (spanplanes)
+  {
+    pl->minx = MIN(pl->minx, start);
+    pl->maxx = MAX(pl->maxx, stop);
+    memset(&pl->top[start], UCHAR_MAX, (stop - start + 1) * sizeof(*pl->top));
+    return pl;
+  }
+
   if (start < pl->minx)
     intrl   = pl->minx, unionl = start;
   else
@@ -378,6 +431,90 @@ static void R_MakeSpans(int x, unsigned int t1, unsigned int b1, unsigned int t2
     spanstart[b2--] = x;
 }
 
+//
+// [Woof!] Span plane renderer
+//
+
+static void R_AddSpan(visplane_t *pl, int pos, int start, int stop)
+{
+  const planespan_t span = {pl->spans, pos, start, stop};
+
+  array_push(planespans, span);
+  pl->spans = array_size(planespans) - 1;
+}
+
+// Continues the open run on row y if it belongs to the same plane and
+// touches, otherwise closes it and opens a new one.
+
+static void R_AddRun(visplane_t *pl, int y, int x1, int x2)
+{
+  if (rowplane[y] == pl && rowstop[y] + 1 == x1)
+    rowstop[y] = x2;
+  else if (rowplane[y] == pl && x2 + 1 == rowstart[y])
+    rowstart[y] = x1;
+  else
+  {
+    if (rowplane[y])
+      R_AddSpan(rowplane[y], y, rowstart[y], rowstop[y]);
+
+    rowplane[y] = pl;
+    rowstart[y] = x1;
+    rowstop[y] = x2;
+  }
+}
+
+// Same as R_MakeSpans(), but the spans go into the open runs.
+
+static void R_MakeRuns(visplane_t *pl, int x, unsigned int t1, unsigned int b1,
+                       unsigned int t2, unsigned int b2)
+{
+  for (; t1 < t2 && t1 <= b1; t1++)
+    R_AddRun(pl, t1, spanstart[t1], x-1);
+  for (; b1 > b2 && b1 >= t1; b1--)
+    R_AddRun(pl, b1, spanstart[b1], x-1);
+  while (t2 < t1 && t2 <= b2)
+    spanstart[t2++] = x;
+  while (b2 > b1 && b2 >= t2)
+    spanstart[b2--] = x;
+}
+
+void R_MarkPlaneSpans(visplane_t *pl, int start, int stop)
+{
+  int x;
+
+  if (!spanplanes)
+    return;
+
+  if (pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT)
+  {
+    // skies are drawn by column
+    for (x = start; x <= stop; x++)
+      if (pl->top[x] != USHRT_MAX && pl->top[x] <= pl->bottom[x])
+        R_AddSpan(pl, x, pl->top[x], pl->bottom[x]);
+  }
+  else
+  {
+    pl->top[start-1] = pl->top[stop+1] = USHRT_MAX;
+
+    for (x = start; x <= stop+1; x++)
+      R_MakeRuns(pl, x, pl->top[x-1], pl->bottom[x-1], pl->top[x], pl->bottom[x]);
+  }
+}
+
+// Closes the runs that are still open at the end of the frame.
+
+static void R_CloseRuns(void)
+{
+  int y;
+
+  for (y = 0; y < viewheight; y++)
+    if (rowplane[y])
+    {
+      R_AddSpan(rowplane[y], y, rowstart[y], rowstop[y]);
+      rowplane[y] = NULL;
+    }
+}
+
 // New function, by Lee Killough
 
 static void do_draw_plane(visplane_t *pl)
@@ -475,6 +612,23 @@ static void do_draw_plane(visplane_t *pl)
         }
 
 	// killough 10/98: Use sky scrolling offset, and possibly flip picture
+        if (spanplanes)
+        {
+          const planespan_t *span;
+          int i;
+
+          for (i = pl->spans; i >= 0; i = span->next)
+          {
+            span = &planespans[i];
+            dc_x = x = span->pos;
+            dc_yl = span->start;
+            dc_yh = span->stop;
+            dc_source = R_GetColumnMod2(texture, ((an + xtoskyangle[x])^flip) >>
+                                        ANGLETOSKYSHIFT);
+            colfunc();
+          }
+        }
+        else
         for (x = pl->minx; (dc_x = x) <= pl->maxx; x++)
           if ((dc_yl = pl->top[x]) != USHRT_MAX && dc_yl <= (dc_yh = pl->bottom[x]))
             {
@@ -508,18 +662,27 @@ static void do_draw_plane(visplane_t *pl)
         planeheight = abs(pl->height-viewz);
         light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
 
-        if (light >= LIGHTLEVELS)
-          light = LIGHTLEVELS-1;
+        stop = pl->maxx + 1;
+        planezlight = R_ZLight(light);
 
-        if (light < 0)
-          light = 0;
+        if (spanplanes)
+        {
+          const planespan_t *span;
+          int i;
 
-        stop = pl->maxx + 1;
-        planezlight = zlight[light];
+          for (i = pl->spans; i >= 0; i = span->next)
+          {
+            span = &planespans[i];
+            R_MapPlane(span->pos, span->start, span->stop);
+          }
+        }
+        else
+        {
         pl->top[pl->minx-1] = pl->top[stop] = USHRT_MAX;
 
         for (x = pl->minx ; x <= stop ; x++)
           R_MakeSpans(x,pl->top[x-1],pl->bottom[x-1],pl->top[x],pl->bottom[x]);
+        }
 
         if (!swirling) Z_ChangeTag (ds_source, PU_CACHE);
       }
@@ -535,6 +698,10 @@ void R_DrawPlanes (void)
 {
   visplane_t *pl;
   int i;
+
+  if (spanplanes)
+    R_CloseRuns();
+
   for (i=0;i<MAXVISPLANES;i++)
     for (pl=visplanes[i]; pl; pl=pl->next)
     {
@@ -31,6 +31,8 @@ extern  int *lastopening; // [FG] 32-bit integer math
 extern int *floorclip, *ceilingclip; // [FG] 32-bit integer math
 extern fixed_t *yslope, *distscale;
 
+extern boolean r_spanplanes;
+
 void R_InitPlanes(void);
 void R_ClearPlanes(void);
 void R_DrawPlanes (void);
@@ -48,6 +50,9 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop);
 // cph 2003/04/18 - create duplicate of existing visplane and set initial range
 visplane_t *R_DupPlane(const visplane_t *pl, int start, int stop);
 
+// [Woof!] Called after a wall has marked its floor and ceiling columns.
+void R_MarkPlaneSpans(visplane_t *pl, int start, int stop);
+
 void R_InitPlanesRes(void);
 
 void R_InitVisplanesRes(void);
@@ -46,7 +46,7 @@ static int      midtexture;
 angle_t         rw_normalangle; // angle to line origin
 int             rw_angle1;
 fixed_t         rw_distance;
-lighttable_t    **walllights;
+const unsigned short *walllights;
 
 //
 // regular wall
@@ -122,8 +122,7 @@ void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
       lightnum++;
 #endif
 
-  walllights = lightnum >= LIGHTLEVELS ? scalelight[LIGHTLEVELS-1] :
-    lightnum <  0           ? scalelight[0] : scalelight[lightnum];
+  walllights = R_ScaleLight(lightnum);
 
   maskedtexturecol = ds->maskedtexturecol;
 
@@ -164,7 +163,7 @@ void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
 
             // [crispy] brightmaps for two sided mid-textures
             dc_brightmap = texturebrightmap[texnum];
-            dc_colormap[0] = walllights[index];
+            dc_colormap[0] = fullcolormap + walllights[index];
             dc_colormap[1] = STRICTMODE(brightmaps) ? fullcolormap : dc_colormap[0];
           }
 
@@ -382,7 +381,7 @@ static void R_RenderSegLoop (void)
 
           if (index >=  MAXLIGHTSCALE )
             index = MAXLIGHTSCALE-1;
-          dc_colormap[0] = walllights[index];
+          dc_colormap[0] = fullcolormap + walllights[index];
           dc_colormap[1] = (!fixedcolormap && STRICTMODE(brightmaps)) ?
                            fullcolormap : dc_colormap[0];
           dc_x = rw_x;
@@ -788,12 +787,7 @@ void R_StoreWallRange(const int start, const int stop)
           else if (curline->v1->x == curline->v2->x)
             lightnum++;
 #endif
-          if (lightnum < 0)
-            walllights = scalelight[0];
-          else if (lightnum >= LIGHTLEVELS)
-            walllights = scalelight[LIGHTLEVELS-1];
-          else
-            walllights = scalelight[lightnum];
+          walllights = R_ScaleLight(lightnum);
         }
     }
 
@@ -861,6 +855,12 @@ void R_StoreWallRange(const int start, const int stop)
   didsolidcol = false;
   R_RenderSegLoop();
 
+  // [Woof!] span plane renderer
+  if (markceiling)
+    R_MarkPlaneSpans(ceilingplane, start, stop);
+  if (markfloor)
+    R_MarkPlaneSpans(floorplane, start, stop);
+
   // cph - if a column was made solid by this wall, we _must_ save full clipping
   // info
   if (backsector && didsolidcol)
@@ -81,6 +81,8 @@ extern subsector_t      *subsectors;
 
 extern int              numnodes;
 extern node_t           *nodes;
+extern bspnode_t        *bspnodes;  // nodes in traversal order
+extern bspbbox_t        *bspbboxes;
 
 extern int              numlines;
 extern line_t           *lines;
@@ -88,6 +90,48 @@ extern line_t           *lines;
 extern int              numsides;
 extern side_t           *sides;
 
+//
+// Visit stamps for map traversals.
+// A traversal starts with R_NewValidCount(); a line or sector has already
+// been seen by it when its stamp equals count. Traversals that may run at
+// the same time need their own validcount_t. Nested playsim traversals
+// share one, since demo sync depends on them seeing each other's marks.
+//
+
+typedef struct
+{
+  int count;
+  int *lines;           // numlines stamps, allocated on first use per level
+  int *sectors;         // numsectors stamps
+} validcount_t;
+
+extern validcount_t     validcount;        // playsim
+extern validcount_t     rendervalidcount;  // R_RenderPlayerView()
+
+void R_NewValidCount(validcount_t *vc);
+
+// Returns false if the line or sector has been marked before.
+
+inline static boolean R_MarkLine(validcount_t *vc, const line_t *ld)
+{
+  int *stamp = &vc->lines[ld - lines];
+
+  if (*stamp == vc->count)
+    return false;
+  *stamp = vc->count;
+  return true;
+}
+
+inline static boolean R_MarkSector(validcount_t *vc, const sector_t *sec)
+{
+  int *stamp = &vc->sectors[sec - sectors];
+
+  if (*stamp == vc->count)
+    return false;
+  *stamp = vc->count;
+  return true;
+}
+
 typedef struct localview_s
 {
     angle_t oldticangle;
@@ -55,7 +55,7 @@ typedef struct {
 fixed_t pspritescale;
 fixed_t pspriteiscale;
 
-lighttable_t **spritelights;        // killough 1/25/98 made static
+const unsigned short *spritelights;        // killough 1/25/98 made static
 
 // [Woof!] optimization for drawing huge amount of drawsegs.
 // adapted from prboom-plus/src/r_things.c
@@ -667,7 +667,7 @@ void R_ProjectSprite (mobj_t* thing)
       int index = FixedDiv(xscale * 160, focallength) >> LIGHTSCALESHIFT;
       if (index >= MAXLIGHTSCALE)
         index = MAXLIGHTSCALE-1;
-      vis->colormap[0] = spritelights[index];
+      vis->colormap[0] = fullcolormap + spritelights[index];
       vis->colormap[1] = fullcolormap;
     }
   vis->brightmap = R_BrightmapForSprite(thing->sprite);
@@ -701,23 +701,16 @@ void R_AddSprites(sector_t* sec, int lightlevel)
   //  subsectors during BSP building.
   // Thus we check whether its already added.
 
-  if (sec->validcount == validcount)
-    return;
-
   // Well, now it will be done.
-  sec->validcount = validcount;
+  if (!R_MarkSector(&rendervalidcount, sec))
+    return;
 
   if (demo_version <= 202)
     lightlevel = sec->lightlevel;
 
   lightnum = (lightlevel >> LIGHTSEGSHIFT)+extralight;
 
-  if (lightnum < 0)
-    spritelights = scalelight[0];
-  else if (lightnum >= LIGHTLEVELS)
-    spritelights = scalelight[LIGHTLEVELS-1];
-  else
-    spritelights = scalelight[lightnum];
+  spritelights = R_ScaleLight(lightnum);
 
   // Handle all things in sector.
 
@@ -820,7 +813,7 @@ void R_DrawPSprite (pspdef_t *psp)
     vis->colormap[0] = vis->colormap[1] = fullcolormap;            // full bright // killough 3/20/98
   else
   {
-    vis->colormap[0] = spritelights[MAXLIGHTSCALE-1];  // local light
+    vis->colormap[0] = fullcolormap + spritelights[MAXLIGHTSCALE-1];  // local light
     vis->colormap[1] = fullcolormap;
   }
   vis->brightmap = R_BrightmapForState(psp->state - states);
@@ -890,12 +883,7 @@ void R_DrawPlayerSprites(void)
   lightnum = ((floorlightlevel+ceilinglightlevel) >> (LIGHTSEGSHIFT+1))
     + extralight;
 
-  if (lightnum < 0)
-    spritelights = scalelight[0];
-  else if (lightnum >= LIGHTLEVELS)
-    spritelights = scalelight[LIGHTLEVELS-1];
-  else
-    spritelights = scalelight[lightnum];
+  spritelights = R_ScaleLight(lightnum);
 
   // clip to screen bounds
   mfloorclip = screenheightarray;
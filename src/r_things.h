@@ -40,7 +40,7 @@ extern fixed_t pspriteiscale;
 
 extern boolean pspr_interp; // weapon bobbing interpolation
 
-extern lighttable_t **spritelights;
+extern const unsigned short *spritelights;
 
 void R_DrawMaskedColumn(column_t *column);
 void R_SortVisSprites(void);
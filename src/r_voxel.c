@@ -489,7 +489,7 @@ static boolean VX_CheckFrustum (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
 	c = c << 12;
 	s = s << 12;
 
-	node_t left;
+	bspnode_t left;
 
 	left.x  = 0;
 	left.y  = 0;
@@ -504,7 +504,7 @@ static boolean VX_CheckFrustum (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
 		return false;
 	}
 
-	node_t right;
+	bspnode_t right;
 
 	right.x  = 0;
 	right.y  = 0;
@@ -729,7 +729,7 @@ boolean VX_ProjectVoxel (mobj_t * thing)
 		if (index < 0)               index = 0;
 		if (index > MAXLIGHTSCALE-1) index = MAXLIGHTSCALE-1;
 
-		vis->colormap[0] = spritelights[index];
+		vis->colormap[0] = fullcolormap + spritelights[index];
 		vis->colormap[1] = fullcolormap;
 	}
 
@@ -845,7 +845,7 @@ static void VX_DrawColumn (vissprite_t * spr, int x, int y)
 	boolean shadow = ((spr->mobjflags & MF_SHADOW) != 0);
 
 	int linesize = video.pitch;
-	byte * dest = I_VideoBuffer + viewwindowy * linesize + viewwindowx;
+	pixel_t * dest = I_VideoBuffer + viewwindowy * linesize + viewwindowx;
 
 	// iterate over screen columns
 	fixed_t ux = ((Ax - 1) | (FRACUNIT - 1)) + 1;
@@ -936,7 +936,7 @@ static void VX_DrawColumn (vissprite_t * spr, int x, int y)
 					uy = clip_y1;
 
 				byte src = slab[0];
-				byte pix = spr->colormap[spr->brightmap[src]][src];
+				lighttable_t pix = spr->colormap[spr->brightmap[src]][src];
 
 				for (; uy < uy1 ; uy += FRACUNIT)
 				{
@@ -951,7 +951,7 @@ static void VX_DrawColumn (vissprite_t * spr, int x, int y)
 					uy = clip_y2;
 
 				byte src = slab[len - 1];
-				byte pix = spr->colormap[spr->brightmap[src]][src];
+				lighttable_t pix = spr->colormap[spr->brightmap[src]][src];
 
 				for (; uy > uy2 ; uy -= FRACUNIT)
 				{
@@ -971,7 +971,7 @@ static void VX_DrawColumn (vissprite_t * spr, int x, int y)
 					if (i >= len) i = len - 1;
 
 					byte src = slab[i];
-					byte pix = spr->colormap[spr->brightmap[src]][src];
+					lighttable_t pix = spr->colormap[spr->brightmap[src]][src];
 
 					dest[(uy >> FRACBITS) * linesize + (ux >> FRACBITS)] = pix;
 				}
@@ -1051,7 +1051,7 @@ void VX_DrawVoxel (vissprite_t * spr)
 		const byte * trans = translationtables - 256 +
 			( (spr->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
 
-		static byte new_colormap[256];
+		static lighttable_t new_colormap[256];
 
 		int i;
 		for (i = 0 ; i < 256 ; i++)
@@ -1065,7 +1065,7 @@ void VX_DrawVoxel (vissprite_t * spr)
 		static const byte * prev_trans = NULL;
 		const byte * trans = red2col[spr->color];
 
-		static byte new_colormap[256];
+		static lighttable_t new_colormap[256];
 
 		if (prev_trans != trans)
 		{
@@ -1097,7 +1097,7 @@ void VX_DrawVoxel (vissprite_t * spr)
 
 //------------------------------------------------------------------------
 
-static boolean VX_CheckBBox (fixed_t * bspcoord)
+static boolean VX_CheckBBox (const fixed_t * bspcoord)
 {
 	if (bspcoord[BOXRIGHT]  <= viewx - VX_NEAR_RADIUS) return false;
 	if (bspcoord[BOXLEFT]   >= viewx + VX_NEAR_RADIUS) return false;
@@ -1119,14 +1119,15 @@ static void VX_SpritesInNode (int bspnum)
 			return;
 		}
 
-		node_t * bsp = &nodes[bspnum];
+		const bspnode_t * bsp = &bspnodes[bspnum];
+		const bspbbox_t * box = &bspbboxes[bspnum];
 
 		// divide the front space
-		if (VX_CheckBBox (bsp->bbox[0]))
+		if (VX_CheckBBox (box->bbox[0]))
 			VX_SpritesInNode (bsp->children[0]);
 
 		// divide the back space
-		if (VX_CheckBBox (bsp->bbox[1]))
+		if (VX_CheckBBox (box->bbox[1]))
 			bspnum = bsp->children[1];
 		else
 			break;
@@ -27,30 +27,48 @@
 #include "s_sound.h"
 #include "s_musinfo.h" // [crispy] struct musinfo
 #include "i_sound.h"
+#include "i_timer.h"
 #include "r_main.h"
 #include "m_random.h"
 #include "m_misc2.h"
+#include "m_trace.h"
 #include "w_wad.h"
 
 //jff end sound enabling variables readable here
 
-typedef struct channel_s
+// [Woof!] Sounds are tracked as voices, of which only the numChannels most
+// audible ones are bound to a hardware channel. The others are virtual:
+// they go on silently until they end, or until they are audible enough
+// to take a channel back, and then resume where they would have been.
+
+#define MAX_VOICES 256
+
+// How much a virtual voice must beat a bound one by to take its channel,
+// so that voices at similar distances do not keep trading places.
+#define VOICE_HYSTERESIS 16
+
+typedef struct voice_s
 {
-  sfxinfo_t *sfxinfo;      // sound information (if null, channel avail.)
+  sfxinfo_t *sfxinfo;      // sound information (if null, voice avail.)
   const mobj_t *origin;    // origin of sound
   int volume;              // volume scale value for effect -- haleyjd 05/29/06
   int pitch;               // pitch modifier -- haleyjd 06/03/06
-  int handle;              // handle of the sound being played
+  int handle;              // handle of the sound being played, -1 if virtual
   int o_priority;          // haleyjd 09/27/06: stored priority value
   int priority;            // current priority value
   int singularity;         // haleyjd 09/27/06: stored singularity value
   int idnum;               // haleyjd 09/30/06: unique id num for sound event
-} channel_t;
+  int starttime;           // I_GetTimeMS() when the sound was started
+} voice_t;
 
-// the set of channels available
-static channel_t channels[MAX_CHANNELS];
+// the set of voices available
+static voice_t voices[MAX_VOICES];
+static int numvoices;      // voices[numvoices] and above are free
 // [FG] removed map objects may finish their sounds
-static mobj_t sobjs[MAX_CHANNELS];
+static mobj_t sobjs[MAX_VOICES];
+
+// Audibility of all voices, from S_ScoreVoices()
+static int voice_score[MAX_VOICES];
 
 // These are not used, but should be (menu).
 // Maximum volume of a sound effect.
@@ -80,24 +98,57 @@ int idmusnum;
 //
 
 //
-// S_StopChannel
+// S_StopVoice
 //
-// Stops a sound channel.
+// Stops a voice, and its sound if it is playing.
 //
-static void S_StopChannel(int cnum)
+static void S_StopVoice(int vnum)
 {
 #ifdef RANGECHECK
-   if(cnum < 0 || cnum >= numChannels)
-      I_Error("S_StopChannel: handle %d out of range\n", cnum);
+   if(vnum < 0 || vnum >= numvoices)
+      I_Error("S_StopVoice: handle %d out of range\n", vnum);
 #endif
 
-   if(channels[cnum].sfxinfo)
+   if(voices[vnum].sfxinfo)
    {
-      I_StopSound(channels[cnum].handle);      // stop the sound playing
+      if(voices[vnum].handle >= 0)
+         I_StopSound(voices[vnum].handle);      // stop the sound playing
+
+      // haleyjd 09/27/06: clear the entire voice
+      memset(&voices[vnum], 0, sizeof(voice_t));
+
+      while(numvoices > 0 && !voices[numvoices - 1].sfxinfo)
+         numvoices--;
+   }
+}
 
-      // haleyjd 09/27/06: clear the entire channel
-      memset(&channels[cnum], 0, sizeof(channel_t));
+//
+// S_UnbindVoice
+//
+// Takes the hardware channel away from a voice. Sounds of unknown length
+// cannot be followed without one, they are stopped instead.
+//
+static void S_UnbindVoice(int vnum)
+{
+   voice_t *v = &voices[vnum];
+
+   if(v->sfxinfo->length > 0)
+   {
+      I_StopSound(v->handle);
+      v->handle = -1;
    }
+   else
+      S_StopVoice(vnum);
+}
+
+//
+// S_VoiceOffset
+//
+// How far a voice has got into its sound, in milliseconds of the sound.
+//
+static int S_VoiceOffset(const voice_t *v, int now)
+{
+   return (int)((now - v->starttime) * steptable[v->pitch]);
 }
 
 //
@@ -117,87 +168,109 @@ static int S_AdjustSoundParams(const mobj_t *listener, const mobj_t *source,
 }
 
 //
-// S_getChannel :
+// S_getVoice :
 //
-//   If none available, return -1.  Otherwise channel #.
+//   If none available, return -1.  Otherwise voice #.
 //   haleyjd 09/27/06: fixed priority/singularity bugs
 //   Note that a higher priority number means lower priority!
 //
-static int S_getChannel(const mobj_t *origin, sfxinfo_t *sfxinfo,
-                        int priority, int singularity)
+static int S_getVoice(const mobj_t *origin, int priority, int singularity)
 {
-  // channel number to use
-  int cnum;
+  // voice number to use
+  int vnum;
   int lowestpriority = -1; // haleyjd
-  int lpcnum = -1;
-
-  // haleyjd 09/28/06: moved this here. If we kill a sound already
-  // being played, we can use that channel. There is no need to
-  // search for a free one again because we already know of one.
+  int lpvnum = -1;
 
   // kill old sound
   // killough 12/98: replace is_pickup hack with singularity flag
   // haleyjd 06/12/08: only if subchannel matches
-  for (cnum = 0; cnum < numChannels; cnum++)
+  for (vnum = 0; vnum < numvoices; vnum++)
   {
-    if (channels[cnum].sfxinfo &&
-        channels[cnum].singularity == singularity &&
-        channels[cnum].origin == origin)
+    if (voices[vnum].sfxinfo &&
+        voices[vnum].singularity == singularity &&
+        voices[vnum].origin == origin)
     {
-      S_StopChannel(cnum);
+      S_StopVoice(vnum);
       break;
     }
   }
 
-  // Find an open channel
-  if (cnum == numChannels)
+  // Find an open voice, keeping track of the one found with the lowest
+  // sound priority while doing this.
+  for (vnum = 0; vnum < MAX_VOICES && voices[vnum].sfxinfo; vnum++)
   {
-    // haleyjd 09/28/06: it isn't necessary to look for playing sounds in
-    // the same singularity class again, as we just did that above. Here
-    // we are looking for an open channel. We will also keep track of the
-    // channel found with the lowest sound priority while doing this.
-    for (cnum = 0; cnum < numChannels && channels[cnum].sfxinfo; cnum++)
+    if (voices[vnum].priority > lowestpriority)
     {
-      if (channels[cnum].priority > lowestpriority)
-      {
-        lowestpriority = channels[cnum].priority;
-        lpcnum = cnum;
-      }
+      lowestpriority = voices[vnum].priority;
+      lpvnum = vnum;
     }
   }
 
   // None available?
-  if (cnum == numChannels)
+  if (vnum == MAX_VOICES)
   {
     // Look for lower priority
-    // haleyjd: we have stored the channel found with the lowest priority
-    // in the loop above
     if (priority > lowestpriority)
     {
       return -1;                  // No lower priority.  Sorry, Charlie.
     }
     else
     {
-      S_StopChannel(lpcnum);      // Otherwise, kick out lowest priority.
-      cnum = lpcnum;
+      S_StopVoice(lpvnum);        // Otherwise, kick out lowest priority.
+      vnum = lpvnum;
     }
   }
 
-#ifdef RANGECHECK
-  if (cnum >= numChannels)
-    I_Error("S_getChannel: handle %d out of range\n", cnum);
-#endif
+  if (vnum >= numvoices)
+    numvoices = vnum + 1;
 
-  return cnum;
+  return vnum;
 }
 
+//
+// S_getChannel :
+//
+//   Makes a hardware channel available for a sound of the given priority,
+//   taking it away from the bound voice with the lowest priority if all
+//   numChannels are in use. Returns false if there is none to be had.
+//
+static boolean S_getChannel(int priority)
+{
+  int vnum, bound = 0;
+  int lowestpriority = -1;
+  int lpvnum = -1;
+
+  for (vnum = 0; vnum < numvoices; vnum++)
+  {
+    if (voices[vnum].sfxinfo && voices[vnum].handle >= 0)
+    {
+      bound++;
+
+      if (voices[vnum].priority > lowestpriority)
+      {
+        lowestpriority = voices[vnum].priority;
+        lpvnum = vnum;
+      }
+    }
+  }
+
+  if (bound < numChannels)
+    return true;
+
+  if (priority > lowestpriority)
+    return false;
+
+  S_UnbindVoice(lpvnum);
+  return true;
+}
 
 void S_StartSound(const mobj_t *origin, int sfx_id)
 {
-   int sep, pitch, o_priority, priority, singularity, cnum, handle;
+   int sep, pitch, o_priority, priority, singularity, vnum, handle;
    int volumeScale = 127;
    int volume = snd_SfxVolume;
    sfxinfo_t *sfx;
+   voice_t *v;
 
    //jff 1/22/98 return if sound is not enabled
    if(nosfxparm)
@@ -259,41 +332,40 @@ void S_StartSound(const mobj_t *origin, int sfx_id)
          pitch = 255;
    }
 
-   // try to find a channel
-   if((cnum = S_getChannel(origin, sfx, priority, singularity)) < 0)
+   // try to find a voice
+   if((vnum = S_getVoice(origin, priority, singularity)) < 0)
       return;
 
-#ifdef RANGECHECK
-   if(cnum < 0 || cnum >= numChannels)
-      I_Error("S_StartSfxInfo: handle %d out of range\n", cnum);
-#endif
-
-   channels[cnum].sfxinfo = sfx;
-   channels[cnum].origin  = origin;
-
    while(sfx->link)
       sfx = sfx->link;     // sf: skip thru link(s)
 
-   // Assigns the handle to one of the channels in the mix/output buffer.
-   handle = I_StartSound(sfx, volume, sep, pitch);
+   v = &voices[vnum];
+
+   // haleyjd 05/29/06: record volume scale value
+   // haleyjd 06/03/06: record pitch too (wtf is going on here??)
+   // haleyjd 09/27/06: store priority and singularity values (!!!)
+   v->sfxinfo     = sfx;
+   v->origin      = origin;
+   v->volume      = volumeScale;
+   v->pitch       = pitch;
+   v->o_priority  = o_priority;  // original priority
+   v->priority    = priority;    // scaled priority
+   v->singularity = singularity;
+   v->starttime   = I_GetTimeMS();
+   v->handle      = -1;
 
-   // haleyjd: check to see if the sound was started
-   if(handle >= 0)
+   // Assigns the handle to one of the channels in the mix/output buffer.
+   if(S_getChannel(priority) &&
+      (handle = I_StartSound(sfx, volume, sep, pitch, 0)) >= 0)
    {
-      channels[cnum].handle = handle;
-      
-      // haleyjd 05/29/06: record volume scale value
-      // haleyjd 06/03/06: record pitch too (wtf is going on here??)
-      // haleyjd 09/27/06: store priority and singularity values (!!!)
-      channels[cnum].volume      = volumeScale;
-      channels[cnum].pitch       = pitch;
-      channels[cnum].o_priority  = o_priority;  // original priority
-      channels[cnum].priority    = priority;    // scaled priority
-      channels[cnum].singularity = singularity;
-      channels[cnum].idnum       = I_SoundID(handle); // unique instance id
+      v->handle = handle;
+      v->idnum  = I_SoundID(handle); // unique instance id
+   }
+   else if(sfx->length <= 0)
+   {
+      // haleyjd: the sound didn't start, and it cannot be resumed later
+      S_StopVoice(vnum);
    }
-   else // haleyjd: the sound didn't start, so clear the channel info
-      memset(&channels[cnum], 0, sizeof(channel_t));
 }
 
 //
@@ -301,17 +373,17 @@ void S_StartSound(const mobj_t *origin, int sfx_id)
 //
 void S_StopSound(const mobj_t *origin)
 {
-   int cnum;
+   int vnum;
    
    //jff 1/22/98 return if sound is not enabled
    if(nosfxparm)
       return;
 
-   for(cnum = 0; cnum < numChannels; ++cnum)
+   for(vnum = 0; vnum < numvoices; ++vnum)
    {
-      if(channels[cnum].sfxinfo && channels[cnum].origin == origin)
+      if(voices[vnum].sfxinfo && voices[vnum].origin == origin)
       {
-         S_StopChannel(cnum);
+         S_StopVoice(vnum);
          break;
       }
    }
@@ -322,23 +394,23 @@ boolean full_sounds;
 // [FG] removed map objects may finish their sounds
 void S_UnlinkSound(mobj_t *origin)
 {
-    int cnum;
+    int vnum;
 
    if (nosfxparm)
         return;
 
     if (origin)
     {
-        for (cnum = 0; cnum < numChannels; cnum++)
+        for (vnum = 0; vnum < numvoices; vnum++)
         {
-            if (channels[cnum].sfxinfo && channels[cnum].origin == origin)
+            if (voices[vnum].sfxinfo && voices[vnum].origin == origin)
             {
-                mobj_t *const sobj = &sobjs[cnum];
+                mobj_t *const sobj = &sobjs[vnum];
                 sobj->x = origin->x;
                 sobj->y = origin->y;
                 sobj->z = origin->z;
                 sobj->info = origin->info;
-                channels[cnum].origin = sobj;
+                voices[vnum].origin = sobj;
                 break;
             }
         }
@@ -381,66 +453,203 @@ void S_InitListener(const mobj_t *listener)
     I_ProcessSoundUpdates();
 }
 
+//
+// S_ScoreVoices
+//
+// Estimates the priority of every voice the way the MBF sound module does,
+// in one pass over flat arrays that the compiler can vectorise. Voices out
+// of earshot get a score above 255. Exact parameters are only worked out
+// for the voices that are bound to a channel.
+//
+static void S_ScoreVoices(const mobj_t *listener)
+{
+   static int x[MAX_VOICES], y[MAX_VOICES], vol[MAX_VOICES], pri[MAX_VOICES];
+   const int lx = listener ? listener->x >> FRACBITS : 0;
+   const int ly = listener ? listener->y >> FRACBITS : 0;
+   int vnum;
+
+   for(vnum = 0; vnum < numvoices; ++vnum)
+   {
+      const voice_t *v = &voices[vnum];
+      const mobj_t *origin = v->origin;
+
+      if(!listener || !origin || origin == listener ||
+         origin == players[displayplayer].mo)
+      {
+         x[vnum] = lx;
+         y[vnum] = ly;
+      }
+      else
+      {
+         x[vnum] = origin->x >> FRACBITS;
+         y[vnum] = origin->y >> FRACBITS;
+      }
+
+      vol[vnum] = v->sfxinfo ? MIN(snd_SfxVolume * v->volume / 15, 127) : 0;
+      pri[vnum] = v->o_priority;
+   }
+
+   // all of them, so that the trip count is known
+   for(vnum = 0; vnum < MAX_VOICES; ++vnum)
+   {
+      const int adx = abs(x[vnum] - lx);
+      const int ady = abs(y[vnum] - ly);
+      const int dist = adx + ady - (MIN(adx, ady) >> 1);
+      // full volume up to S_CLOSE_DIST, nothing from S_CLIPPING_DIST on
+      const int left = MIN((S_CLIPPING_DIST >> FRACBITS) - dist, S_ATTENUATOR);
+      const int v = vol[vnum] * left / S_ATTENUATOR;
+
+      voice_score[vnum] = v > 0 ? MIN(pri[vnum] + 127 - v, 255) : 256;
+   }
+}
+
+//
+// S_UpdateVoices
+//
+// Gives the hardware channels to the most audible voices.
+//
+static void S_UpdateVoices(const mobj_t *listener, int now)
+{
+   for(;;)
+   {
+      int vnum, best = -1, worst = -1, bound = 0;
+
+      for(vnum = 0; vnum < numvoices; ++vnum)
+      {
+         if(!voices[vnum].sfxinfo)
+            continue;
+
+         if(voices[vnum].handle >= 0)
+         {
+            bound++;
+            if(worst < 0 || voice_score[vnum] > voice_score[worst])
+               worst = vnum;
+         }
+         else if(voice_score[vnum] <= 255 &&
+                 (best < 0 || voice_score[vnum] < voice_score[best]))
+            best = vnum;
+      }
+
+      if(bound > numChannels)
+      {
+         S_UnbindVoice(worst);    // the number of channels was lowered
+         continue;
+      }
+
+      if(best < 0)
+         break;
+
+      if(bound == numChannels)
+      {
+         if(voice_score[best] + VOICE_HYSTERESIS >= voice_score[worst])
+            break;
+
+         S_UnbindVoice(worst);
+      }
+
+      {
+         voice_t *v = &voices[best];
+         int volume = snd_SfxVolume;
+         int pitch = v->pitch;
+         int sep = NORM_SEP;
+         int pri = v->o_priority;
+
+         if(S_AdjustSoundParams(listener, v->origin, v->volume,
+                                &volume, &sep, &pitch, &pri) &&
+            (v->handle = I_StartSound(v->sfxinfo, volume, sep, v->pitch,
+                                      S_VoiceOffset(v, now))) >= 0)
+         {
+            v->idnum = I_SoundID(v->handle);
+            v->priority = pri;
+         }
+         else
+         {
+            v->handle = -1;              // stay virtual, try again next tic
+            voice_score[best] = 256;
+         }
+      }
+   }
+}
+
 void S_UpdateSounds(const mobj_t *listener)
 {
-   int cnum;
+   int vnum, now;
    
    //jff 1/22/98 return if sound is not enabled
    if(nosfxparm)
       return;
+
+   TRACE_BEGIN("S_UpdateSounds");
    
    I_DeferSoundUpdates();
 
-   for(cnum = 0; cnum < numChannels; ++cnum)
+   now = I_GetTimeMS();
+
+   // free the voices of sounds that have ended
+   for(vnum = numvoices - 1; vnum >= 0; --vnum)
    {
-      channel_t *c = &channels[cnum];
-      sfxinfo_t *sfx = c->sfxinfo;
+      voice_t *v = &voices[vnum];
 
-      // haleyjd: has this software channel lost its hardware channel?
-      if(c->idnum != I_SoundID(c->handle))
-      {
-         // clear the channel and keep going
-         memset(c, 0, sizeof(channel_t));
+      if(!v->sfxinfo)
          continue;
+
+      if(v->handle < 0)
+      {
+         if(S_VoiceOffset(v, now) >= v->sfxinfo->length)
+            S_StopVoice(vnum);
       }
+      // haleyjd: has this voice lost its hardware channel?
+      else if(v->idnum != I_SoundID(v->handle))
+      {
+         v->handle = -1;
+         S_StopVoice(vnum);
+      }
+      else if(!I_SoundIsPlaying(v->handle))
+         S_StopVoice(vnum);
+   }
+
+   S_ScoreVoices(listener);
+
+   for(vnum = 0; vnum < numvoices; ++vnum)
+   {
+      voice_t *v = &voices[vnum];
 
-      if(sfx)
+      if(v->sfxinfo && v->handle >= 0)
       {
-         if (I_SoundIsPlaying(c->handle))
-         {
-            // initialize parameters
-            int volume = snd_SfxVolume;
-            int pitch = c->pitch; // haleyjd 06/03/06: use channel's pitch!
-            int sep = NORM_SEP;
-            int pri = c->o_priority; // haleyjd 09/27/06: priority
+         // initialize parameters
+         int volume = snd_SfxVolume;
+         int pitch = v->pitch; // haleyjd 06/03/06: use voice's pitch!
+         int sep = NORM_SEP;
+         int pri = v->o_priority; // haleyjd 09/27/06: priority
             
-            // check non-local sounds for distance clipping
-            // or modify their params
+         // check non-local sounds for distance clipping
+         // or modify their params
 
-            if(c->origin && listener != c->origin) // killough 3/20/98
+         if(v->origin && listener != v->origin) // killough 3/20/98
+         {
+            if(!S_AdjustSoundParams(listener, 
+                                    v->origin, 
+                                    v->volume, 
+                                    &volume,
+                                    &sep, 
+                                    &pitch,
+                                    &pri))
+               S_UnbindVoice(vnum);
+            else
             {
-               if(!S_AdjustSoundParams(listener, 
-                                       c->origin, 
-                                       c->volume, 
-                                       &volume,
-                                       &sep, 
-                                       &pitch,
-                                       &pri))
-                  S_StopChannel(cnum);
-               else
-               {
-                  I_UpdateSoundParams(c->handle, volume, sep);
-                  c->priority = pri; // haleyjd
-               }
+               I_UpdateSoundParams(v->handle, volume, sep);
+               v->priority = pri; // haleyjd
             }
          }
-         else   // if channel is allocated but sound has stopped, free it
-            S_StopChannel(cnum);
-        }
-    }
+      }
+   }
+
+   S_UpdateVoices(listener, now);
 
    I_UpdateListenerParams(listener);
    I_ProcessSoundUpdates();
+
+   TRACE_END();
 }
 
 void S_UpdateMusic(void)
@@ -644,11 +853,8 @@ void S_Start(void)
    //jff 1/22/98 skip sound init if sound not enabled
    if(!nosfxparm)
    {
-      for(cnum = 0; cnum < numChannels; ++cnum)
-      {
-         if(channels[cnum].sfxinfo)
-            S_StopChannel(cnum);
-      }
+      for(cnum = numvoices - 1; cnum >= 0; --cnum)
+         S_StopVoice(cnum);
    }
 
    // [crispy] don't load map's default music if loaded from a savegame with
@@ -737,8 +943,9 @@ void S_Init(int sfxVolume, int musicVolume)
 
       // Reset channel memory
       numChannels = default_numChannels;
-      memset(channels, 0, sizeof(channels));
+      memset(voices, 0, sizeof(voices));
       memset(sobjs, 0, sizeof(sobjs));
+      numvoices = 0;
    }
 
    S_SetMusicVolume(musicVolume);
@@ -125,7 +125,8 @@ musicinfo_t original_S_music[] = {
    .volume = -1, \
    .buffer = 0, \
    .lumpnum = -1, \
-   .cached = false}
+   .cached = false, \
+   .length = 0}
 
 #define SOUND(n, s, p) \
   SOUND_LINK(n, s, p, 0, -1)
@@ -62,6 +62,9 @@ typedef struct sfxinfo_struct {
 
   boolean cached;
 
+  // [Woof!] length in milliseconds, 0 if not known
+  int length;
+
 } sfxinfo_t;
 
 //
@@ -34,6 +34,7 @@
 #include "m_cheat.h"
 #include "m_misc2.h"
 #include "m_swap.h"
+#include "m_trace.h"
 #include "i_printf.h"
 #include "s_sound.h"
 #include "sounds.h"
@@ -315,6 +316,12 @@ void ST_Stop(void);
 
 int st_solidbackground;
 
+#ifdef TRUECOLOR
+#define PIXELINDEX(p) V_PixelIndex(p)
+#else
+#define PIXELINDEX(p) (p)
+#endif
+
 static void ST_DrawSolidBackground(int st_x)
 {
   // [FG] calculate average color of the 16px left and right of the status bar
@@ -342,15 +349,15 @@ static void ST_DrawSolidBackground(int st_x)
     {
       for (x = 0; x < depth; x++)
       {
-        byte *c = st_backing_screen + V_ScaleY(y) * video.pitch + V_ScaleX(x + offset);
-        r += pal[3 * c[0] + 0];
-        g += pal[3 * c[0] + 1];
-        b += pal[3 * c[0] + 2];
+        const pixel_t *c = st_backing_screen + V_ScaleY(y) * video.pitch + V_ScaleX(x + offset);
+        r += pal[3 * PIXELINDEX(c[0]) + 0];
+        g += pal[3 * PIXELINDEX(c[0]) + 1];
+        b += pal[3 * PIXELINDEX(c[0]) + 2];
 
         c += V_ScaleX(width - 2 * x - 1);
-        r += pal[3 * c[0] + 0];
-        g += pal[3 * c[0] + 1];
-        b += pal[3 * c[0] + 2];
+        r += pal[3 * PIXELINDEX(c[0]) + 0];
+        g += pal[3 * PIXELINDEX(c[0]) + 1];
+        b += pal[3 * PIXELINDEX(c[0]) + 2];
       }
     }
 
@@ -1062,6 +1069,8 @@ static void ST_MoveHud (void);
 
 void ST_Drawer(boolean fullscreen, boolean refresh)
 {
+  TRACE_BEGIN("ST_Drawer");
+
   st_statusbaron = !fullscreen || automap_on;
   // [crispy] immediately redraw status bar after help screens have been shown
   st_firsttime = st_firsttime || refresh || inhelpscreens;
@@ -1081,6 +1090,8 @@ void ST_Drawer(boolean fullscreen, boolean refresh)
   }
   
   ST_drawWidgets();
+
+  TRACE_END();
 }
 
 void ST_loadGraphics(void)
@@ -29,6 +29,7 @@
 //
 
 #include "i_video.h"
+#include "m_cache.h"
 #include "v_flextran.h"
 #include "w_wad.h"
 
@@ -48,6 +49,7 @@ typedef struct
 void V_InitFlexTranTable(void)
 {
    int i, r, g, b, x, y;
+   uint64_t key;
    tpalcol_t  *tempRGBpal;
    const byte *palRover;
 
@@ -63,17 +65,25 @@ void V_InitFlexTranTable(void)
    }
 
    // build RGB table
-   for(r = 0; r < 32; ++r)
+   // [Woof!] only depends on the palette, which the startup cache is keyed on
+   key = M_CacheHash(palette, 256*3, 0);
+
+   if(!M_ReadCache("rgb32k", key, RGB32k, sizeof(RGB32k)))
    {
-      for(g = 0; g < 32; ++g)
+      for(r = 0; r < 32; ++r)
       {
-         for(b = 0; b < 32; ++b)
+         for(g = 0; g < 32; ++g)
          {
-            RGB32k[r][g][b] =
-               I_GetPaletteIndex(palette,
-                                 MAKECOLOR(r), MAKECOLOR(g), MAKECOLOR(b));
+            for(b = 0; b < 32; ++b)
+            {
+               RGB32k[r][g][b] =
+                  I_GetPaletteIndex(palette,
+                                    MAKECOLOR(r), MAKECOLOR(g), MAKECOLOR(b));
+            }
          }
       }
+
+      M_WriteCache("rgb32k", key, RGB32k, sizeof(RGB32k));
    }
 
    // build lookup table
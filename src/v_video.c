@@ -33,6 +33,44 @@
 
 pixel_t *I_VideoBuffer;
 
+#ifdef TRUECOLOR
+
+pixel_t v_palette[256];
+
+// Only used for save game snapshots and the solid status bar background,
+// so a plain search will do. The pixels and the palette both have gamma
+// applied, so it cancels out.
+
+byte V_PixelIndex(pixel_t pixel)
+{
+    byte best = 0;
+    int best_diff = INT_MAX;
+    int i;
+
+    for (i = 0; i < 256; i++)
+    {
+        const int r = (int)((pixel >> 16) & 0xff) - (int)((v_palette[i] >> 16) & 0xff);
+        const int g = (int)((pixel >> 8) & 0xff) - (int)((v_palette[i] >> 8) & 0xff);
+        const int b = (int)(pixel & 0xff) - (int)(v_palette[i] & 0xff);
+        const int diff = r * r + g * g + b * b;
+
+        if (diff < best_diff)
+        {
+            best = i;
+            best_diff = diff;
+        }
+
+        if (diff == 0)
+        {
+            break;
+        }
+    }
+
+    return best;
+}
+
+#endif
+
 // The screen buffer that the v_video.c code draws to.
 
 static pixel_t *dest_screen = NULL;
@@ -237,7 +275,7 @@ static void (*drawcolfunc)(const patch_column_t *patchcol);
 static void V_DrawPatchColumn(const patch_column_t *patchcol)
 {
     int      count;
-    byte     *dest;    // killough
+    pixel_t  *dest;    // killough
     fixed_t  frac;     // killough
     fixed_t  fracstep;
 
@@ -274,22 +312,22 @@ static void V_DrawPatchColumn(const patch_column_t *patchcol)
 
         while ((count -= 2) >= 0)
         {
-            *dest = source[frac >> FRACBITS];
+            *dest = V_Pixel(source[frac >> FRACBITS]);
             dest += linesize;
             frac += fracstep;
-            *dest = source[frac >> FRACBITS];
+            *dest = V_Pixel(source[frac >> FRACBITS]);
             dest += linesize;
             frac += fracstep;
         }
         if (count & 1)
-            *dest = source[frac >> FRACBITS];
+            *dest = V_Pixel(source[frac >> FRACBITS]);
     }
 }
 
 static void V_DrawPatchColumnTR(const patch_column_t *patchcol)
 {
     int      count;
-    byte     *dest;    // killough
+    pixel_t  *dest;    // killough
     fixed_t  frac;     // killough
     fixed_t  fracstep;
 
@@ -326,16 +364,16 @@ static void V_DrawPatchColumnTR(const patch_column_t *patchcol)
 
         while ((count -= 2) >= 0)
         {
-            *dest = translation[source[frac >> FRACBITS]];
+            *dest = V_Pixel(translation[source[frac >> FRACBITS]]);
             dest += linesize;
             frac += fracstep;
-            *dest = translation[source[frac >> FRACBITS]];
+            *dest = V_Pixel(translation[source[frac >> FRACBITS]]);
             dest += linesize;
             frac += fracstep;
         }
         if (count & 1)
         {
-            *dest = translation[source[frac >> FRACBITS]];
+            *dest = V_Pixel(translation[source[frac >> FRACBITS]]);
         }
     }
 }
@@ -343,7 +381,7 @@ static void V_DrawPatchColumnTR(const patch_column_t *patchcol)
 static void V_DrawPatchColumnTRTR(const patch_column_t *patchcol)
 {
     int      count;
-    byte     *dest;    // killough
+    pixel_t  *dest;    // killough
     fixed_t  frac;     // killough
     fixed_t  fracstep;
 
@@ -380,16 +418,16 @@ static void V_DrawPatchColumnTRTR(const patch_column_t *patchcol)
 
         while ((count -= 2) >= 0)
         {
-            *dest = translation2[translation1[source[frac >> FRACBITS]]];
+            *dest = V_Pixel(translation2[translation1[source[frac >> FRACBITS]]]);
             dest += linesize;
             frac += fracstep;
-            *dest = translation2[translation1[source[frac >> FRACBITS]]];
+            *dest = V_Pixel(translation2[translation1[source[frac >> FRACBITS]]]);
             dest += linesize;
             frac += fracstep;
         }
         if (count & 1)
         {
-            *dest = translation2[translation1[source[frac >> FRACBITS]]];
+            *dest = V_Pixel(translation2[translation1[source[frac >> FRACBITS]]]);
         }
     }
 }
@@ -635,11 +673,21 @@ void V_FillRect(int x, int y, int width, int height, byte color)
 
     V_ScaleRect(&dstrect);
 
-    byte* dest = V_ADDRESS(dest_screen, dstrect.sx, dstrect.sy);
+    pixel_t *dest = V_ADDRESS(dest_screen, dstrect.sx, dstrect.sy);
 
     while (dstrect.sh--)
     {
+#ifdef TRUECOLOR
+        const pixel_t pixel = V_Pixel(color);
+        int i;
+
+        for (i = 0; i < dstrect.sw; i++)
+        {
+            dest[i] = pixel;
+        }
+#else
         memset(dest, color, dstrect.sw);
+#endif
         dest += linesize;
     }
 }
@@ -657,7 +705,7 @@ void V_CopyRect(int srcx, int srcy, pixel_t *source,
                 int destx, int desty)
 {
     vrect_t srcrect, dstrect;
-    byte *src, *dest;
+    pixel_t *src, *dest;
     int usew, useh;
 
 #ifdef RANGECHECK
@@ -692,7 +740,7 @@ void V_CopyRect(int srcx, int srcy, pixel_t *source,
 
     while (useh--)
     {
-        memcpy(dest, src, usew);
+        memcpy(dest, src, usew * sizeof(*dest));
         src += linesize;
         dest += linesize;
     }
@@ -709,8 +757,8 @@ void V_CopyRect(int srcx, int srcy, pixel_t *source,
 
 void V_DrawBlock(int x, int y, int width, int height, pixel_t *src)
 {
-    const byte *source;
-    byte *dest;
+    const pixel_t *source;
+    pixel_t *dest;
     vrect_t dstrect;
 
     dstrect.x = x;
@@ -727,7 +775,7 @@ void V_DrawBlock(int x, int y, int width, int height, pixel_t *src)
         int     w;
         fixed_t xfrac, yfrac;
         int     xtex, ytex;
-        byte    *row;
+        pixel_t *row;
 
         yfrac = 0;
 
@@ -753,7 +801,7 @@ void V_DrawBlock(int x, int y, int width, int height, pixel_t *src)
 
 void V_TileBlock64(int line, int width, int height, const byte *src)
 {
-    byte *dest, *row;
+    pixel_t *dest, *row;
     fixed_t xfrac, yfrac;
     int xtex, ytex, h;
     vrect_t dstrect;
@@ -780,7 +828,7 @@ void V_TileBlock64(int line, int width, int height, const byte *src)
         while (w--)
         {
             xtex = (xfrac >> FRACBITS) & 63;
-            *row++ = src[ytex + xtex];
+            *row++ = V_Pixel(src[ytex + xtex]);
             xfrac += video.xstep;
         }
 
@@ -799,9 +847,9 @@ void V_TileBlock64(int line, int width, int height, const byte *src)
 // No return value
 //
 
-void V_GetBlock(int x, int y, int width, int height, byte *dest)
+void V_GetBlock(int x, int y, int width, int height, pixel_t *dest)
 {
-  byte *src;
+  pixel_t *src;
 
 #ifdef RANGECHECK
   if (x<0
@@ -815,7 +863,7 @@ void V_GetBlock(int x, int y, int width, int height, byte *dest)
 
   while (height--)
     {
-      memcpy (dest, src, width);
+      memcpy (dest, src, width * sizeof(*dest));
       src += linesize;
       dest += width;
     }
@@ -823,9 +871,9 @@ void V_GetBlock(int x, int y, int width, int height, byte *dest)
 
 // [FG] non hires-scaling variant of V_DrawBlock, used in disk icon drawing
 
-void V_PutBlock(int x, int y, int width, int height, byte *src)
+void V_PutBlock(int x, int y, int width, int height, pixel_t *src)
 {
-  byte *dest;
+  pixel_t *dest;
 
 #ifdef RANGECHECK
   if (x<0
@@ -839,7 +887,7 @@ void V_PutBlock(int x, int y, int width, int height, byte *src)
 
   while (height--)
     {
-      memcpy (dest, src, width);
+      memcpy (dest, src, width * sizeof(*dest));
       dest += linesize;
       src += width;
     }
@@ -849,13 +897,17 @@ void V_ShadeScreen(void)
 {
     int x, y;
 
-    byte *dest = dest_screen;
+    pixel_t *dest = dest_screen;
 
     for (y = 0; y < video.height; y++)
     {
         for (x = 0; x < video.width; x++)
         {
+#ifdef TRUECOLOR
+            dest[x] = V_ShadePixel(dest[x], 20);
+#else
             dest[x] = colormaps[0][20 * 256 + dest[x]];
+#endif
         }
         dest += linesize;
     }
@@ -87,6 +87,39 @@ typedef enum
 
 extern pixel_t *I_VideoBuffer;
 
+#ifdef TRUECOLOR
+
+// [Woof!] Pixel of each palette index, taken from the first palette with
+// gamma applied. The other palettes are applied as a tint when the frame
+// is presented.
+extern pixel_t v_palette[256];
+
+#define V_Pixel(c) (v_palette[(byte)(c)])
+
+// Blends two pixels, weighing the first one by alpha out of 256. Red and
+// blue are blended together in one multiply, green in another.
+
+inline static pixel_t V_BlendPixels(pixel_t fg, pixel_t bg, unsigned int alpha)
+{
+    const uint32_t rb = (fg & 0xff00ff) * alpha + (bg & 0xff00ff) * (256 - alpha);
+    const uint32_t g = (fg & 0x00ff00) * alpha + (bg & 0x00ff00) * (256 - alpha);
+
+    return 0xff000000 | ((rb >> 8) & 0xff00ff) | ((g >> 8) & 0x00ff00);
+}
+
+// Darkens a pixel the way colormap number level does.
+#define V_ShadePixel(p, level) \
+    V_BlendPixels((p), 0xff000000, (32 - (level)) * 8)
+
+// Closest palette index of a pixel.
+byte V_PixelIndex(pixel_t pixel);
+
+#else
+
+#define V_Pixel(c) (c)
+
+#endif
+
 //jff 4/24/98 loads color translation lumps
 void V_InitColorTranslation(void);
 
@@ -28,6 +28,11 @@
 #include "m_misc2.h" // [FG] M_BaseName()
 #include "m_swap.h"
 #include "d_main.h" // [FG] wadfiles
+#include "m_argv.h"
+
+#include "SDL.h"
+
+#include "../miniz/miniz.h"
 
 //
 // GLOBALS
@@ -73,7 +78,7 @@ void ExtractFileBase(const char *path, char *dest)
 //
 
 //
-// W_AddFile
+// W_ReadDirectory
 // All files are optional, but at least one file must be
 //  found (PWAD, if all required lumps are present).
 // Files with a .wad extension are wadlink files
@@ -83,21 +88,174 @@ void ExtractFileBase(const char *path, char *dest)
 //
 // Reload hack removed by Lee Killough
 //
+// [Woof!] The directories of all files are read in parallel into private
+// lump arrays, which W_InitMultipleFiles() then merges in load order. Only
+// malloc() is used here, errors are reported by the main thread.
+//
+
+typedef enum
+{
+  wad_ok,
+  wad_skipped,        // missing .lmp file, silently ignored
+  wad_not_found,
+  wad_bad_header,
+  wad_bad_directory,
+} wadstatus_t;
+
+typedef struct
+{
+  const char *name;   // as given in wadfiles
+  char *filename;     // name with the default extension, as opened
+  lumpinfo_t *lumps;
+  int numlumps;
+  int handle;
+  mz_zip_archive *archive;
+  wadstatus_t status;
+  uint64_t time;      // time spent reading the directory
+} wadload_t;
 
 static int *handles = NULL;
 
-static void W_AddFile(const char *name) // killough 1/31/98: static, const
+//
+// [Woof!] Zip/PK3 archives
+//
+// The central directory is read once when the archive is added and each
+// file becomes a lump that is only inflated when it is first read. Files
+// in the top-level directories below are placed between the corresponding
+// markers, so they end up in the same namespace as marked WAD lumps.
+// Only .lmp, .ogg, .flac and .mp3 files become lumps. Nested WADs and
+// voxels are extracted by D_AddZipFile() instead, other files are ignored.
+//
+
+static mz_zip_archive **archives = NULL;
+
+static const struct
+{
+  const char *dir;
+  const char *start, *end;
+} zip_namespaces[] = {
+  {NULL},                                 // ns_global
+  {"sprites/",   "S_START",  "S_END"},    // ns_sprites
+  {"flats/",     "F_START",  "F_END"},    // ns_flats
+  {"colormaps/", "C_START",  "C_END"},    // ns_colormaps
+  {"hires/",     "HI_START", "HI_END"},   // ns_hires
+};
+
+#define NUMZIPNAMESPACES (sizeof(zip_namespaces) / sizeof(*zip_namespaces))
+
+static int W_ZipNamespace(const mz_zip_archive_file_stat *file_stat)
+{
+  const char *name = M_BaseName(file_stat->m_filename);
+  int i;
+
+  if (file_stat->m_is_directory || !file_stat->m_is_supported ||
+      name[0] == '.' || file_stat->m_uncomp_size > INT_MAX)
+    return -1;
+
+  // Only formats that can be read as lumps, anything else (e.g. PNGs in
+  // sprites/) would be taken for a patch or flat.
+  if (!M_StringCaseEndsWith(name, ".lmp") &&
+      !M_StringCaseEndsWith(name, ".ogg") &&
+      !M_StringCaseEndsWith(name, ".flac") &&
+      !M_StringCaseEndsWith(name, ".mp3"))
+    return -1;
+
+  for (i = ns_sprites; i < NUMZIPNAMESPACES; i++)
+    if (!strncasecmp(file_stat->m_filename, zip_namespaces[i].dir,
+                     strlen(zip_namespaces[i].dir)))
+      return i;
+
+  return ns_global;
+}
+
+static void W_ReadZipDirectory(wadload_t *w)
+{
+  mz_zip_archive *zip = calloc(1, sizeof(*zip));
+  mz_zip_archive_file_stat file_stat;
+  int count[NUMZIPNAMESPACES] = {0};
+  int i, ns, num_files;
+  lumpinfo_t *lump_p;
+  signed char *nsmap;
+
+  if (!mz_zip_reader_init_file(zip, w->name,
+                               MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY))
+    {
+      free(zip);
+      w->status = wad_not_found;
+      return;
+    }
+
+  num_files = mz_zip_reader_get_num_files(zip);
+  nsmap = malloc(num_files);
+
+  for (i = 0; i < num_files; i++)
+    {
+      mz_zip_reader_file_stat(zip, i, &file_stat);
+      if ((nsmap[i] = W_ZipNamespace(&file_stat)) >= 0)
+        count[(int) nsmap[i]]++;
+    }
+
+  w->numlumps = count[ns_global];
+  for (ns = ns_sprites; ns < NUMZIPNAMESPACES; ns++)
+    if (count[ns])
+      w->numlumps += count[ns] + 2;
+
+  w->archive = zip;
+  w->lumps = lump_p = calloc(w->numlumps, sizeof(*lump_p));
+
+  // Emit global lumps first, then each namespace between its markers,
+  // keeping the archive order within each group
+
+  for (ns = ns_global; ns < NUMZIPNAMESPACES; ns++)
+    {
+      if (!count[ns])
+        continue;
+
+      if (ns != ns_global)
+        M_CopyLumpName((lump_p++)->name, zip_namespaces[ns].start);
+
+      for (i = 0; i < num_files; i++)
+        if (nsmap[i] == ns)
+          {
+            mz_zip_reader_file_stat(zip, i, &file_stat);
+            ExtractFileBase(file_stat.m_filename, lump_p->name);
+            lump_p->size = file_stat.m_uncomp_size;
+            lump_p->namespace = ns_global;  // set by W_CoalesceMarkedResource
+            lump_p->handle = -1;
+            lump_p->position = i;
+            lump_p->wad_file = w->name;
+            lump_p->archive = zip;
+            lump_p++;
+          }
+
+      if (ns != ns_global)
+        M_CopyLumpName((lump_p++)->name, zip_namespaces[ns].end);
+    }
+
+  free(nsmap);
+}
+
+static void W_ReadDirectory(wadload_t *w) // killough 1/31/98: static, const
 {
   wadinfo_t   header;
   lumpinfo_t* lump_p;
-  unsigned    i;
+  int         i;
   int         handle;
   int         length;
-  int         startlump;
   filelump_t  *fileinfo, *fileinfo2free=NULL; //killough
   filelump_t  singleinfo;
   boolean     is_single = false;
-  char        *filename = strcpy(malloc(strlen(name)+5), name);
+  const char  *name = w->name;
+  char        *filename;
+
+  if (M_StringCaseEndsWith(name, ".zip") || M_StringCaseEndsWith(name, ".pk3"))
+    {
+      w->filename = strcpy(malloc(strlen(name)+1), name);
+      W_ReadZipDirectory(w);
+      return;
+    }
+
+  w->filename = filename = strcpy(malloc(strlen(name)+5), name);
 
   NormalizeSlashes(AddDefaultExtension(filename, ".wad"));  // killough 11/98
 
@@ -107,17 +265,19 @@ static void W_AddFile(const char *name) // killough 1/31/98: static, const
     {
       if (strlen(name) > 4 && !strcasecmp(name+strlen(name)-4 , ".lmp" ))
 	{
-	  free(filename);
+	  w->status = wad_skipped;
 	  return;
 	}
       // killough 11/98: allow .lmp extension if none existed before
       NormalizeSlashes(AddDefaultExtension(strcpy(filename, name), ".lmp"));
       if ((handle = M_open(filename,O_RDONLY | O_BINARY)) == -1)
-	I_Error("Error: couldn't open %s\n",name);  // killough
+	{
+	  w->status = wad_not_found;
+	  return;
+	}
     }
 
-  I_Printf(VB_INFO, " adding %s",filename);   // killough 8/8/98
-  startlump = numlumps;
+  w->handle = handle;
 
   // killough:
   if (strlen(filename)<=4 || strcasecmp(filename+strlen(filename)-4, ".wad" ))
@@ -127,18 +287,20 @@ static void W_AddFile(const char *name) // killough 1/31/98: static, const
       singleinfo.filepos = 0;
       singleinfo.size = LONG(W_FileLength(handle));
       ExtractFileBase(filename, singleinfo.name);
-      numlumps++;
+      w->numlumps = 1;
       is_single = true;
     }
   else
     {
       // WAD file
       // [FG] check return value
-      if (!read(handle, &header, sizeof(header)))
-        I_Error("Wad file %s doesn't have IWAD or PWAD id\n", filename);
-      if (strncmp(header.identification,"IWAD",4) &&
-          strncmp(header.identification,"PWAD",4))
-        I_Error("Wad file %s doesn't have IWAD or PWAD id\n", filename);
+      if (!read(handle, &header, sizeof(header)) ||
+          (strncmp(header.identification,"IWAD",4) &&
+           strncmp(header.identification,"PWAD",4)))
+        {
+          w->status = wad_bad_header;
+          return;
+        }
       header.numlumps = LONG(header.numlumps);
       header.infotableofs = LONG(header.infotableofs);
       length = header.numlumps*sizeof(filelump_t);
@@ -146,32 +308,87 @@ static void W_AddFile(const char *name) // killough 1/31/98: static, const
       lseek(handle, header.infotableofs, SEEK_SET);
       // [FG] check return value
       if (!read(handle, fileinfo, length))
-        I_Error("Error reading lump directory from %s\n", filename);
-      numlumps += header.numlumps;
+        {
+          free(fileinfo2free);
+          w->status = wad_bad_directory;
+          return;
+        }
+      w->numlumps = header.numlumps;
     }
 
-    array_push(handles, handle);
+  // Fill in lumpinfo
+  w->lumps = lump_p = malloc(w->numlumps * sizeof(*lump_p));
 
-    free(filename);           // killough 11/98
+  for (i = 0; i < w->numlumps; i++, lump_p++, fileinfo++)
+    {
+      lump_p->handle = handle;                    //  killough 4/25/98
+      lump_p->position = LONG(fileinfo->filepos);
+      lump_p->size = LONG(fileinfo->size);
+      lump_p->data = NULL;                        // killough 1/31/98
+      lump_p->namespace = ns_global;              // killough 4/17/98
+      M_CopyLumpName(lump_p->name, fileinfo->name);
+      // [FG] WAD file that contains the lump
+      lump_p->wad_file = (is_single ? NULL : name);
+      lump_p->archive = NULL;
+    }
 
-    // Fill in lumpinfo
-    lumpinfo = Z_Realloc(lumpinfo, numlumps*sizeof(lumpinfo_t), PU_STATIC, 0);
+  free(fileinfo2free);      // killough
+}
 
-    lump_p = &lumpinfo[startlump];
+// [Woof!] Files are dealt out round-robin, so the IWAD and the PWADs after
+// it are read at the same time. The work is mostly waiting for the disk,
+// so the thread count does not depend on the number of CPUs.
 
-    for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
-      {
-        lump_p->handle = handle;                    //  killough 4/25/98
-        lump_p->position = LONG(fileinfo->filepos);
-        lump_p->size = LONG(fileinfo->size);
-        lump_p->data = NULL;                        // killough 1/31/98
-        lump_p->namespace = ns_global;              // killough 4/17/98
-        M_CopyLumpName(lump_p->name, fileinfo->name);
-        // [FG] WAD file that contains the lump
-        lump_p->wad_file = (is_single ? NULL : name);
-      }
+#define MAXLOADTHREADS 8
+
+typedef struct
+{
+  wadload_t *loads;
+  int first, step, count;
+} loadthread_t;
+
+static int W_ReadDirectoriesThread(void *data)
+{
+  const loadthread_t *t = data;
+  int i;
+
+  for (i = t->first; i < t->count; i += t->step)
+    {
+      uint64_t start = SDL_GetPerformanceCounter();
+      W_ReadDirectory(&t->loads[i]);
+      t->loads[i].time = SDL_GetPerformanceCounter() - start;
+    }
+
+  return 0;
+}
+
+static void W_ReadDirectories(wadload_t *loads, int count)
+{
+  loadthread_t threads[MAXLOADTHREADS];
+  SDL_Thread *handle[MAXLOADTHREADS];
+  int i, numthreads = MAX(MIN(count, MAXLOADTHREADS), 1);
+
+  for (i = 0; i < numthreads; i++)
+    {
+      threads[i].loads = loads;
+      threads[i].first = i;
+      threads[i].step = numthreads;
+      threads[i].count = count;
+    }
+
+  // The main thread takes the first share, and any share a thread
+  // could not be created for.
+
+  for (i = 1; i < numthreads; i++)
+    if (!(handle[i] = SDL_CreateThread(W_ReadDirectoriesThread,
+                                       "W_ReadDirectories", &threads[i])))
+      W_ReadDirectoriesThread(&threads[i]);
+
+  W_ReadDirectoriesThread(&threads[0]);
 
-    free(fileinfo2free);      // killough
+  for (i = 1; i < numthreads; i++)
+    if (handle[i])
+      SDL_WaitThread(handle[i], NULL);
 }
 
 // jff 1/23/98 Create routines to reorder the master directory
@@ -189,10 +406,13 @@ static int IsMarker(const char *marker, const char *name)
 
 // killough 4/17/98: add namespace tags
 
+// [Woof!] marked is a scratch buffer of numlumps entries, shared by all
+// the passes
+
 static void W_CoalesceMarkedResource(const char *start_marker,
-                                     const char *end_marker, int namespace)
+                                     const char *end_marker, int namespace,
+                                     lumpinfo_t *marked)
 {
-  lumpinfo_t *marked = malloc(sizeof(*marked) * numlumps);
   size_t i, num_marked = 0, num_unmarked = 0;
   int is_marked = 0, mark_end = 0;
   lumpinfo_t *lump = lumpinfo;
@@ -234,8 +454,6 @@ static void W_CoalesceMarkedResource(const char *start_marker,
   // Append marked list to end of unmarked list
   memcpy(lumpinfo + num_unmarked, marked, num_marked * sizeof(*marked));
 
-  free(marked);                                   // free marked list
-
   numlumps = num_unmarked + num_marked;           // new total number of lumps
 
   if (mark_end)                                   // add end marker
@@ -361,37 +579,105 @@ int W_GetNumForName (const char* name)     // killough -- const added
 
 void W_InitMultipleFiles(void)
 {
-  int i;
+  int i, numfiles = array_size(wadfiles);
+  wadload_t *loads = calloc(numfiles, sizeof(*loads));
+  lumpinfo_t *lump_p, *marked;
+  uint64_t start, merge, hash, freq = SDL_GetPerformanceFrequency();
+
+  //!
+  // @category obscure
+  //
+  // Print the time spent loading each WAD directory and building the
+  // lump tables.
+  //
+
+  boolean wadstats = M_CheckParm("-wadstats");
+
+  start = SDL_GetPerformanceCounter();
+
+  // open all the files, load headers, and count lumps
+  for (i = 0; i < numfiles; ++i)
+    {
+      loads[i].name = wadfiles[i];
+      loads[i].handle = -1;
+    }
+
+  W_ReadDirectories(loads, numfiles);
 
   // killough 1/31/98: add predefined lumps first
 
   numlumps = num_predefined_lumps;
 
-  // lumpinfo will be realloced as lumps are added
-  lumpinfo = Z_Malloc(numlumps*sizeof(*lumpinfo), PU_STATIC, 0);
-
-  memcpy(lumpinfo, predefined_lumps, numlumps*sizeof(*lumpinfo));
+  for (i = 0; i < numfiles; ++i)
+    {
+      const wadload_t *w = &loads[i];
 
-  // open all the files, load headers, and count lumps
-  for (i = 0; i < array_size(wadfiles); ++i)
-    W_AddFile(wadfiles[i]);
+      switch (w->status)
+        {
+          case wad_ok:
+            I_Printf(VB_INFO, " adding %s", w->filename);  // killough 8/8/98
+            numlumps += w->numlumps;
+            break;
+          case wad_skipped:
+            break;
+          case wad_not_found:
+            I_Error("Error: couldn't open %s\n", w->name);  // killough
+            break;
+          case wad_bad_header:
+            I_Error("Wad file %s doesn't have IWAD or PWAD id\n", w->filename);
+            break;
+          case wad_bad_directory:
+            I_Error("Error reading lump directory from %s\n", w->filename);
+            break;
+        }
+    }
 
   if (!numlumps)
     I_Error ("W_InitFiles: no files found");
 
+  // [Woof!] lumpinfo is sized once for all the files
+  lumpinfo = Z_Malloc(numlumps*sizeof(*lumpinfo), PU_STATIC, 0);
+
+  memcpy(lumpinfo, predefined_lumps, num_predefined_lumps*sizeof(*lumpinfo));
+  lump_p = lumpinfo + num_predefined_lumps;
+
+  for (i = 0; i < numfiles; ++i)
+    {
+      wadload_t *w = &loads[i];
+
+      if (w->status != wad_ok)
+        continue;
+
+      memcpy(lump_p, w->lumps, w->numlumps*sizeof(*lumpinfo));
+      lump_p += w->numlumps;
+
+      if (w->archive)
+        array_push(archives, w->archive);
+      else
+        array_push(handles, w->handle);
+
+      free(w->lumps);
+    }
+
+  merge = SDL_GetPerformanceCounter();
+
   //jff 1/23/98
   // get all the sprites and flats into one marked block each
   // killough 1/24/98: change interface to use M_START/M_END explicitly
   // killough 4/17/98: Add namespace tags to each entry
 
-  W_CoalesceMarkedResource("S_START", "S_END", ns_sprites);
-  W_CoalesceMarkedResource("F_START", "F_END", ns_flats);
+  marked = malloc(numlumps*sizeof(*marked));
+
+  W_CoalesceMarkedResource("S_START", "S_END", ns_sprites, marked);
+  W_CoalesceMarkedResource("F_START", "F_END", ns_flats, marked);
 
   // killough 4/4/98: add colormap markers
-  W_CoalesceMarkedResource("C_START", "C_END", ns_colormaps);
+  W_CoalesceMarkedResource("C_START", "C_END", ns_colormaps, marked);
 
   // [Woof!] namespace to avoid conflicts with high-resolution textures
-  W_CoalesceMarkedResource("HI_START", "HI_END", ns_hires);
+  W_CoalesceMarkedResource("HI_START", "HI_END", ns_hires, marked);
+
+  free(marked);
 
   // set up caching
   lumpcache = Z_Calloc(sizeof *lumpcache, numlumps, PU_STATIC, 0); // killough
@@ -401,6 +687,30 @@ void W_InitMultipleFiles(void)
 
   // killough 1/31/98: initialize lump hash table
   W_InitLumpHash();
+
+  hash = SDL_GetPerformanceCounter();
+
+  if (wadstats)
+    {
+      I_Printf(VB_INFO, "W_InitMultipleFiles: %d files, %d lumps",
+               numfiles, numlumps);
+
+      for (i = 0; i < numfiles; ++i)
+        if (loads[i].status == wad_ok)
+          I_Printf(VB_INFO, " %8.3f ms %7d lumps  %s",
+                   loads[i].time * 1000.0 / freq, loads[i].numlumps,
+                   M_BaseName(loads[i].filename));
+
+      I_Printf(VB_INFO, " %8.3f ms read directories",
+               (merge - start) * 1000.0 / freq);
+      I_Printf(VB_INFO, " %8.3f ms merge and hash",
+               (hash - merge) * 1000.0 / freq);
+    }
+
+  for (i = 0; i < numfiles; ++i)
+    free(loads[i].filename);
+
+  free(loads);
 }
 
 //
@@ -431,6 +741,22 @@ void W_ReadLump(int lump, void *dest)
 
   if (l->data)     // killough 1/31/98: predefined lump data
     memcpy(dest, l->data, l->size);
+  else if (l->size && l->archive)
+    {
+      // [Woof!] stored entries are read straight into the destination,
+      // deflated ones are inflated into it through a static read buffer
+
+      static byte readbuf[MZ_ZIP_MAX_IO_BUF_SIZE];
+
+      I_BeginRead(l->size);
+      if (!mz_zip_reader_extract_to_mem_no_alloc(l->archive, l->position,
+                                                 dest, l->size, 0,
+                                                 readbuf, sizeof(readbuf)))
+        I_Error("W_ReadLump: couldn't extract lump %i from %s: %s", lump,
+                l->wad_file, mz_zip_get_error_string(
+                               mz_zip_get_last_error(l->archive)));
+      I_EndRead();
+    }
   else if (l->size) // [FG] ignore empty lumps
     {
       int c;
@@ -447,6 +773,42 @@ void W_ReadLump(int lump, void *dest)
     }
 }
 
+//
+// W_ReadLumpRange
+//
+// [Woof!] Read part of a lump, for callers that stream large lumps
+// through a small buffer. Lumps in zip archives can't be read from an
+// arbitrary offset and are cached whole instead.
+//
+
+void W_ReadLumpRange(int lump, void *dest, int offset, int size)
+{
+  lumpinfo_t *l = lumpinfo + lump;
+
+  if ((unsigned)lump >= numlumps || offset < 0 || size < 0
+      || offset > l->size - size)
+    I_Error("W_ReadLumpRange: bad range %i+%i in lump %i", offset, size, lump);
+
+  if (!size)
+    return;
+
+  if (l->data)
+    memcpy(dest, (const byte *)l->data + offset, size);
+  else if (l->archive)
+    memcpy(dest, (byte *)W_CacheLumpNum(lump, PU_CACHE) + offset, size);
+  else
+    {
+      int c;
+
+      I_BeginRead(size);
+      lseek(l->handle, l->position + offset, SEEK_SET);
+      c = read(l->handle, dest, size);
+      if (c < size)
+        I_Error("W_ReadLumpRange: only read %i of %i on lump %i", c, size, lump);
+      I_EndRead();
+    }
+}
+
 //
 // W_CacheLumpNum
 //
@@ -632,6 +994,11 @@ void W_CloseFileDescriptors(void)
   {
      close(handles[i]);
   }
+
+  for (i = 0; i < array_size(archives); ++i)
+  {
+     mz_zip_reader_end(archives[i]);
+  }
 }
 
 //----------------------------------------------------------------------------
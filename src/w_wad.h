@@ -79,6 +79,10 @@ typedef struct
 
   // [FG] WAD file that contains the lump
   const char *wad_file;
+
+  // [Woof!] zip archive that contains the lump, position is the index
+  // of its central directory entry
+  void *archive;
 } lumpinfo_t;
 
 // killough 1/31/98: predefined lumps
@@ -99,6 +103,7 @@ int     (W_CheckNumForName)(const char* name, int);   // killough 4/17/98
 int     W_GetNumForName (const char* name);
 int     W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
+void    W_ReadLumpRange (int lump, void *dest, int offset, int size);
 void*   W_CacheLumpNum (int lump, pu_tag tag);
 
 #define W_CacheLumpName(name,tag) W_CacheLumpNum (W_GetNumForName(name),(tag))
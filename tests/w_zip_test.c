@@ -0,0 +1,210 @@
+//
+//  Copyright (C) 2024 Woof contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Loads a generated pk3 and checks which of its files become lumps,
+//      and in which namespace. Only formats that can be read as lumps
+//      may be added; a PNG under sprites/ or flats/ must be skipped.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h" // SDL_main on Windows
+
+#include "d_main.h"
+#include "i_printf.h"
+#include "m_argv.h"
+#include "m_array.h"
+#include "m_io.h"
+#include "m_misc2.h"
+#include "w_wad.h"
+
+#include "../miniz/miniz.h"
+
+typedef struct
+{
+    const char *name;
+    const char *data;
+} zipfile_t;
+
+static const char png_data[] = "\x89PNG\r\n\x1a\n\0\0\0\rIHDR";
+
+static const zipfile_t files[] = {
+    { "DEMO1.lmp",           "demo lump"   },
+    { "readme.txt",          "not a lump"  },
+    { "sprites/TROOA1.lmp",  "sprite lump" },
+    { "sprites/TROOB1.png",  png_data      },
+    { "flats/FLAT1.png",     png_data      },
+    { "music/D_E1M1.ogg",    "OggS"        },
+};
+
+static void Put16(FILE *file, int value)
+{
+    fputc(value & 0xff, file);
+    fputc((value >> 8) & 0xff, file);
+}
+
+static void Put32(FILE *file, unsigned int value)
+{
+    Put16(file, value & 0xffff);
+    Put16(file, value >> 16);
+}
+
+// Writes an archive with stored entries. miniz is built without its
+// writing API, and the format is simple enough.
+
+static void WriteZip(const char *path)
+{
+    FILE *file = M_fopen(path, "wb");
+    long offsets[arrlen(files)];
+    long directory, end;
+    int i;
+
+    if (!file)
+    {
+        fprintf(stderr, "Failed to create %s\n", path);
+        exit(1);
+    }
+
+    for (i = 0; i < arrlen(files); i++)
+    {
+        const int namelen = strlen(files[i].name);
+        const int size = files[i].data == png_data ? sizeof(png_data) - 1
+                                                   : strlen(files[i].data);
+        const mz_ulong crc = mz_crc32(MZ_CRC32_INIT,
+                                      (const unsigned char *)files[i].data,
+                                      size);
+
+        offsets[i] = ftell(file);
+        Put32(file, 0x04034b50);
+        Put16(file, 10); // version needed
+        Put16(file, 0);  // flags
+        Put16(file, 0);  // stored
+        Put32(file, 0);  // time and date
+        Put32(file, crc);
+        Put32(file, size);
+        Put32(file, size);
+        Put16(file, namelen);
+        Put16(file, 0);
+        fwrite(files[i].name, 1, namelen, file);
+        fwrite(files[i].data, 1, size, file);
+    }
+
+    directory = ftell(file);
+
+    for (i = 0; i < arrlen(files); i++)
+    {
+        const int namelen = strlen(files[i].name);
+        const int size = files[i].data == png_data ? sizeof(png_data) - 1
+                                                   : strlen(files[i].data);
+        const mz_ulong crc = mz_crc32(MZ_CRC32_INIT,
+                                      (const unsigned char *)files[i].data,
+                                      size);
+
+        Put32(file, 0x02014b50);
+        Put16(file, 20); // version made by
+        Put16(file, 10); // version needed
+        Put16(file, 0);
+        Put16(file, 0);
+        Put32(file, 0);
+        Put32(file, crc);
+        Put32(file, size);
+        Put32(file, size);
+        Put16(file, namelen);
+        Put16(file, 0);  // extra field
+        Put16(file, 0);  // comment
+        Put16(file, 0);  // disk
+        Put16(file, 0);  // internal attributes
+        Put32(file, 0);  // external attributes
+        Put32(file, offsets[i]);
+        fwrite(files[i].name, 1, namelen, file);
+    }
+
+    end = ftell(file);
+
+    Put32(file, 0x06054b50);
+    Put16(file, 0);
+    Put16(file, 0);
+    Put16(file, arrlen(files));
+    Put16(file, arrlen(files));
+    Put32(file, end - directory);
+    Put32(file, directory);
+    Put16(file, 0);
+
+    fclose(file);
+}
+
+static int failures;
+
+static void Check(boolean condition, const char *what)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char *path;
+    char buffer[32];
+    int lump;
+
+    myargc = argc;
+    myargv = argv;
+
+    I_InitPrintf();
+
+    path = M_TempFile("woof_zip_test.pk3");
+    WriteZip(path);
+
+    array_push(wadfiles, path);
+    W_InitMultipleFiles();
+
+    lump = W_CheckNumForName("DEMO1");
+    Check(lump >= 0, "DEMO1.lmp is a global lump");
+    if (lump >= 0)
+    {
+        Check(W_LumpLength(lump) == strlen("demo lump"), "DEMO1 size");
+        W_ReadLump(lump, buffer);
+        Check(!memcmp(buffer, "demo lump", strlen("demo lump")),
+              "DEMO1 contents");
+    }
+
+    Check((W_CheckNumForName)("TROOA1", ns_sprites) >= 0,
+          "sprites/TROOA1.lmp is a sprite");
+    Check(W_CheckNumForName("D_E1M1") >= 0, "music/D_E1M1.ogg is a lump");
+
+    Check((W_CheckNumForName)("TROOB1", ns_sprites) < 0
+          && W_CheckNumForName("TROOB1") < 0,
+          "sprites/TROOB1.png is skipped");
+    Check((W_CheckNumForName)("FLAT1", ns_flats) < 0
+          && W_CheckNumForName("FLAT1") < 0,
+          "flats/FLAT1.png is skipped");
+    Check(W_CheckNumForName("README") < 0, "readme.txt is skipped");
+
+    M_remove(path);
+
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}